@@ -43,10 +43,14 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QPointer>
+#include <QThread>
 #include <QTimer>
 
 BatchExtract::BatchExtract(QObject* parent)
     : KCompositeJob(parent),
+      m_initialJobCount(0),
+      m_finishedJobCount(0),
+      m_isExtracting(false),
       m_autoSubfolder(false),
       m_preservePaths(true),
       m_openDestinationAfterExtraction(false)
@@ -134,11 +138,63 @@ void BatchExtract::slotStartJob()
         return;
     }
 
-    foreach(Kerfuffle::Archive *archive, m_inputs) {
-        addExtraction(archive);
+    KIO::getJobTracker()->registerJob(this);
+
+    m_initialJobCount = m_inputs.size();
+
+    if (!autoSubfolder()) {
+        foreach(Kerfuffle::Archive *archive, m_inputs) {
+            addExtraction(archive);
+        }
+
+        qCDebug(ARK) << "Starting first job";
+        startNextExtraction();
+        return;
     }
 
-    KIO::getJobTracker()->registerJob(this);
+    // Whether an archive needs a subfolder is only known once it has been listed.
+    // The metadata is loaded in the background, a few archives at a time, while the
+    // archives already listed are extracted.
+    m_pendingListings = m_inputs;
+    const int maxListings = qMax(1, QThread::idealThreadCount());
+    while (m_runningListings.size() < maxListings && !m_pendingListings.isEmpty()) {
+        startNextListing();
+    }
+}
+
+void BatchExtract::startNextListing()
+{
+    Kerfuffle::Archive *archive = m_pendingListings.takeFirst();
+
+    qCDebug(ARK) << "Loading the metadata of" << archive->fileName();
+
+    m_runningListings << archive;
+    connect(archive, &Kerfuffle::Archive::metaDataLoaded, this, [this, archive]() {
+        onMetaDataLoaded(archive);
+    });
+    archive->loadMetaData();
+}
+
+void BatchExtract::onMetaDataLoaded(Kerfuffle::Archive *archive)
+{
+    disconnect(archive, &Kerfuffle::Archive::metaDataLoaded, this, Q_NULLPTR);
+    m_runningListings.removeOne(archive);
+
+    // A failed listing is reported by the extraction of the archive.
+    addExtraction(archive);
+
+    if (!m_pendingListings.isEmpty()) {
+        startNextListing();
+    }
+
+    startNextExtraction();
+}
+
+void BatchExtract::startNextExtraction()
+{
+    if (m_isExtracting || !hasSubjobs()) {
+        return;
+    }
 
     emit description(this,
                      i18n("Extracting Files"),
@@ -146,10 +202,7 @@ void BatchExtract::slotStartJob()
                      qMakePair(i18n("Destination"), m_fileNames.value(subjobs().at(0)).second)
                     );
 
-    m_initialJobCount = subjobs().size();
-
-    qCDebug(ARK) << "Starting first job";
-
+    m_isExtracting = true;
     subjobs().at(0)->start();
 }
 
@@ -172,6 +225,14 @@ void BatchExtract::slotResult(KJob *job)
 
         removeSubjob(job);
 
+        // The archives not extracted yet don't need to be listed anymore. The
+        // listings still running are stopped when their archives are deleted.
+        m_pendingListings.clear();
+        foreach (Kerfuffle::Archive *archive, m_runningListings) {
+            disconnect(archive, &Kerfuffle::Archive::metaDataLoaded, this, Q_NULLPTR);
+        }
+        m_runningListings.clear();
+
         if (job->error() != KJob::KilledJobError) {
             KMessageBox::error(NULL, job->errorText().isEmpty() ?
                                      i18n("There was an error during extraction.") : job->errorText());
@@ -184,7 +245,12 @@ void BatchExtract::slotResult(KJob *job)
         removeSubjob(job);
     }
 
-    if (!hasSubjobs()) {
+    m_isExtracting = false;
+    m_finishedJobCount++;
+
+    if (!hasSubjobs() && (!m_pendingListings.isEmpty() || !m_runningListings.isEmpty())) {
+        qCDebug(ARK) << "Waiting for the next archive to be listed";
+    } else if (!hasSubjobs()) {
         if (openDestinationAfterExtraction()) {
             QUrl destination(destinationFolder());
             destination.setPath(QDir::cleanPath(destination.path()));
@@ -195,12 +261,7 @@ void BatchExtract::slotResult(KJob *job)
         emitResult();
     } else {
         qCDebug(ARK) << "Starting the next job";
-        emit description(this,
-                         i18n("Extracting Files"),
-                         qMakePair(i18n("Source archive"), m_fileNames.value(subjobs().at(0)).first),
-                         qMakePair(i18n("Destination"), m_fileNames.value(subjobs().at(0)).second)
-                        );
-        subjobs().at(0)->start();
+        startNextExtraction();
     }
 }
 
@@ -208,7 +269,7 @@ void BatchExtract::forwardProgress(KJob *job, unsigned long percent)
 {
     Q_UNUSED(job)
     int jobPart = 100 / m_initialJobCount;
-    setPercent(jobPart *(m_initialJobCount - subjobs().size()) + percent / m_initialJobCount);
+    setPercent(jobPart * m_finishedJobCount + percent / m_initialJobCount);
 }
 
 bool BatchExtract::addInput(const QUrl& url)
@@ -211,12 +211,34 @@ private slots:
      * Does the real work for start() and extracts all scheduled files.
      *
      * Each extraction job is started after the last one finishes.
-     * The jobs are executed in the order they were added via addInput().
+     * Without automatic subfolders, the jobs are executed in the order they
+     * were added via addInput(). Otherwise the archives are first listed
+     * concurrently, and each one is extracted once its listing is done.
      */
     void slotStartJob();
 
 private:
+    /**
+     * Loads the metadata of the next archive whose subfolder is not yet known.
+     */
+    void startNextListing();
+
+    /**
+     * Schedules the extraction of @p archive, whose metadata has been loaded,
+     * and lists the next archive.
+     */
+    void onMetaDataLoaded(Kerfuffle::Archive *archive);
+
+    /**
+     * Starts the first scheduled extraction, unless one is running.
+     */
+    void startNextExtraction();
+
     int m_initialJobCount;
+    int m_finishedJobCount;
+    bool m_isExtracting;
+    QList<Kerfuffle::Archive*> m_pendingListings;
+    QList<Kerfuffle::Archive*> m_runningListings;
     QMap<KJob*, QPair<QString, QString> > m_fileNames;
     bool m_autoSubfolder;
 
@@ -90,6 +90,12 @@ void AddDialogTest::testBasicWidgets_data()
     } else {
         qDebug() << "tar.lrzip format not available, skipping test.";
     }
+
+    if (writeMimeTypes.contains(QStringLiteral("application/x-zstd-compressed-tar"))) {
+        QTest::newRow("tarzstd") << QStringLiteral("application/x-zstd-compressed-tar") << true << 3 << 7;
+    } else {
+        qDebug() << "tar.zst format not available, skipping test.";
+    }
 }
 
 void AddDialogTest::testBasicWidgets()
@@ -114,7 +120,7 @@ void AddDialogTest::testBasicWidgets()
         auto compLevelSlider = dialog->optionsDialog->findChild<QSlider*>(QStringLiteral("compLevelSlider"));
         QVERIFY(compLevelSlider);
 
-        const KPluginMetaData metadata = PluginManager().preferredPluginFor(mime)->metaData();
+        const KPluginMetaData metadata = PluginManager().preferredWritePluginFor(mime)->metaData();
         const ArchiveFormat archiveFormat = ArchiveFormat::fromMetadata(mime, metadata);
         QVERIFY(archiveFormat.isValid());
 
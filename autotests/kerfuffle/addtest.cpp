@@ -25,6 +25,8 @@
 
 #include "autotests/testhelper/testhelper.h"
 
+#include <unistd.h>
+
 using namespace Kerfuffle;
 
 class AddTest : public QObject
@@ -37,6 +39,7 @@ void addAllFormatsRows(const QString testName, const QString archiveName, QList<
             << QStringLiteral("7z")
             << QStringLiteral("rar")
             << QStringLiteral("tar.bz2")
+            << QStringLiteral("tar.zst")
             << QStringLiteral("zip");
 
     foreach (QString format, formats) {
@@ -51,6 +54,9 @@ void addAllFormatsRows(const QString testName, const QString archiveName, QList<
 private Q_SLOTS:
     void testAdding_data();
     void testAdding();
+    void testReplacing_data();
+    void testReplacing();
+    void testDeduplication();
 };
 
 QTEST_GUILESS_MAIN(AddTest)
@@ -106,7 +112,7 @@ void AddTest::testAdding()
     QFETCH(QString, archiveName);
     const QString archivePath = temporaryDir.path() + QLatin1Char('/') + archiveName;
     Q_ASSERT(QFile::copy(QFINDTESTDATA(QStringLiteral("data/") + archiveName), archivePath));
-    Archive *archive = Archive::create(archivePath, this);
+    Archive *archive = Archive::createEditable(archivePath, QString(), this);
     QVERIFY(archive);
 
     if (!archive->isValid()) {
@@ -121,11 +127,152 @@ void AddTest::testAdding()
     CompressionOptions options = CompressionOptions();
     options.insert(QStringLiteral("GlobalWorkDir"), QFINDTESTDATA("data"));
     AddJob *addJob = archive->addFiles(files, destination, options);
+    QList<Archive::Entry*> addedEntries;
+    connect(addJob, &Job::newEntry, this, [&addedEntries](Archive::Entry *entry) { addedEntries << entry; });
     TestHelper::startAndWaitForResult(addJob);
 
     QList<Archive::Entry*> resultedEntries = TestHelper::getEntryList(archive);
     TestHelper::verifyAddedEntriesWithDestination(files, destination, oldEntries, resultedEntries);
 
+    // Only the entries written are reported, the archive is not listed again.
+    TestHelper::verifyAddedEntriesWithDestination(files, destination, QList<Archive::Entry*>(), addedEntries);
+    QVERIFY(addedEntries.size() < resultedEntries.size());
+
+    archive->deleteLater();
+}
+
+void AddTest::testReplacing_data()
+{
+    QTest::addColumn<QString>("archiveName");
+
+    QTest::newRow("7z") << QStringLiteral("test.7z");
+    QTest::newRow("rar") << QStringLiteral("test.rar");
+    QTest::newRow("zip") << QStringLiteral("test.zip");
+}
+
+void AddTest::testReplacing()
+{
+    QTemporaryDir temporaryDir;
+
+    QFETCH(QString, archiveName);
+    const QString archivePath = temporaryDir.path() + QLatin1Char('/') + archiveName;
+    QVERIFY(QFile::copy(QFINDTESTDATA(QStringLiteral("data/") + archiveName), archivePath));
+    Archive *archive = Archive::createEditable(archivePath, QString(), this);
+    QVERIFY(archive);
+
+    if (!archive->isValid()) {
+        QSKIP("Could not find a plugin to handle the archive. Skipping test.", SkipSingle);
+    }
+
+    Archive::Entry *replaced = Q_NULLPTR;
+    foreach (Archive::Entry *entry, TestHelper::getEntryList(archive)) {
+        if (!entry->isDir() && entry->property("compressedSize").toULongLong() > 0) {
+            replaced = entry;
+            break;
+        }
+    }
+    QVERIFY(replaced);
+    const QString path = replaced->fullPath();
+
+    QDir workDir(temporaryDir.path() + QStringLiteral("/work"));
+    QVERIFY(workDir.mkpath(QFileInfo(path).path()));
+    QFile file(workDir.filePath(path));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(1000, 'a'));
+    file.close();
+
+    CompressionOptions options = CompressionOptions();
+    options.insert(QStringLiteral("GlobalWorkDir"), workDir.path());
+    AddJob *addJob = archive->addFiles(QList<Archive::Entry*> { new Archive::Entry(this, path) }, new Archive::Entry(this), options);
+    QList<Archive::Entry*> addedEntries;
+    connect(addJob, &Job::newEntry, this, [&addedEntries](Archive::Entry *entry) { addedEntries << entry; });
+    TestHelper::startAndWaitForResult(addJob);
+
+    QCOMPARE(addedEntries.size(), 1);
+    Archive::Entry *added = addedEntries.first();
+    QCOMPARE(added->fullPath(), path);
+    QCOMPARE(added->property("size").toULongLong(), qulonglong(1000));
+
+    // The compressed size is not known before the archive is listed again, so the
+    // model keeps the one of the replaced entry.
+    QVERIFY(!added->compressedSizeIsSet);
+
+    archive->deleteLater();
+}
+
+void AddTest::testDeduplication()
+{
+    QTemporaryDir temporaryDir;
+    QDir workDir(temporaryDir.path());
+    QVERIFY(workDir.mkpath(QStringLiteral("tree")));
+
+    const QByteArray content(100 * 1024, 'a');
+    const QStringList fileNames = QStringList() << QStringLiteral("tree/copy.txt")
+                                                << QStringLiteral("tree/original.txt")
+                                                << QStringLiteral("tree/other.txt");
+    foreach (const QString &fileName, fileNames) {
+        QFile file(workDir.filePath(fileName));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(fileName.endsWith(QLatin1String("other.txt")) ? QByteArray(content.size(), 'b') : content);
+    }
+    QCOMPARE(::link(QFile::encodeName(workDir.filePath(QStringLiteral("tree/original.txt"))).constData(),
+                    QFile::encodeName(workDir.filePath(QStringLiteral("tree/zlink.txt"))).constData()), 0);
+
+    Archive *archive = Archive::createEditable(workDir.filePath(QStringLiteral("dedup.tar")), QString(), this);
+    QVERIFY(archive);
+
+    if (!archive->isValid()) {
+        QSKIP("Could not find a plugin to handle the archive. Skipping test.", SkipSingle);
+    }
+
+    CompressionOptions options = CompressionOptions();
+    options.insert(QStringLiteral("GlobalWorkDir"), temporaryDir.path());
+    options.insert(QStringLiteral("DeduplicateContent"), true);
+    AddJob *addJob = archive->addFiles(QList<Archive::Entry*> { new Archive::Entry(this, QStringLiteral("tree/")) },
+                                       Q_NULLPTR, options);
+
+    // The job deletes itself once finished.
+    qlonglong bytesSaved = -1;
+    connect(addJob, &KJob::result, this, [addJob, &bytesSaved]() { bytesSaved = addJob->bytesSaved(); });
+    TestHelper::startAndWaitForResult(addJob);
+
+    // The copy and the hardlink to the original are not stored again.
+    QCOMPARE(bytesSaved, qlonglong(2 * content.size()));
+    QCOMPARE(TestHelper::getEntryList(archive).size(), 5);
+
+    const auto readFile = [](const QString &fileName) {
+        QFile file(fileName);
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    };
+
+    ExtractionOptions extractionOptions;
+    extractionOptions[QStringLiteral("PreservePaths")] = true;
+
+    // Every link is extracted with the data of the file stored first.
+    QTemporaryDir addedDir;
+    TestHelper::startAndWaitForResult(archive->extractFiles(QList<Archive::Entry*>(), addedDir.path(), extractionOptions));
+    foreach (const QString &fileName, QStringList() << fileNames << QStringLiteral("tree/zlink.txt")) {
+        QCOMPARE(readFile(addedDir.path() + QLatin1Char('/') + fileName), readFile(workDir.filePath(fileName)));
+    }
+
+    // A link is extracted alone with the data of its target.
+    QTemporaryDir linkDir;
+    TestHelper::startAndWaitForResult(archive->extractFiles(QList<Archive::Entry*> { new Archive::Entry(this, QStringLiteral("tree/zlink.txt")) },
+                                                            linkDir.path(), extractionOptions));
+    QCOMPARE(readFile(linkDir.path() + QStringLiteral("/tree/zlink.txt")), content);
+    QVERIFY(!QFile::exists(linkDir.path() + QStringLiteral("/tree/copy.txt")));
+
+    // The links to a deleted file keep its data.
+    QList<Archive::Entry*> deletedEntries { new Archive::Entry(this, QStringLiteral("tree/copy.txt")) };
+    TestHelper::startAndWaitForResult(archive->deleteFiles(deletedEntries));
+
+    QTemporaryDir deletedDir;
+    TestHelper::startAndWaitForResult(archive->extractFiles(QList<Archive::Entry*>(), deletedDir.path(), extractionOptions));
+    QVERIFY(!QFile::exists(deletedDir.path() + QStringLiteral("/tree/copy.txt")));
+    QCOMPARE(readFile(deletedDir.path() + QStringLiteral("/tree/original.txt")), content);
+    QCOMPARE(readFile(deletedDir.path() + QStringLiteral("/tree/zlink.txt")), content);
+    QCOMPARE(readFile(deletedDir.path() + QStringLiteral("/tree/other.txt")), QByteArray(content.size(), 'b'));
+
     archive->deleteLater();
 }
 
@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kerfuffle/archiveentry.h"
+#include "kerfuffle/cliinterface.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace Kerfuffle;
+
+static const qulonglong s_megabyte = 1024 * 1024;
+
+/**
+ * Runs a shell script as extraction program, which writes the files it is given
+ * and logs every run, and true for every other operation.
+ */
+class FakeCliPlugin : public CliInterface
+{
+    Q_OBJECT
+
+public:
+    FakeCliPlugin(QObject *parent, const QVariantList &args, const QString &extractProgram)
+        : CliInterface(parent, args)
+        , m_extractProgram(extractProgram)
+    {
+    }
+
+    void resetParsing() Q_DECL_OVERRIDE
+    {
+    }
+
+    ParameterList parameterList() const Q_DECL_OVERRIDE
+    {
+        ParameterList p;
+        p[ListProgram] = p[AddProgram] = p[DeleteProgram] = p[MoveProgram] = QStringList() << QStringLiteral("true");
+        p[ListArgs] = p[DeleteArgs] = p[MoveArgs] = QStringList() << QStringLiteral("$Archive");
+        p[AddArgs] = QStringList() << QStringLiteral("$Archive") << QStringLiteral("$Files");
+        p[ExtractProgram] = QStringList() << m_extractProgram;
+        p[ExtractArgs] = QStringList() << QStringLiteral("$Archive") << QStringLiteral("$Files");
+        p[PreservePathSwitch] = QStringList() << QString() << QString();
+        p[FileExistsExpression] = QStringList();
+        p[FileExistsInput] = QStringList();
+        return p;
+    }
+
+    bool readListLine(const QString &line) Q_DECL_OVERRIDE
+    {
+        Q_UNUSED(line)
+        return true;
+    }
+
+private:
+    QString m_extractProgram;
+};
+
+class CliInterfaceTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    CliInterfaceTest()
+        : m_tempDir(Q_NULLPTR)
+        , m_plugin(Q_NULLPTR)
+    {
+    }
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testSolidBlockCache();
+    void testSolidBlockCacheEviction();
+    void testPasswordProtectedEntry();
+    void testSolidBlocksClearedByChanges_data();
+    void testSolidBlocksClearedByChanges();
+
+private:
+    Archive::Entry *addEntry(const QString &fullPath, int block, qulonglong size = s_megabyte);
+    bool extract(Archive::Entry *entry);
+    QStringList extractionRuns() const;
+
+    QTemporaryDir *m_tempDir;
+    FakeCliPlugin *m_plugin;
+};
+
+QTEST_GUILESS_MAIN(CliInterfaceTest)
+
+void CliInterfaceTest::init()
+{
+#ifdef Q_OS_WIN
+    QSKIP("The fake extraction program is a shell script.", SkipSingle);
+#endif
+
+    m_tempDir = new QTemporaryDir();
+    QVERIFY(m_tempDir->isValid());
+
+    const QString program = m_tempDir->path() + QStringLiteral("/fakeextract");
+    QFile script(program);
+    QVERIFY(script.open(QIODevice::WriteOnly));
+    script.write("#!/bin/sh\n"
+                 "archive=\"$1\"\n"
+                 "shift\n"
+                 "echo \"$*\" >> \"$archive.log\"\n"
+                 "for file in \"$@\"; do\n"
+                 "    mkdir -p \"$(dirname \"$file\")\"\n"
+                 "    printf '%s' \"$file\" > \"$file\"\n"
+                 "done\n");
+    script.close();
+    QVERIFY(script.setPermissions(script.permissions() | QFileDevice::ExeOwner));
+
+    const QVariantList args = QVariantList() << QVariant(m_tempDir->path() + QStringLiteral("/archive.7z"));
+    m_plugin = new FakeCliPlugin(this, args, program);
+}
+
+void CliInterfaceTest::cleanup()
+{
+    delete m_plugin;
+    m_plugin = Q_NULLPTR;
+    delete m_tempDir;
+    m_tempDir = Q_NULLPTR;
+}
+
+Archive::Entry *CliInterfaceTest::addEntry(const QString &fullPath, int block, qulonglong size)
+{
+    Archive::Entry *entry = new Archive::Entry(m_plugin, fullPath);
+    entry->setProperty("size", size);
+    m_plugin->setSolidBlock(entry, block);
+    return entry;
+}
+
+bool CliInterfaceTest::extract(Archive::Entry *entry)
+{
+    // Every extraction goes to a new directory, as when previewing.
+    QTemporaryDir destination;
+    ExtractionOptions options;
+    options[QStringLiteral("PreservePaths")] = true;
+
+    QSignalSpy spy(m_plugin, &ReadOnlyArchiveInterface::finished);
+    m_plugin->extractFiles(QList<Archive::Entry*>() << entry, destination.path(), options);
+    if (spy.isEmpty() && !spy.wait()) {
+        return false;
+    }
+
+    QFile file(destination.path() + QLatin1Char('/') + entry->fullPath());
+    return spy.first().at(0).toBool() && file.open(QIODevice::ReadOnly) && file.readAll() == entry->fullPath().toUtf8();
+}
+
+QStringList CliInterfaceTest::extractionRuns() const
+{
+    QFile log(m_tempDir->path() + QStringLiteral("/archive.7z.log"));
+    if (!log.open(QIODevice::ReadOnly)) {
+        return QStringList();
+    }
+    return QString::fromUtf8(log.readAll()).split(QLatin1Char('\n'), QString::SkipEmptyParts);
+}
+
+void CliInterfaceTest::testSolidBlockCache()
+{
+    Archive::Entry *first = addEntry(QStringLiteral("dir/first.txt"), 0);
+    Archive::Entry *second = addEntry(QStringLiteral("dir/second.txt"), 0);
+    Archive::Entry *other = addEntry(QStringLiteral("other.txt"), 1);
+
+    // The first file opened extracts the whole block.
+    QVERIFY(extract(first));
+    QCOMPARE(extractionRuns(), QStringList() << QStringLiteral("dir/first.txt dir/second.txt"));
+
+    // The other files of the block are taken from the cache.
+    QVERIFY(extract(second));
+    QVERIFY(extract(first));
+    QCOMPARE(extractionRuns().size(), 1);
+
+    // A block with a single file is not worth caching.
+    QVERIFY(extract(other));
+    QCOMPARE(extractionRuns().last(), QStringLiteral("other.txt"));
+}
+
+void CliInterfaceTest::testSolidBlockCacheEviction()
+{
+    // Four blocks of 60 MiB fit in the cache, not five.
+    QList<Archive::Entry*> entries;
+    for (int block = 0; block < 5; ++block) {
+        entries << addEntry(QStringLiteral("a%1.bin").arg(block), block, 30 * s_megabyte);
+        addEntry(QStringLiteral("b%1.bin").arg(block), block, 30 * s_megabyte);
+    }
+
+    for (int block = 0; block < 4; ++block) {
+        QVERIFY(extract(entries.at(block)));
+    }
+    QCOMPARE(extractionRuns().size(), 4);
+
+    QVERIFY(extract(entries.at(0)));
+    QCOMPARE(extractionRuns().size(), 4);
+
+    // Extracting the fifth block drops the ones cached before.
+    QVERIFY(extract(entries.at(4)));
+    QCOMPARE(extractionRuns().size(), 5);
+
+    QVERIFY(extract(entries.at(0)));
+    QCOMPARE(extractionRuns().size(), 6);
+    QVERIFY(extract(entries.at(4)));
+    QCOMPARE(extractionRuns().size(), 6);
+}
+
+void CliInterfaceTest::testPasswordProtectedEntry()
+{
+    Archive::Entry *encrypted = addEntry(QStringLiteral("encrypted.txt"), 0);
+    addEntry(QStringLiteral("plain.txt"), 0);
+    encrypted->setProperty("isPasswordProtected", true);
+
+    QVERIFY(extract(encrypted));
+    QVERIFY(extract(encrypted));
+    QCOMPARE(extractionRuns(), QStringList() << QStringLiteral("encrypted.txt") << QStringLiteral("encrypted.txt"));
+}
+
+void CliInterfaceTest::testSolidBlocksClearedByChanges_data()
+{
+    QTest::addColumn<int>("operation");
+
+    QTest::newRow("add") << int(ReadWriteArchiveInterface::Add);
+    QTest::newRow("delete") << int(ReadWriteArchiveInterface::Delete);
+    QTest::newRow("move") << int(ReadWriteArchiveInterface::Move);
+}
+
+void CliInterfaceTest::testSolidBlocksClearedByChanges()
+{
+    QFETCH(int, operation);
+
+    Archive::Entry *first = addEntry(QStringLiteral("first.txt"), 0);
+    Archive::Entry *second = addEntry(QStringLiteral("second.txt"), 0);
+
+    QVERIFY(extract(first));
+    QVERIFY(extract(second));
+    QCOMPARE(extractionRuns().size(), 1);
+
+    QFile added(m_tempDir->path() + QStringLiteral("/added.txt"));
+    QVERIFY(added.open(QIODevice::WriteOnly));
+    added.close();
+
+    QSignalSpy spy(m_plugin, &ReadOnlyArchiveInterface::finished);
+    switch (operation) {
+    case ReadWriteArchiveInterface::Add: {
+        CompressionOptions options;
+        options[QStringLiteral("GlobalWorkDir")] = m_tempDir->path();
+        QVERIFY(m_plugin->addFiles(QList<Archive::Entry*>() << new Archive::Entry(m_plugin, QStringLiteral("added.txt")),
+                                   Q_NULLPTR, options));
+        break;
+    }
+    case ReadWriteArchiveInterface::Delete:
+        QVERIFY(m_plugin->deleteFiles(QList<Archive::Entry*>() << new Archive::Entry(m_plugin, QStringLiteral("third.txt"))));
+        break;
+    case ReadWriteArchiveInterface::Move:
+        QVERIFY(m_plugin->moveFiles(QList<Archive::Entry*>() << new Archive::Entry(m_plugin, QStringLiteral("third.txt")),
+                                    new Archive::Entry(m_plugin, QStringLiteral("dir/")), CompressionOptions()));
+        break;
+    }
+    QVERIFY(spy.wait());
+    QVERIFY(spy.first().at(0).toBool());
+
+    // The blocks are known again only once the archive is listed again.
+    QVERIFY(extract(second));
+    QCOMPARE(extractionRuns().last(), QStringLiteral("second.txt"));
+}
+
+#include "cliinterfacetest.moc"
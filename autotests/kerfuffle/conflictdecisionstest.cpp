@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kerfuffle/archiveentry.h"
+#include "kerfuffle/conflictdecisions.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace Kerfuffle;
+
+class ConflictDecisionsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void testFindConflicts_data();
+    void testFindConflicts();
+    void testDecisions();
+
+private:
+    QTemporaryDir m_destination;
+    QList<Archive::Entry*> m_entries;
+};
+
+void ConflictDecisionsTest::initTestCase()
+{
+    QVERIFY(m_destination.isValid());
+
+    const QDir destDir(m_destination.path());
+    QVERIFY(destDir.mkpath(QStringLiteral("dir1")));
+    QVERIFY(destDir.mkpath(QStringLiteral("dir1/dir2")));
+    foreach (const QString &name, QStringList() << QStringLiteral("a.txt") << QStringLiteral("dir1/b.txt") << QStringLiteral("dir2/c.txt")) {
+        QFile file(destDir.absoluteFilePath(name));
+        if (!QDir(QFileInfo(file).path()).exists()) {
+            QVERIFY(destDir.mkpath(QFileInfo(name).path()));
+        }
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+
+    foreach (const QString &path, QStringList() << QStringLiteral("a.txt")
+                                                << QStringLiteral("dir1/")
+                                                << QStringLiteral("dir1/b.txt")
+                                                << QStringLiteral("dir1/dir2/")
+                                                << QStringLiteral("dir1/dir2/c.txt")
+                                                << QStringLiteral("dir1/d.txt")) {
+        Archive::Entry *entry = new Archive::Entry(Q_NULLPTR, path);
+        entry->setIsDirectory(path.endsWith(QLatin1Char('/')));
+        m_entries << entry;
+    }
+}
+
+void ConflictDecisionsTest::cleanupTestCase()
+{
+    qDeleteAll(m_entries);
+}
+
+void ConflictDecisionsTest::testFindConflicts_data()
+{
+    QTest::addColumn<bool>("preservePaths");
+    QTest::addColumn<QString>("rootNode");
+    QTest::addColumn<QStringList>("expectedConflicts");
+
+    QTest::newRow("preserve paths")
+            << true << QString()
+            << (QStringList() << QStringLiteral("a.txt") << QStringLiteral("dir1/b.txt"));
+
+    QTest::newRow("without paths")
+            << false << QString()
+            << (QStringList() << QStringLiteral("a.txt"));
+
+    QTest::newRow("root node removed")
+            << true << QStringLiteral("dir1/")
+            << (QStringList() << QStringLiteral("a.txt") << QStringLiteral("dir2/c.txt"));
+}
+
+void ConflictDecisionsTest::testFindConflicts()
+{
+    QFETCH(bool, preservePaths);
+    QFETCH(QString, rootNode);
+    QFETCH(QStringList, expectedConflicts);
+
+    ExtractionOptions options;
+    options[QStringLiteral("PreservePaths")] = preservePaths;
+    options[QStringLiteral("RemoveRootNode")] = !rootNode.isEmpty();
+
+    foreach (Archive::Entry *entry, m_entries) {
+        entry->rootNode = entry->fullPath().startsWith(rootNode) ? rootNode : QString();
+    }
+
+    const QDir destDir(m_destination.path());
+    QStringList expectedPaths;
+    foreach (const QString &conflict, expectedConflicts) {
+        expectedPaths << destDir.absoluteFilePath(conflict);
+    }
+    expectedPaths.sort();
+
+    QCOMPARE(ConflictDecisions::findConflicts(m_entries, m_destination.path(), options), expectedPaths);
+}
+
+void ConflictDecisionsTest::testDecisions()
+{
+    ExtractionOptions options;
+    QCOMPARE(ConflictDecisions(options).decisionFor(QStringLiteral("/tmp/a.txt")), ConflictDecisions::Ask);
+
+    ConflictDecisions::store(options,
+                             QStringList() << QStringLiteral("/tmp/a.txt"),
+                             QStringList() << QStringLiteral("/tmp/dir/b.txt"));
+
+    const ConflictDecisions decisions(options);
+    QCOMPARE(decisions.decisionFor(QStringLiteral("/tmp/a.txt")), ConflictDecisions::Overwrite);
+    QCOMPARE(decisions.decisionFor(QStringLiteral("/tmp/dir/../dir/b.txt")), ConflictDecisions::Skip);
+    QCOMPARE(decisions.decisionFor(QStringLiteral("/tmp/c.txt")), ConflictDecisions::Ask);
+}
+
+QTEST_GUILESS_MAIN(ConflictDecisionsTest)
+
+#include "conflictdecisionstest.moc"
@@ -173,7 +173,7 @@ void CopyTest::testCopying()
     QFETCH(QString, archiveName);
     const QString archivePath = temporaryDir.path() + QLatin1Char('/') + archiveName;
     Q_ASSERT(QFile::copy(QFINDTESTDATA(QStringLiteral("data/") + archiveName), archivePath));
-    Archive *archive = Archive::create(archivePath, this);
+    Archive *archive = Archive::createEditable(archivePath, QString(), this);
     QVERIFY(archive);
 
     if (!archive->isValid()) {
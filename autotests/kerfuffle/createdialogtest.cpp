@@ -89,6 +89,12 @@ void CreateDialogTest::testBasicWidgets_data()
     } else {
         qDebug() << "tar.lrzip format not available in CreateDialog, skipping test.";
     }
+
+    if (writeMimeTypes.contains(QStringLiteral("application/x-zstd-compressed-tar"))) {
+        QTest::newRow("tarzstd") << QStringLiteral("application/x-zstd-compressed-tar");
+    } else {
+        qDebug() << "tar.zst format not available in CreateDialog, skipping test.";
+    }
 }
 
 void CreateDialogTest::testBasicWidgets()
@@ -25,12 +25,19 @@
  */
 
 #include "kerfuffle/archive_kerfuffle.h"
+#include "kerfuffle/archiveentry.h"
 #include "kerfuffle/jobs.h"
+#include "kerfuffle/pluginmanager.h"
 
 #include <QDirIterator>
+#include <QSignalSpy>
 #include <QStandardPaths>
 #include <QTest>
 
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
 using namespace Kerfuffle;
 
 class ExtractTest : public QObject
@@ -40,12 +47,42 @@ class ExtractTest : public QObject
 private Q_SLOTS:
     void testProperties_data();
     void testProperties();
+    void testMetaData_data();
+    void testMetaData();
     void testExtraction_data();
     void testExtraction();
+    void testEntryDevice_data();
+    void testEntryDevice();
+    void testSparseFileRoundTrip();
+    void testStoredEntryExtraction();
+    void testParallelExtraction_data();
+    void testParallelExtraction();
 };
 
 QTEST_GUILESS_MAIN(ExtractTest)
 
+/**
+ * Returns the number of bytes actually allocated on disk for @p fileName.
+ */
+static qint64 allocatedSize(const QString &fileName)
+{
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (stat(QFile::encodeName(fileName).constData(), &st) == 0) {
+        return qint64(st.st_blocks) * 512;
+    }
+#endif
+    return QFileInfo(fileName).size();
+}
+
+static void runJob(KJob *job)
+{
+    QEventLoop eventLoop;
+    QObject::connect(job, &KJob::result, &eventLoop, &QEventLoop::quit);
+    job->start();
+    eventLoop.exec(); // krazy:exclude=crashy
+}
+
 void ExtractTest::testProperties_data()
 {
     QTest::addColumn<QString>("archivePath");
@@ -159,6 +196,17 @@ void ExtractTest::testProperties_data()
         qDebug() << "lz4 executable not found in path. Skipping lz4 test.";
     }
 
+    // Only run test for zstd-compressed tar if libarchive is recent enough.
+    if (PluginManager().supportedMimeTypes().contains(QStringLiteral("application/x-zstd-compressed-tar"))) {
+        QTest::newRow("zstd-compressed tarball")
+                << QFINDTESTDATA("data/simplearchive.tar.zst")
+                << QStringLiteral("simplearchive")
+                << false << false << false << Archive::Unencrypted
+                << QStringLiteral("simplearchive");
+    } else {
+        qDebug() << "tar.zst format not available. Skipping zstd test.";
+    }
+
     QTest::newRow("xar archive")
             << QFINDTESTDATA("data/simplearchive.xar")
             << QStringLiteral("simplearchive")
@@ -209,6 +257,56 @@ void ExtractTest::testProperties()
     archive->deleteLater();
 }
 
+void ExtractTest::testMetaData_data()
+{
+    QTest::addColumn<QString>("archivePath");
+    // Whether the size estimated without listing is the unpacked size,
+    // is only an upper bound (tar headers included) or is unknown.
+    QTest::addColumn<bool>("isExactEstimate");
+    QTest::addColumn<bool>("hasEstimate");
+
+    QTest::newRow("zip") << QFINDTESTDATA("data/test.zip") << true << true;
+    QTest::newRow("mimetype child of application/zip") << QFINDTESTDATA("data/test.odt") << true << true;
+    QTest::newRow("gzip-compressed tarball") << QFINDTESTDATA("data/simplearchive.tar.gz") << false << true;
+    QTest::newRow("bzip2-compressed tarball") << QFINDTESTDATA("data/simplearchive.tar.bz2") << false << false;
+}
+
+void ExtractTest::testMetaData()
+{
+    QFETCH(QString, archivePath);
+    Archive *archive = Archive::create(archivePath, this);
+    QVERIFY(archive);
+
+    if (!archive->isValid()) {
+        QSKIP("Could not find a plugin to handle the archive. Skipping test.", SkipSingle);
+    }
+
+    QVERIFY(!archive->hasMetaData());
+    const qulonglong estimatedSize = archive->estimatedUnpackedSize();
+
+    QSignalSpy spy(archive, &Archive::metaDataLoaded);
+    archive->loadMetaData();
+    QVERIFY(spy.wait());
+    QVERIFY(archive->hasMetaData());
+    QCOMPARE(archive->estimatedUnpackedSize(), archive->unpackedSize());
+
+    QFETCH(bool, isExactEstimate);
+    QFETCH(bool, hasEstimate);
+    if (!hasEstimate) {
+        QCOMPARE(estimatedSize, qulonglong(0));
+    } else if (isExactEstimate) {
+        QCOMPARE(estimatedSize, archive->unpackedSize());
+    } else {
+        QVERIFY(estimatedSize > archive->unpackedSize());
+    }
+
+    // Already loaded, the signal is still emitted.
+    archive->loadMetaData();
+    QVERIFY(spy.wait());
+
+    archive->deleteLater();
+}
+
 void ExtractTest::testExtraction_data()
 {
     QTest::addColumn<QString>("archivePath");
@@ -493,6 +591,28 @@ void ExtractTest::testExtraction_data()
         qDebug() << "lz4 executable not found in path. Skipping lz4 test.";
     }
 
+    // Only run test for zstd-compressed tar if libarchive is recent enough.
+    if (PluginManager().supportedMimeTypes().contains(QStringLiteral("application/x-zstd-compressed-tar"))) {
+        archivePath = QFINDTESTDATA("data/simplearchive.tar.zst");
+        QTest::newRow("extract selected entries from a zstd-compressed tarball without path")
+                << archivePath
+                << QList<Archive::Entry*> {
+                       new Archive::Entry(this, QStringLiteral("file3.txt"), QString()),
+                       new Archive::Entry(this, QStringLiteral("dir2/file22.txt"), QString())
+                   }
+                << ExtractionOptions()
+                << 2;
+
+        archivePath = QFINDTESTDATA("data/simplearchive.tar.zst");
+        QTest::newRow("extract all entries from a zstd-compressed tarball with path")
+                << archivePath
+                << QList<Archive::Entry*>()
+                << optionsPreservePaths
+                << 7;
+    } else {
+        qDebug() << "tar.zst format not available. Skipping zstd test.";
+    }
+
     archivePath = QFINDTESTDATA("data/simplearchive.xar");
     QTest::newRow("extract selected entries from a xar archive without path")
             << archivePath
@@ -549,4 +669,279 @@ void ExtractTest::testExtraction()
     archive->deleteLater();
 }
 
+void ExtractTest::testEntryDevice_data()
+{
+    QTest::addColumn<QString>("archivePath");
+    QTest::addColumn<QString>("entryPath");
+    QTest::addColumn<QByteArray>("expectedContents");
+
+    QTest::newRow("stream an entry from a gzip-compressed tarball")
+            << QFINDTESTDATA("data/simplearchive.tar.gz")
+            << QStringLiteral("aDir/b.txt")
+            << QByteArray("ark\n");
+
+    QTest::newRow("stream an entry from a bzip2-compressed tarball")
+            << QFINDTESTDATA("data/simplearchive.tar.bz2")
+            << QStringLiteral("dir1/file11.txt")
+            << QByteArray("file1line1\nfile1line2\nfile1line3");
+}
+
+void ExtractTest::testEntryDevice()
+{
+    QFETCH(QString, archivePath);
+    Archive *archive = Archive::create(archivePath, this);
+    QVERIFY(archive);
+
+    if (!archive->isValid()) {
+        QSKIP("Could not find a plugin to handle the archive. Skipping test.", SkipSingle);
+    }
+
+    QFETCH(QString, entryPath);
+    Archive::Entry entry(Q_NULLPTR, entryPath);
+    QScopedPointer<EntryDeviceJob> deviceJob(archive->openEntryDevice(&entry));
+    QVERIFY(deviceJob);
+    deviceJob->setAutoDelete(false);
+
+    QEventLoop eventLoop(this);
+    connect(deviceJob.data(), &KJob::result, &eventLoop, &QEventLoop::quit);
+    deviceJob->start();
+    eventLoop.exec(); // krazy:exclude=crashy
+
+    QScopedPointer<QIODevice> device(deviceJob->takeDevice());
+    if (!device) {
+        QSKIP("The plugin cannot stream archive entries. Skipping test.", SkipSingle);
+    }
+
+    QFETCH(QByteArray, expectedContents);
+    QCOMPARE(device->readAll(), expectedContents);
+    QVERIFY(device->atEnd());
+
+    archive->deleteLater();
+}
+
+void ExtractTest::testSparseFileRoundTrip()
+{
+    QTemporaryDir temporaryDir;
+    if (!temporaryDir.isValid()) {
+        QSKIP("Could not create a temporary directory. Skipping test.", SkipSingle);
+    }
+
+    const QString sourceDir = temporaryDir.path() + QStringLiteral("/source");
+    const QString destDir = temporaryDir.path() + QStringLiteral("/dest");
+    QVERIFY(QDir().mkpath(sourceDir));
+    QVERIFY(QDir().mkpath(destDir));
+
+    // A 10 GB file with 10 blocks of 1 MB of data, the rest being holes.
+    const qint64 fileSize = Q_INT64_C(10) * 1024 * 1024 * 1024;
+    const qint64 blockSize = 1024 * 1024;
+    const int blockCount = 10;
+
+    QFile sparseFile(sourceDir + QStringLiteral("/sparse.img"));
+    QVERIFY(sparseFile.open(QIODevice::WriteOnly));
+    if (!sparseFile.resize(fileSize)) {
+        QSKIP("Could not create a big sparse file. Skipping test.", SkipSingle);
+    }
+    for (int i = 0; i < blockCount; ++i) {
+        QVERIFY(sparseFile.seek(i * (fileSize / blockCount)));
+        QCOMPARE(sparseFile.write(QByteArray(blockSize, 'a' + i)), blockSize);
+    }
+    sparseFile.close();
+
+    if (allocatedSize(sparseFile.fileName()) > 2 * blockCount * blockSize) {
+        QSKIP("The filesystem does not support sparse files. Skipping test.", SkipSingle);
+    }
+
+    const QString archivePath = temporaryDir.path() + QStringLiteral("/sparse.tar");
+    Archive *archive = Archive::create(archivePath, this);
+    QVERIFY(archive);
+
+    if (!archive->isValid()) {
+        QSKIP("Could not find a plugin to handle the archive. Skipping test.", SkipSingle);
+    }
+
+    CompressionOptions compressionOptions;
+    compressionOptions.insert(QStringLiteral("GlobalWorkDir"), sourceDir);
+    runJob(archive->addFiles(QList<Archive::Entry*> {new Archive::Entry(this, QStringLiteral("sparse.img"))},
+                             new Archive::Entry(this),
+                             compressionOptions));
+
+    // Only the data blocks have been stored.
+    QVERIFY(QFileInfo(archivePath).size() < 2 * blockCount * blockSize);
+
+    ExtractionOptions extractionOptions;
+    extractionOptions.insert(QStringLiteral("PreservePaths"), true);
+    runJob(archive->extractFiles(QList<Archive::Entry*>(), destDir, extractionOptions));
+
+    const QString extractedPath = destDir + QStringLiteral("/sparse.img");
+    QCOMPARE(QFileInfo(extractedPath).size(), fileSize);
+    QVERIFY(allocatedSize(extractedPath) < 2 * blockCount * blockSize);
+
+    QFile extractedFile(extractedPath);
+    QVERIFY(extractedFile.open(QIODevice::ReadOnly));
+    for (int i = 0; i < blockCount; ++i) {
+        const qint64 blockStart = i * (fileSize / blockCount);
+        QVERIFY(extractedFile.seek(blockStart));
+        QCOMPARE(extractedFile.read(blockSize), QByteArray(blockSize, 'a' + i));
+        // Followed by a hole.
+        QCOMPARE(extractedFile.read(4096), QByteArray(4096, '\0'));
+    }
+
+    archive->deleteLater();
+}
+
+void ExtractTest::testStoredEntryExtraction()
+{
+    QTemporaryDir temporaryDir;
+    if (!temporaryDir.isValid()) {
+        QSKIP("Could not create a temporary directory. Skipping test.", SkipSingle);
+    }
+
+    const QString sourceDir = temporaryDir.path() + QStringLiteral("/source");
+    QVERIFY(QDir().mkpath(sourceDir));
+
+    // The small file shifts the data of the big one away from a block boundary,
+    // so that it is copied by copy_file_range() rather than reflinked.
+    QFile smallFile(sourceDir + QStringLiteral("/small.txt"));
+    QVERIFY(smallFile.open(QIODevice::WriteOnly));
+    QCOMPARE(smallFile.write(QByteArray(1000, 'x')), qint64(1000));
+    smallFile.close();
+
+    // A few MB of data which no filesystem would store as holes.
+    QByteArray bigData(6 * 1024 * 1024 + 123, Qt::Uninitialized);
+    quint32 seed = 42;
+    for (int i = 0; i < bigData.size(); ++i) {
+        seed = seed * 1103515245 + 12345;
+        bigData[i] = char(seed >> 16);
+    }
+    QFile bigFile(sourceDir + QStringLiteral("/big.bin"));
+    QVERIFY(bigFile.open(QIODevice::WriteOnly));
+    QCOMPARE(bigFile.write(bigData), qint64(bigData.size()));
+    bigFile.close();
+
+    // Entries of uncompressed tarballs are copied within the kernel.
+    const QString archivePath = temporaryDir.path() + QStringLiteral("/stored.tar");
+    Archive *archive = Archive::create(archivePath, this);
+    QVERIFY(archive);
+
+    if (!archive->isValid()) {
+        QSKIP("Could not find a plugin to handle the archive. Skipping test.", SkipSingle);
+    }
+
+    CompressionOptions compressionOptions;
+    compressionOptions.insert(QStringLiteral("GlobalWorkDir"), sourceDir);
+    runJob(archive->addFiles(QList<Archive::Entry*> {new Archive::Entry(this, QStringLiteral("small.txt")),
+                                                     new Archive::Entry(this, QStringLiteral("big.bin"))},
+                             new Archive::Entry(this),
+                             compressionOptions));
+
+    ExtractionOptions extractionOptions;
+    extractionOptions.insert(QStringLiteral("PreservePaths"), true);
+
+    // Both the whole archive and the selected entry.
+    const QString allDestDir = temporaryDir.path() + QStringLiteral("/all");
+    const QString selectedDestDir = temporaryDir.path() + QStringLiteral("/selected");
+    QVERIFY(QDir().mkpath(allDestDir));
+    QVERIFY(QDir().mkpath(selectedDestDir));
+    runJob(archive->extractFiles(QList<Archive::Entry*>(), allDestDir, extractionOptions));
+    runJob(archive->extractFiles(QList<Archive::Entry*> {new Archive::Entry(this, QStringLiteral("big.bin"))},
+                                 selectedDestDir, extractionOptions));
+
+    foreach (const QString &destDir, QStringList {allDestDir, selectedDestDir}) {
+        QFile extractedFile(destDir + QStringLiteral("/big.bin"));
+        QVERIFY(extractedFile.open(QIODevice::ReadOnly));
+        QCOMPARE(extractedFile.size(), qint64(bigData.size()));
+        QVERIFY(extractedFile.readAll() == bigData);
+    }
+
+    QFile extractedSmallFile(allDestDir + QStringLiteral("/small.txt"));
+    QVERIFY(extractedSmallFile.open(QIODevice::ReadOnly));
+    QCOMPARE(extractedSmallFile.readAll(), QByteArray(1000, 'x'));
+
+    archive->deleteLater();
+}
+
+void ExtractTest::testParallelExtraction_data()
+{
+    QTest::addColumn<QString>("archivePath");
+    QTest::addColumn<int>("expectedExtractedEntriesCount");
+
+    QTest::newRow("gzip-compressed tarball")
+            << QFINDTESTDATA("data/simplearchive.tar.gz")
+            << 4;
+
+    QTest::newRow("zip archive")
+            << QFINDTESTDATA("data/one_toplevel_folder.zip")
+            << 9;
+
+    QTest::newRow("7z archive")
+            << QFINDTESTDATA("data/one_toplevel_folder.7z")
+            << 9;
+}
+
+void ExtractTest::testParallelExtraction()
+{
+    const int jobsCount = 16;
+    const QString workingDir = QDir::currentPath();
+
+    QFETCH(QString, archivePath);
+    QFETCH(int, expectedExtractedEntriesCount);
+
+    ExtractionOptions options;
+    options[QStringLiteral("PreservePaths")] = true;
+
+    // Every job has its own archive, destination and thread (or process), so the
+    // extractions really run at the same time.
+    QList<Archive*> archives;
+    QList<QTemporaryDir*> destDirs;
+    QList<KJob*> jobs;
+    for (int i = 0; i < jobsCount; ++i) {
+        Archive *archive = Archive::create(archivePath, this);
+        QVERIFY(archive);
+        if (!archive->isValid()) {
+            qDeleteAll(archives);
+            delete archive;
+            qDeleteAll(destDirs);
+            QSKIP("Could not find a plugin to handle the archive. Skipping test.", SkipSingle);
+        }
+        archives << archive;
+
+        QTemporaryDir *destDir = new QTemporaryDir;
+        QVERIFY(destDir->isValid());
+        destDirs << destDir;
+
+        jobs << archive->extractFiles(QList<Archive::Entry*>(), destDir->path(), options);
+    }
+
+    QEventLoop eventLoop;
+    int finishedJobs = 0;
+    foreach (KJob *job, jobs) {
+        connect(job, &KJob::result, &eventLoop, [&]() {
+            if (++finishedJobs == jobsCount) {
+                eventLoop.quit();
+            }
+        });
+    }
+    foreach (KJob *job, jobs) {
+        job->start();
+    }
+    eventLoop.exec(); // krazy:exclude=crashy
+
+    foreach (QTemporaryDir *destDir, destDirs) {
+        int extractedEntriesCount = 0;
+        QDirIterator dirIt(destDir->path(), QDir::AllEntries | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (dirIt.hasNext()) {
+            extractedEntriesCount++;
+            dirIt.next();
+        }
+        QCOMPARE(extractedEntriesCount, expectedExtractedEntriesCount);
+    }
+
+    QCOMPARE(QDir::currentPath(), workingDir);
+
+    qDeleteAll(destDirs);
+    foreach (Archive *archive, archives) {
+        archive->deleteLater();
+    }
+}
+
 #include "extracttest.moc"
@@ -192,6 +192,14 @@ void JobsTest::testListJob()
 
     ListJob *listJob = new ListJob(iface);
     listJob->setAutoDelete(false);
+
+    // All the entries are published in batches before the result.
+    QStringList batchedEntryNames;
+    connect(listJob, &Job::newEntries, [&batchedEntryNames](const QVector<Archive::Entry*> &entries) {
+        foreach (Archive::Entry *entry, entries) {
+            batchedEntryNames << entry->fullPath();
+        }
+    });
     startAndWaitForResult(listJob);
 
     QFETCH(qlonglong, expectedExtractedFilesSize);
@@ -207,6 +215,7 @@ void JobsTest::testListJob()
     auto archiveEntries = listEntries(iface);
 
     QCOMPARE(archiveEntries.size(), expectedEntryNames.size());
+    QCOMPARE(batchedEntryNames, expectedEntryNames);
 
     for (int i = 0; i < archiveEntries.size(); i++) {
         QCOMPARE(archiveEntries.at(i)->fullPath(), expectedEntryNames.at(i));
@@ -323,8 +332,14 @@ void JobsTest::testRemoveEntries()
     }
 
     DeleteJob *deleteJob = new DeleteJob(entriesToDelete, iface);
+    QStringList removedPaths;
+    connect(deleteJob, &Job::entriesRemoved, [&removedPaths](const QStringList &paths) {
+        removedPaths << paths;
+    });
     startAndWaitForResult(deleteJob);
 
+    QCOMPARE(removedPaths.size(), entries.size() - expectedRemainingEntries.size());
+
     auto remainingEntries = listEntries(iface);
     QCOMPARE(remainingEntries.size(), expectedRemainingEntries.size());
 
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "kerfuffle/listingscanner.h"
+
+#include <QTest>
+
+using namespace Kerfuffle;
+
+class ListingScannerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testToSize_data();
+    void testToSize();
+    void testToDateTime_data();
+    void testToDateTime();
+    void testToCompactDateTime();
+    void testToShortDateTime_data();
+    void testToShortDateTime();
+    void benchmarkToDateTime_data();
+    void benchmarkToDateTime();
+};
+
+void ListingScannerTest::testToSize_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("expectedOk");
+    QTest::addColumn<qulonglong>("expectedSize");
+
+    QTest::newRow("zero") << QStringLiteral("0") << true << Q_UINT64_C(0);
+    QTest::newRow("small") << QStringLiteral("32") << true << Q_UINT64_C(32);
+    QTest::newRow("whitespace") << QStringLiteral("  1024 ") << true << Q_UINT64_C(1024);
+    QTest::newRow("above 2 GB") << QStringLiteral("2147483648") << true << Q_UINT64_C(2147483648);
+    QTest::newRow("above 4 GB") << QStringLiteral("5368709120") << true << Q_UINT64_C(5368709120);
+    QTest::newRow("max") << QStringLiteral("18446744073709551615") << true << Q_UINT64_C(18446744073709551615);
+    QTest::newRow("overflow") << QStringLiteral("18446744073709551616") << false << Q_UINT64_C(0);
+    QTest::newRow("empty") << QString() << false << Q_UINT64_C(0);
+    QTest::newRow("negative") << QStringLiteral("-1") << false << Q_UINT64_C(0);
+    QTest::newRow("not a number") << QStringLiteral("12a") << false << Q_UINT64_C(0);
+}
+
+void ListingScannerTest::testToSize()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, expectedOk);
+    QFETCH(qulonglong, expectedSize);
+
+    bool ok = !expectedOk;
+    QCOMPARE(ListingScanner::toSize(text, &ok), expectedSize);
+    QCOMPARE(ok, expectedOk);
+
+    // The same value embedded in a line.
+    const QString line = QStringLiteral("Size = ") + text;
+    QCOMPARE(ListingScanner::toSize(line.midRef(7)), expectedSize);
+}
+
+void ListingScannerTest::testToDateTime_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QDateTime>("expectedDateTime");
+
+    QTest::newRow("7z") << QStringLiteral("2015-05-17 19:41:48")
+                        << QDateTime(QDate(2015, 5, 17), QTime(19, 41, 48));
+    QTest::newRow("unrar5") << QStringLiteral("2015-07-26 19:04:38,250")
+                            << QDateTime(QDate(2015, 7, 26), QTime(19, 4, 38, 250));
+    QTest::newRow("nanoseconds") << QStringLiteral("2015-07-26 19:04:38,123456789")
+                                 << QDateTime(QDate(2015, 7, 26), QTime(19, 4, 38, 123));
+    QTest::newRow("whitespace") << QStringLiteral(" 2015-05-17 19:41:48 ")
+                                << QDateTime(QDate(2015, 5, 17), QTime(19, 41, 48));
+    QTest::newRow("empty") << QString() << QDateTime();
+    QTest::newRow("truncated") << QStringLiteral("2015-05-17 19:41") << QDateTime();
+    QTest::newRow("invalid date") << QStringLiteral("2015-02-30 19:41:48") << QDateTime();
+    QTest::newRow("invalid time") << QStringLiteral("2015-05-17 25:41:48") << QDateTime();
+    QTest::newRow("trailing garbage") << QStringLiteral("2015-05-17 19:41:48x") << QDateTime();
+}
+
+void ListingScannerTest::testToDateTime()
+{
+    QFETCH(QString, text);
+    QFETCH(QDateTime, expectedDateTime);
+
+    QCOMPARE(ListingScanner::toDateTime(text), expectedDateTime);
+}
+
+void ListingScannerTest::testToCompactDateTime()
+{
+    const QString line = QStringLiteral("20150517.194148");
+
+    QCOMPARE(ListingScanner::toCompactDateTime(line.midRef(0, 8), line.midRef(9)),
+             QDateTime(QDate(2015, 5, 17), QTime(19, 41, 48)));
+    QCOMPARE(ListingScanner::toCompactDateTime(line.midRef(0, 7), line.midRef(9)), QDateTime());
+    QCOMPARE(ListingScanner::toCompactDateTime(line.midRef(0, 8), line.midRef(8)), QDateTime());
+}
+
+void ListingScannerTest::testToShortDateTime_data()
+{
+    QTest::addColumn<QString>("date");
+    QTest::addColumn<QString>("time");
+    QTest::addColumn<QDateTime>("expectedDateTime");
+
+    QTest::newRow("2000s") << QStringLiteral("17-05-15") << QStringLiteral("19:41")
+                           << QDateTime(QDate(2015, 5, 17), QTime(19, 41));
+    QTest::newRow("1900s") << QStringLiteral("31-12-99") << QStringLiteral("23:59")
+                           << QDateTime(QDate(1999, 12, 31), QTime(23, 59));
+    QTest::newRow("cut-off") << QStringLiteral("01-01-50") << QStringLiteral("00:00")
+                             << QDateTime(QDate(1950, 1, 1), QTime(0, 0));
+    QTest::newRow("invalid") << QStringLiteral("17-05-2015") << QStringLiteral("19:41")
+                             << QDateTime();
+}
+
+void ListingScannerTest::testToShortDateTime()
+{
+    QFETCH(QString, date);
+    QFETCH(QString, time);
+    QFETCH(QDateTime, expectedDateTime);
+
+    QCOMPARE(ListingScanner::toShortDateTime(QStringRef(&date), QStringRef(&time)), expectedDateTime);
+}
+
+void ListingScannerTest::benchmarkToDateTime_data()
+{
+    QTest::addColumn<bool>("useScanner");
+
+    QTest::newRow("QDateTime::fromString") << false;
+    QTest::newRow("ListingScanner") << true;
+}
+
+void ListingScannerTest::benchmarkToDateTime()
+{
+    QFETCH(bool, useScanner);
+
+    QStringList lines;
+    for (int i = 0; i < 1000; ++i) {
+        lines << QStringLiteral("Modified = 2015-05-17 19:41:%1").arg(i % 60, 2, 10, QLatin1Char('0'));
+        lines << QStringLiteral("Size = %1").arg(Q_UINT64_C(5368709120) + i);
+    }
+
+    QBENCHMARK {
+        for (int i = 0; i < lines.size(); i += 2) {
+            if (useScanner) {
+                ListingScanner::toDateTime(lines.at(i).midRef(11));
+                ListingScanner::toSize(lines.at(i + 1).midRef(7));
+            } else {
+                QDateTime::fromString(lines.at(i).mid(11).trimmed(), QStringLiteral("yyyy-MM-dd hh:mm:ss"));
+                QVariant(lines.at(i + 1).mid(7).trimmed()).toULongLong();
+            }
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(ListingScannerTest)
+
+#include "listingscannertest.moc"
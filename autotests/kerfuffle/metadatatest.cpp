@@ -23,11 +23,16 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "kerfuffle/pluginmanager.h"
+
 #include <KPluginLoader>
 #include <KPluginMetaData>
 
+#include <QMimeDatabase>
 #include <QTest>
 
+using namespace Kerfuffle;
+
 class MetaDataTest : public QObject
 {
     Q_OBJECT
@@ -37,6 +42,7 @@ private Q_SLOTS:
     void initTestCase();
     void testPluginLoading();
     void testPluginMetadata();
+    void testPluginManagerCache();
 
 private:
 
@@ -79,6 +85,48 @@ void MetaDataTest::testPluginMetadata()
     }
 }
 
+static QStringList pluginIds(const QVector<Plugin*> &plugins)
+{
+    QStringList ids;
+    foreach (Plugin *plugin, plugins) {
+        ids << plugin->metaData().pluginId();
+    }
+    return ids;
+}
+
+// The instances of PluginManager share the plugins found and the preferred plugins,
+// but each one owns its Plugin objects.
+void MetaDataTest::testPluginManagerCache()
+{
+    const QMimeType mimeType = QMimeDatabase().mimeTypeForName(QStringLiteral("application/x-compressed-tar"));
+
+    PluginManager first;
+    const QVector<Plugin*> firstPlugins = first.preferredPluginsFor(mimeType);
+    foreach (Plugin *plugin, firstPlugins) {
+        QCOMPARE(plugin->parent(), static_cast<QObject*>(&first));
+    }
+
+    PluginManager second;
+    const QVector<Plugin*> secondPlugins = second.preferredPluginsFor(mimeType);
+    foreach (Plugin *plugin, secondPlugins) {
+        QCOMPARE(plugin->parent(), static_cast<QObject*>(&second));
+    }
+
+    QCOMPARE(pluginIds(secondPlugins), pluginIds(firstPlugins));
+    QCOMPARE(second.installedPlugins().size(), first.installedPlugins().size());
+    QCOMPARE(second.supportedMimeTypes(), first.supportedMimeTypes());
+    QCOMPARE(pluginIds(second.preferredWritePluginsFor(mimeType)), pluginIds(first.preferredWritePluginsFor(mimeType)));
+
+    PluginManager::invalidateCache();
+
+    PluginManager third;
+    QCOMPARE(pluginIds(third.preferredPluginsFor(mimeType)), pluginIds(firstPlugins));
+    QCOMPARE(third.supportedMimeTypes(), first.supportedMimeTypes());
+
+    // The instances created before keep working.
+    QCOMPARE(pluginIds(first.preferredPluginsFor(mimeType)), pluginIds(firstPlugins));
+}
+
 QTEST_GUILESS_MAIN(MetaDataTest)
 
 #include "metadatatest.moc"
@@ -26,7 +26,9 @@
 #include "kerfuffle/archive_kerfuffle.h"
 #include "mimetypes.h"
 
+#include <QFile>
 #include <QMimeDatabase>
+#include <QTemporaryDir>
 #include <QTest>
 
 using namespace Kerfuffle;
@@ -39,6 +41,9 @@ private Q_SLOTS:
 
     void testMimeTypeDetection_data();
     void testMimeTypeDetection();
+    void testCompressedTarWithWrongExtension();
+    void testCacheInvalidation();
+    void testDetectionBenchmark();
 };
 
 QTEST_GUILESS_MAIN(MimeTypeTest)
@@ -57,6 +62,7 @@ void MimeTypeTest::testMimeTypeDetection_data()
     const QString compressedLzopTarMime = QStringLiteral("application/x-tzo");
     const QString compressedLrzipTarMime = QStringLiteral("application/x-lrzip-compressed-tar");
     const QString compressedLz4TarMime = QStringLiteral("application/x-lz4-compressed-tar");
+    const QString compressedZstdTarMime = QStringLiteral("application/x-zstd-compressed-tar");
     const QString isoMimeType = QStringLiteral("application/x-cd-image");
     const QString debMimeType = QMimeDatabase().mimeTypeForFile(QStringLiteral("dummy.deb"), QMimeDatabase::MatchExtension).name();
     const QString xarMimeType = QStringLiteral("application/x-xar");
@@ -71,6 +77,7 @@ void MimeTypeTest::testMimeTypeDetection_data()
     QTest::newRow("tar.lzo") << QFINDTESTDATA("data/simplearchive.tar.lzo") << compressedLzopTarMime;
     QTest::newRow("tar.lrz") << QFINDTESTDATA("data/simplearchive.tar.lrz") << compressedLrzipTarMime;
     QTest::newRow("tar.lz4") << QFINDTESTDATA("data/simplearchive.tar.lz4") << compressedLz4TarMime;
+    QTest::newRow("tar.zst") << QFINDTESTDATA("data/simplearchive.tar.zst") << compressedZstdTarMime;
     QTest::newRow("deb") << QFINDTESTDATA("data/smallarchive.deb") << debMimeType;
     QTest::newRow("xar") << QFINDTESTDATA("data/simplearchive.xar") << xarMimeType;
 
@@ -97,4 +104,50 @@ void MimeTypeTest::testMimeTypeDetection()
     QCOMPARE(determineMimeType(archiveName).name(), expectedMimeType);
 }
 
+void MimeTypeTest::testCompressedTarWithWrongExtension()
+{
+    QTemporaryDir temporaryDir;
+    const QString archiveName = temporaryDir.path() + QLatin1String("/simplearchive.bin");
+    QVERIFY(QFile::copy(QFINDTESTDATA("data/simplearchive.tar.gz"), archiveName));
+
+    // The tar header is found inside the gzip stream.
+    QCOMPARE(determineMimeType(archiveName).name(), QStringLiteral("application/x-compressed-tar"));
+}
+
+void MimeTypeTest::testCacheInvalidation()
+{
+    QTemporaryDir temporaryDir;
+    const QString archiveName = temporaryDir.path() + QLatin1String("/archive");
+    QVERIFY(QFile::copy(QFINDTESTDATA("data/simplearchive.tar.gz"), archiveName));
+
+    QCOMPARE(determineMimeType(archiveName).name(), QStringLiteral("application/x-compressed-tar"));
+    QCOMPARE(determineMimeType(archiveName).name(), QStringLiteral("application/x-compressed-tar"));
+
+    // Overwriting the file changes its size, so the cached mimetype is not used anymore.
+    QVERIFY(QFile::remove(archiveName));
+    QVERIFY(QFile::copy(QFINDTESTDATA("data/zip_with_wrong_extension.rar"), archiveName));
+    QCOMPARE(determineMimeType(archiveName).name(), QStringLiteral("application/zip"));
+
+    clearMimeTypeCache();
+    QCOMPARE(determineMimeType(archiveName).name(), QStringLiteral("application/zip"));
+}
+
+void MimeTypeTest::testDetectionBenchmark()
+{
+    const QStringList archiveNames = {
+        QFINDTESTDATA("data/simplearchive.tar.gz"),
+        QFINDTESTDATA("data/simplearchive.tar.bz2"),
+        QFINDTESTDATA("data/simplearchive.tar.xz"),
+        QFINDTESTDATA("data/smallarchive.deb"),
+        QFINDTESTDATA("data/zip_with_wrong_extension.rar")
+    };
+
+    QBENCHMARK {
+        clearMimeTypeCache();
+        foreach (const QString &archiveName, archiveNames) {
+            determineMimeType(archiveName);
+        }
+    }
+}
+
 #include "mimetypetest.moc"
@@ -151,7 +151,7 @@ void MoveTest::testMoving()
     QFETCH(QString, archiveName);
     const QString archivePath = temporaryDir.path() + QLatin1Char('/') + archiveName;
     Q_ASSERT(QFile::copy(QFINDTESTDATA(QStringLiteral("data/") + archiveName), archivePath));
-    Archive *archive = Archive::create(archivePath, this);
+    Archive *archive = Archive::createEditable(archivePath, QString(), this);
     QVERIFY(archive);
 
     if (!archive->isValid()) {
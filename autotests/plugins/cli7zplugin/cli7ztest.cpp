@@ -107,36 +107,37 @@ void Cli7zTest::testList_data()
     QTest::addColumn<bool>("isPasswordProtected");
     QTest::addColumn<qulonglong>("expectedSize");
     QTest::addColumn<QString>("expectedTimestamp");
+    QTest::addColumn<int>("expectedSolidBlock");
 
     // p7zip version 15.14 tests
 
     QTest::newRow("normal-file-1514")
             << QFINDTESTDATA("data/archive-with-symlink-1514.txt") << 10
-            << 4 << QStringLiteral("testarchive/dir2/file2.txt") << false << false << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48");
+            << 4 << QStringLiteral("testarchive/dir2/file2.txt") << false << false << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48") << 0;
 
     QTest::newRow("encrypted-1514")
             << QFINDTESTDATA("data/archive-encrypted-1514.txt") << 9
-            << 3 << QStringLiteral("testarchive/dir1/file1.txt") << false << true << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48");
+            << 3 << QStringLiteral("testarchive/dir1/file1.txt") << false << true << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48") << 0;
 
     // p7zip version 15.09 tests
 
     QTest::newRow("normal-file-1509")
             << QFINDTESTDATA("data/archive-with-symlink-1509.txt") << 10
-            << 4 << QStringLiteral("testarchive/dir2/file2.txt") << false << false << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48");
+            << 4 << QStringLiteral("testarchive/dir2/file2.txt") << false << false << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48") << 0;
 
     QTest::newRow("encrypted-1509")
             << QFINDTESTDATA("data/archive-encrypted-1509.txt") << 9
-            << 3 << QStringLiteral("testarchive/dir1/file1.txt") << false << true << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48");
+            << 3 << QStringLiteral("testarchive/dir1/file1.txt") << false << true << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48") << 0;
 
     // p7zip version 9.38.1 tests
 
     QTest::newRow("normal-file-9381")
             << QFINDTESTDATA("data/archive-with-symlink-9381.txt") << 10
-            << 4 << QStringLiteral("testarchive/dir2/file2.txt") << false << false << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48");
+            << 4 << QStringLiteral("testarchive/dir2/file2.txt") << false << false << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48") << 0;
 
     QTest::newRow("encrypted-9381")
             << QFINDTESTDATA("data/archive-encrypted-9381.txt") << 9
-            << 3 << QStringLiteral("testarchive/dir1/file1.txt") << false << true << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48");
+            << 3 << QStringLiteral("testarchive/dir1/file1.txt") << false << true << (qulonglong) 32 << QStringLiteral("2015-05-17T19:41:48") << 0;
 }
 
 void Cli7zTest::testList()
@@ -178,6 +179,17 @@ void Cli7zTest::testList()
     QFETCH(QString, expectedTimestamp);
     QCOMPARE(entry->property("timestamp").toString(), expectedTimestamp);
 
+    QFETCH(int, expectedSolidBlock);
+    QCOMPARE(entry->property("solidBlock").toInt(), expectedSolidBlock);
+
+    // Only the files with data belong to a block.
+    for (int i = 0; i < signalSpy.count(); ++i) {
+        const Archive::Entry *e = signalSpy.at(i).at(0).value<Archive::Entry*>();
+        if (e->isDir()) {
+            QCOMPARE(e->property("solidBlock").toInt(), -1);
+        }
+    }
+
     plugin->deleteLater();
 }
 
@@ -290,6 +302,57 @@ void Cli7zTest::testAddArgs()
     plugin->deleteLater();
 }
 
+void Cli7zTest::testAddTuningArgs_data()
+{
+    QTest::addColumn<int>("dictionarySize");
+    QTest::addColumn<int>("blockSize");
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<QStringList>("expectedArgs");
+
+    QTest::newRow("no tuning")
+            << 0 << 0 << 0
+            << QStringList { QStringLiteral("a"), QStringLiteral("/tmp/foo.7z") };
+
+    QTest::newRow("dictionary size")
+            << 65536 << 0 << 0
+            << QStringList { QStringLiteral("a"), QStringLiteral("/tmp/foo.7z"), QStringLiteral("-md=65536k") };
+
+    QTest::newRow("all options")
+            << 16384 << 262144 << 4
+            << QStringList { QStringLiteral("a"), QStringLiteral("/tmp/foo.7z"), QStringLiteral("-md=16384k"),
+                             QStringLiteral("-ms=262144k"), QStringLiteral("-mmt=4") };
+}
+
+void Cli7zTest::testAddTuningArgs()
+{
+    const QString archiveName = QStringLiteral("/tmp/foo.7z");
+    CliPlugin *plugin = new CliPlugin(this, {QVariant(archiveName)});
+    QVERIFY(plugin);
+
+    const QStringList addArgs = { QStringLiteral("a"),
+                                  QStringLiteral("$Archive"),
+                                  QStringLiteral("$DictionarySizeSwitch"),
+                                  QStringLiteral("$BlockSizeSwitch"),
+                                  QStringLiteral("$ThreadsSwitch"),
+                                  QStringLiteral("$Files") };
+
+    QFETCH(int, dictionarySize);
+    QFETCH(int, blockSize);
+    QFETCH(int, threads);
+
+    CompressionOptions options;
+    options[QStringLiteral("DictionarySize")] = dictionarySize;
+    options[QStringLiteral("BlockSize")] = blockSize;
+    options[QStringLiteral("Threads")] = threads;
+
+    QStringList replacedArgs = plugin->substituteAddVariables(addArgs, {}, QString(), false, -1, options);
+
+    QFETCH(QStringList, expectedArgs);
+    QCOMPARE(replacedArgs, expectedArgs);
+
+    plugin->deleteLater();
+}
+
 void Cli7zTest::testExtractArgs_data()
 {
     QTest::addColumn<QString>("archiveName");
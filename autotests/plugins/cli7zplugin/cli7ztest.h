@@ -47,6 +47,8 @@ private Q_SLOTS:
     void testListArgs();
     void testAddArgs_data();
     void testAddArgs();
+    void testAddTuningArgs_data();
+    void testAddTuningArgs();
     void testExtractArgs_data();
     void testExtractArgs();
 
@@ -215,6 +215,46 @@ void CliRarTest::testList()
     rarPlugin->deleteLater();
 }
 
+void CliRarTest::testListSolidBlocks_data()
+{
+    QTest::addColumn<QString>("outputTextFile");
+    QTest::addColumn<bool>("isSolid");
+
+    QTest::newRow("unrar5") << QFINDTESTDATA("data/archive-with-symlink-unrar5.txt") << false;
+    QTest::newRow("solid-unrar5") << QFINDTESTDATA("data/archive-solid-unrar5.txt") << true;
+    QTest::newRow("unrar4") << QFINDTESTDATA("data/archive-with-symlink-unrar4.txt") << false;
+    QTest::newRow("solid-unrar4") << QFINDTESTDATA("data/archive-solid-unrar4.txt") << true;
+}
+
+void CliRarTest::testListSolidBlocks()
+{
+    qRegisterMetaType<Archive::Entry*>("Archive::Entry*");
+    CliPlugin *rarPlugin = new CliPlugin(this, {QStringLiteral("dummy.rar")});
+    QSignalSpy signalSpy(rarPlugin, &CliPlugin::entry);
+
+    QFETCH(QString, outputTextFile);
+    QFile outputText(outputTextFile);
+    QVERIFY(outputText.open(QIODevice::ReadOnly));
+
+    QTextStream outputStream(&outputText);
+    while (!outputStream.atEnd()) {
+        const QString line(outputStream.readLine());
+        QVERIFY(rarPlugin->readListLine(line));
+    }
+
+    QVERIFY(signalSpy.count() > 0);
+
+    // All the files of a solid archive are in the same block.
+    QFETCH(bool, isSolid);
+    for (int i = 0; i < signalSpy.count(); ++i) {
+        const Archive::Entry *entry = signalSpy.at(i).at(0).value<Archive::Entry*>();
+        const int expectedSolidBlock = (isSolid && !entry->isDir()) ? 0 : -1;
+        QCOMPARE(entry->property("solidBlock").toInt(), expectedSolidBlock);
+    }
+
+    rarPlugin->deleteLater();
+}
+
 void CliRarTest::testListArgs_data()
 {
     QTest::addColumn<QString>("archiveName");
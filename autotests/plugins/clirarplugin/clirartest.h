@@ -44,6 +44,8 @@ private Q_SLOTS:
     void testArchive();
     void testList_data();
     void testList();
+    void testListSolidBlocks_data();
+    void testListSolidBlocks();
     void testListArgs_data();
     void testListArgs();
     void testAddArgs_data();
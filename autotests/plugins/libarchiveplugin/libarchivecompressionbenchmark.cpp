@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "libarchivecompressionbenchmark.h"
+
+#include <archive.h>
+#include <archive_entry.h>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTest>
+
+QTEST_GUILESS_MAIN(LibarchiveCompressionBenchmark)
+
+static const int s_corpusPartSize = 1024 * 1024;
+
+/**
+ * A small linear congruential generator, so that the corpus (and thus the
+ * ratios) are the same on every run and every platform.
+ */
+static quint32 nextRandom(quint32 &state)
+{
+    state = state * 1103515245u + 12345u;
+    return state >> 8;
+}
+
+static double megabytesPerSecond(qint64 bytes, qint64 nsecs)
+{
+    return nsecs > 0 ? (bytes / (1024.0 * 1024.0)) / (nsecs / 1e9) : 0.0;
+}
+
+void LibarchiveCompressionBenchmark::initTestCase()
+{
+    quint32 state = 42;
+
+    // Text-like data: words from a small vocabulary.
+    const QList<QByteArray> words = { "archive ", "compression ", "the ", "of ", "file ", "directory ", "entry ",
+                                      "block ", "dictionary ", "level ", "thread ", "size ", "and ", "a ", "\n" };
+    while (m_corpus.size() < s_corpusPartSize) {
+        m_corpus += words.at(nextRandom(state) % words.size());
+    }
+    m_corpus.truncate(s_corpusPartSize);
+
+    // Incompressible data.
+    for (int i = 0; i < s_corpusPartSize; ++i) {
+        m_corpus += char(nextRandom(state) & 0xff);
+    }
+
+    // Long repetitions, further apart than the gzip window.
+    QByteArray chunk;
+    for (int i = 0; i < 64 * 1024; ++i) {
+        chunk += char(nextRandom(state) & 0xff);
+    }
+    while (m_corpus.size() < 3 * s_corpusPartSize) {
+        m_corpus += chunk;
+    }
+    m_corpus.truncate(3 * s_corpusPartSize);
+}
+
+void LibarchiveCompressionBenchmark::benchmarkFilter_data()
+{
+    QTest::addColumn<QString>("filter");
+    QTest::addColumn<int>("level");
+
+    QStringList filters = { QStringLiteral("gzip"), QStringLiteral("bzip2"), QStringLiteral("xz"),
+                            QStringLiteral("lzma"), QStringLiteral("compress") };
+#if ARCHIVE_VERSION_NUMBER >= 3002000
+    filters << QStringLiteral("lz4");
+#endif
+#if ARCHIVE_VERSION_NUMBER >= 3003003
+    filters << QStringLiteral("zstd");
+#endif
+
+    foreach (const QString &filter, filters) {
+        foreach (int level, QList<int>() << 1 << -1 << 9) {
+            const QString levelName = level < 0 ? QStringLiteral("default") : QString::number(level);
+            QTest::newRow(qPrintable(filter + QLatin1Char('-') + levelName)) << filter << level;
+        }
+    }
+}
+
+void LibarchiveCompressionBenchmark::benchmarkFilter()
+{
+    QFETCH(QString, filter);
+    QFETCH(int, level);
+
+    if (filter == QLatin1String("compress") && level != -1) {
+        QSKIP("compress has no compression levels");
+    }
+
+    QByteArray compressed(m_corpus.size() + m_corpus.size() / 2 + 64 * 1024, Qt::Uninitialized);
+    size_t compressedSize = 0;
+    qint64 compressionTime = 0;
+
+    QBENCHMARK_ONCE {
+        QElapsedTimer timer;
+        timer.start();
+
+        struct archive *writer = archive_write_new();
+        QVERIFY(writer);
+        QCOMPARE(archive_write_set_format_pax_restricted(writer), ARCHIVE_OK);
+        // Libarchive warns when it falls back to an external program.
+        const int ret = archive_write_add_filter_by_name(writer, filter.toUtf8().constData());
+        QVERIFY(ret == ARCHIVE_OK || ret == ARCHIVE_WARN);
+        if (level > 0) {
+            QCOMPARE(archive_write_set_filter_option(writer, NULL, "compression-level", QByteArray::number(level).constData()), ARCHIVE_OK);
+        }
+        QCOMPARE(archive_write_open_memory(writer, compressed.data(), compressed.size(), &compressedSize), ARCHIVE_OK);
+
+        struct archive_entry *entry = archive_entry_new();
+        archive_entry_set_pathname(entry, "corpus");
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, 0644);
+        archive_entry_set_size(entry, m_corpus.size());
+        QCOMPARE(archive_write_header(writer, entry), ARCHIVE_OK);
+        QCOMPARE(static_cast<qint64>(archive_write_data(writer, m_corpus.constData(), m_corpus.size())), qint64(m_corpus.size()));
+        archive_entry_free(entry);
+
+        QCOMPARE(archive_write_close(writer), ARCHIVE_OK);
+        archive_write_free(writer);
+
+        compressionTime = timer.nsecsElapsed();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    struct archive *reader = archive_read_new();
+    QVERIFY(reader);
+    archive_read_support_filter_all(reader);
+    archive_read_support_format_tar(reader);
+    QCOMPARE(archive_read_open_memory(reader, compressed.data(), compressedSize), ARCHIVE_OK);
+
+    struct archive_entry *entry;
+    QCOMPARE(archive_read_next_header(reader, &entry), ARCHIVE_OK);
+    QByteArray decompressed(m_corpus.size(), Qt::Uninitialized);
+    qint64 decompressedSize = 0;
+    while (decompressedSize < decompressed.size()) {
+        const qint64 readSize = archive_read_data(reader, decompressed.data() + decompressedSize, decompressed.size() - decompressedSize);
+        QVERIFY(readSize > 0);
+        decompressedSize += readSize;
+    }
+    archive_read_free(reader);
+
+    const qint64 decompressionTime = timer.nsecsElapsed();
+    QVERIFY(decompressed == m_corpus);
+
+    qDebug().nospace() << qPrintable(filter) << " level " << level << ": ratio "
+                       << double(compressedSize) / m_corpus.size() << ", compression "
+                       << megabytesPerSecond(m_corpus.size(), compressionTime) << " MiB/s, decompression "
+                       << megabytesPerSecond(m_corpus.size(), decompressionTime) << " MiB/s";
+}
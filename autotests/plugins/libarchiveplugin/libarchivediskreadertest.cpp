@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "libarchivediskreadertest.h"
+#include "libarchivediskreader.h"
+
+#include <archive_entry.h>
+
+#include <QFile>
+#include <QTest>
+
+QTEST_GUILESS_MAIN(LibarchiveDiskReaderTest)
+
+static const int s_directoriesCount = 8;
+static const int s_filesCount = 50;
+
+static bool writeFile(const QString &fileName, const QByteArray &data)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+void LibarchiveDiskReaderTest::initTestCase()
+{
+    QVERIFY(m_tempDir.isValid());
+
+    QDir dir(m_tempDir.path());
+    for (int i = 0; i < s_directoriesCount; ++i) {
+        const QString subdir = QStringLiteral("tree/dir%1/sub").arg(i);
+        QVERIFY(dir.mkpath(subdir));
+        for (int j = 0; j < s_filesCount; ++j) {
+            QVERIFY(writeFile(dir.filePath(QStringLiteral("tree/dir%1/file%2.txt").arg(i).arg(j)),
+                              QByteArray(j * 100, char('a' + j % 26))));
+        }
+        QVERIFY(writeFile(dir.filePath(subdir + QStringLiteral("/large.bin")),
+                          QByteArray(LibarchiveDiskReader::PrefetchSizeLimit + 1, 'x')));
+    }
+    QVERIFY(writeFile(dir.filePath(QStringLiteral("single.txt")), QByteArray("single")));
+}
+
+void LibarchiveDiskReaderTest::testWalk()
+{
+    const QDir workDir(m_tempDir.path());
+    const QStringList paths = LibarchiveDiskReader::walk(QStringList() << QStringLiteral("tree/") << QStringLiteral("single.txt"),
+                                                         workDir);
+
+    QCOMPARE(paths.size(), 1 + s_directoriesCount * (1 + s_filesCount + 2) + 1);
+    QCOMPARE(paths.first(), QStringLiteral("tree/"));
+    QCOMPARE(paths.at(1), QStringLiteral("tree/dir0/"));
+    QCOMPARE(paths.at(2), QStringLiteral("tree/dir0/file0.txt"));
+    QCOMPARE(paths.last(), QStringLiteral("single.txt"));
+
+    // Every directory comes right before its content.
+    const int subdirIndex = paths.indexOf(QStringLiteral("tree/dir3/sub/"));
+    QVERIFY(subdirIndex > 0);
+    QCOMPARE(paths.at(subdirIndex + 1), QStringLiteral("tree/dir3/sub/large.bin"));
+
+    // The order doesn't depend on the threads.
+    for (int i = 0; i < 5; ++i) {
+        QCOMPARE(LibarchiveDiskReader::walk(QStringList() << QStringLiteral("tree/") << QStringLiteral("single.txt"), workDir), paths);
+    }
+}
+
+void LibarchiveDiskReaderTest::testRead()
+{
+    const QDir workDir(m_tempDir.path());
+    const QStringList paths = LibarchiveDiskReader::walk(QStringList() << QStringLiteral("tree/"), workDir);
+
+    LibarchiveDiskReader reader(workDir, QStringList() << QStringLiteral("tree/"));
+    QStringList readPaths;
+    while (!reader.atEnd()) {
+        foreach (const LibarchiveDiskReader::Entry &file, reader.next()) {
+            readPaths.append(file.path);
+            QVERIFY(file.entry);
+            QCOMPARE(QString::fromUtf8(archive_entry_sourcepath(file.entry.data())), file.absolutePath);
+
+            if (file.path.endsWith(QLatin1Char('/'))) {
+                QCOMPARE(int(archive_entry_filetype(file.entry.data())), int(AE_IFDIR));
+                QVERIFY(!file.isDataRead);
+            } else if (file.path.endsWith(QLatin1String("large.bin"))) {
+                QVERIFY(!file.isDataRead);
+                QCOMPARE(qint64(archive_entry_size(file.entry.data())), qint64(LibarchiveDiskReader::PrefetchSizeLimit + 1));
+            } else {
+                QVERIFY(file.isDataRead);
+                QFile data(file.absolutePath);
+                QVERIFY(data.open(QIODevice::ReadOnly));
+                QCOMPARE(file.data, data.readAll());
+                QCOMPARE(qint64(archive_entry_size(file.entry.data())), qint64(file.data.size()));
+            }
+        }
+    }
+
+    QCOMPARE(readPaths, paths);
+}
+
+void LibarchiveDiskReaderTest::testAbort()
+{
+    const QDir workDir(m_tempDir.path());
+    const bool abortOperation = true;
+
+    // Nothing is walked once the operation is aborted.
+    LibarchiveDiskReader reader(workDir, QStringList() << QStringLiteral("tree/"), false, &abortOperation);
+    QVERIFY(reader.next().isEmpty());
+    QVERIFY(reader.atEnd());
+}
+
+void LibarchiveDiskReaderTest::benchmarkRead()
+{
+    const QDir workDir(m_tempDir.path());
+
+    QBENCHMARK {
+        LibarchiveDiskReader reader(workDir, QStringList() << QStringLiteral("tree/"));
+        while (!reader.atEnd()) {
+            reader.next();
+        }
+    }
+}
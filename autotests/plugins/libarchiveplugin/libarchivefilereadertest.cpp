@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "libarchivefilereadertest.h"
+#include "libarchivefilereader.h"
+
+#include <archive_entry.h>
+
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QTest>
+
+QTEST_GUILESS_MAIN(LibarchiveFileReaderTest)
+
+static const int s_entriesCount = 64;
+static const int s_entrySize = 512 * 1024;
+
+// A negative block size opens the archive with archive_read_open_filename() instead,
+// as the plugin did before.
+static bool openReader(struct archive *reader, QScopedPointer<LibarchiveFileReader> &fileReader,
+                       const QString &fileName, bool mapped, int blockSize)
+{
+    archive_read_support_filter_all(reader);
+    archive_read_support_format_all(reader);
+
+    if (blockSize < 0) {
+        return archive_read_open_filename(reader, QFile::encodeName(fileName), -blockSize) == ARCHIVE_OK;
+    }
+
+    fileReader.reset(new LibarchiveFileReader(fileName,
+                                              mapped ? LibarchiveFileReader::Mapped : LibarchiveFileReader::Buffered,
+                                              blockSize));
+    return fileReader->open(reader);
+}
+
+void LibarchiveFileReaderTest::initTestCase()
+{
+    QVERIFY(m_tempDir.isValid());
+    m_archiveFileName = m_tempDir.path() + QStringLiteral("/test.tar");
+
+    struct archive *writer = archive_write_new();
+    QVERIFY(writer);
+    QCOMPARE(archive_write_set_format_pax_restricted(writer), ARCHIVE_OK);
+    QCOMPARE(archive_write_add_filter_none(writer), ARCHIVE_OK);
+    QCOMPARE(archive_write_open_filename(writer, QFile::encodeName(m_archiveFileName)), ARCHIVE_OK);
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (int i = 0; i < s_entriesCount; ++i) {
+        const QByteArray data(s_entrySize, char('a' + i % 26));
+        hash.addData(data);
+
+        struct archive_entry *entry = archive_entry_new();
+        archive_entry_set_pathname(entry, QStringLiteral("dir/file%1.txt").arg(i).toUtf8().constData());
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, 0644);
+        archive_entry_set_size(entry, data.size());
+        QCOMPARE(archive_write_header(writer, entry), ARCHIVE_OK);
+        QCOMPARE(archive_write_data(writer, data.constData(), data.size()), ssize_t(data.size()));
+        archive_entry_free(entry);
+    }
+
+    QCOMPARE(archive_write_close(writer), ARCHIVE_OK);
+    archive_write_free(writer);
+
+    m_expectedChecksum = hash.result();
+}
+
+void LibarchiveFileReaderTest::addReaderColumns()
+{
+    QTest::addColumn<bool>("mapped");
+    QTest::addColumn<int>("blockSize");
+
+    QTest::newRow("open_filename 10 KB") << false << -10240;
+    QTest::newRow("buffered 10 KB") << false << 10240;
+    QTest::newRow("buffered 64 KB") << false << 64 * 1024;
+    QTest::newRow("buffered 1 MB") << false << 1024 * 1024;
+    QTest::newRow("mapped 64 KB") << true << 64 * 1024;
+    QTest::newRow("mapped 1 MB") << true << 1024 * 1024;
+}
+
+void LibarchiveFileReaderTest::testRead_data()
+{
+    addReaderColumns();
+}
+
+void LibarchiveFileReaderTest::testRead()
+{
+    QFETCH(bool, mapped);
+    QFETCH(int, blockSize);
+
+    struct archive *reader = archive_read_new();
+    QScopedPointer<LibarchiveFileReader> fileReader;
+    QVERIFY(openReader(reader, fileReader, m_archiveFileName, mapped, blockSize));
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+    struct archive_entry *entry;
+    int count = 0;
+    while (archive_read_next_header(reader, &entry) == ARCHIVE_OK) {
+        QCOMPARE(QString::fromUtf8(archive_entry_pathname(entry)), QStringLiteral("dir/file%1.txt").arg(count));
+        ssize_t readBytes;
+        while ((readBytes = archive_read_data(reader, buffer.data(), buffer.size())) > 0) {
+            hash.addData(buffer.constData(), readBytes);
+        }
+        QCOMPARE(readBytes, ssize_t(0));
+        ++count;
+    }
+
+    QCOMPARE(count, s_entriesCount);
+    QCOMPARE(hash.result(), m_expectedChecksum);
+    archive_read_free(reader);
+}
+
+void LibarchiveFileReaderTest::testSeek()
+{
+    // Zip is read through its central directory when the reader can seek.
+    struct archive *reader = archive_read_new();
+    QScopedPointer<LibarchiveFileReader> fileReader;
+    QVERIFY(openReader(reader, fileReader, QFINDTESTDATA("data/test.zip"), true, LibarchiveFileReader::DefaultBlockSize));
+    QVERIFY(fileReader->isMapped());
+
+    struct archive_entry *entry;
+    int count = 0;
+    while (archive_read_next_header(reader, &entry) == ARCHIVE_OK) {
+        archive_read_data_skip(reader);
+        ++count;
+    }
+
+    QCOMPARE(count, 13);
+    QCOMPARE(archive_format(reader), ARCHIVE_FORMAT_ZIP);
+    archive_read_free(reader);
+}
+
+void LibarchiveFileReaderTest::testHeaderWalk_data()
+{
+    QTest::addColumn<bool>("mapped");
+
+    QTest::newRow("buffered") << false;
+    QTest::newRow("mapped") << true;
+}
+
+// Listing an uncompressed tar only reads the blocks holding the headers.
+void LibarchiveFileReaderTest::testHeaderWalk()
+{
+    QFETCH(bool, mapped);
+
+    struct archive *reader = archive_read_new();
+    QScopedPointer<LibarchiveFileReader> fileReader;
+    QVERIFY(openReader(reader, fileReader, m_archiveFileName, mapped, LibarchiveFileReader::HeaderBlockSize));
+
+    struct archive_entry *entry;
+    int count = 0;
+    while (archive_read_next_header(reader, &entry) == ARCHIVE_OK) {
+        archive_read_data_skip(reader);
+        ++count;
+    }
+
+    QCOMPARE(count, s_entriesCount);
+    QVERIFY(fileReader->bytesRead() <= qint64(s_entriesCount + 1) * LibarchiveFileReader::HeaderBlockSize);
+    QVERIFY(fileReader->bytesRead() < QFileInfo(m_archiveFileName).size() / 4);
+    archive_read_free(reader);
+}
+
+// A mapped archive truncated while being read must end with an error, not SIGBUS.
+void LibarchiveFileReaderTest::testTruncatedWhileMapped()
+{
+    const QString fileName = m_tempDir.path() + QStringLiteral("/truncated.tar");
+    QVERIFY(QFile::copy(m_archiveFileName, fileName));
+
+    struct archive *reader = archive_read_new();
+    QScopedPointer<LibarchiveFileReader> fileReader;
+    QVERIFY(openReader(reader, fileReader, fileName, true, 64 * 1024));
+    QVERIFY(fileReader->isMapped());
+
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+    struct archive_entry *entry;
+    QCOMPARE(archive_read_next_header(reader, &entry), ARCHIVE_OK);
+    QCOMPARE(archive_read_data(reader, buffer.data(), buffer.size()), ssize_t(buffer.size()));
+
+    // Keep the first two entries.
+    QFile file(fileName);
+    QVERIFY(file.resize(2 * s_entrySize));
+
+    int count = 1;
+    int result = ARCHIVE_OK;
+    ssize_t readBytes = 0;
+    do {
+        while ((readBytes = archive_read_data(reader, buffer.data(), buffer.size())) > 0) {
+        }
+        if (readBytes < 0) {
+            break;
+        }
+        result = archive_read_next_header(reader, &entry);
+        if (result == ARCHIVE_OK) {
+            ++count;
+        }
+    } while (result == ARCHIVE_OK);
+
+    QVERIFY(!fileReader->isMapped());
+    QVERIFY(count < s_entriesCount);
+    QVERIFY(readBytes < 0 || result != ARCHIVE_EOF);
+    archive_read_free(reader);
+}
+
+void LibarchiveFileReaderTest::benchmarkList_data()
+{
+    addReaderColumns();
+}
+
+// Walks the headers the way LibarchivePlugin::list() does.
+void LibarchiveFileReaderTest::benchmarkList()
+{
+    QFETCH(bool, mapped);
+    QFETCH(int, blockSize);
+
+    int count = 0;
+    QBENCHMARK {
+        struct archive *reader = archive_read_new();
+        QScopedPointer<LibarchiveFileReader> fileReader;
+        QVERIFY(openReader(reader, fileReader, m_archiveFileName, mapped, blockSize));
+
+        struct archive_entry *entry;
+        count = 0;
+        while (archive_read_next_header(reader, &entry) == ARCHIVE_OK) {
+            archive_read_data_skip(reader);
+            ++count;
+        }
+        archive_read_free(reader);
+    }
+
+    QCOMPARE(count, s_entriesCount);
+}
+
+void LibarchiveFileReaderTest::benchmarkExtract_data()
+{
+    addReaderColumns();
+}
+
+// Decodes all the data without writing it, to measure only the reading.
+void LibarchiveFileReaderTest::benchmarkExtract()
+{
+    QFETCH(bool, mapped);
+    QFETCH(int, blockSize);
+
+    qint64 totalBytes = 0;
+    QBENCHMARK {
+        struct archive *reader = archive_read_new();
+        QScopedPointer<LibarchiveFileReader> fileReader;
+        QVERIFY(openReader(reader, fileReader, m_archiveFileName, mapped, blockSize));
+
+        const void *buffer;
+        size_t size;
+        int64_t offset;
+        struct archive_entry *entry;
+        totalBytes = 0;
+        while (archive_read_next_header(reader, &entry) == ARCHIVE_OK) {
+            while (archive_read_data_block(reader, &buffer, &size, &offset) == ARCHIVE_OK) {
+                totalBytes += size;
+            }
+        }
+        archive_read_free(reader);
+    }
+
+    QCOMPARE(totalBytes, qint64(s_entriesCount) * s_entrySize);
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "libarchiveselectiontest.h"
+#include "libarchiveentryselection.h"
+
+#include <QFile>
+#include <QTest>
+
+QTEST_GUILESS_MAIN(LibarchiveSelectionTest)
+
+// Names of the entries of a tarball with the given number of entries, ten
+// files per folder.
+static QList<QByteArray> archiveEntries(int count)
+{
+    QList<QByteArray> entries;
+    entries.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        entries << QByteArray("dir") + QByteArray::number(i / 10) + "/file" + QByteArray::number(i % 10) + ".txt";
+    }
+    return entries;
+}
+
+void LibarchiveSelectionTest::testMatching_data()
+{
+    QTest::addColumn<QStringList>("selectedPaths");
+    QTest::addColumn<bool>("matchFolderContents");
+    QTest::addColumn<QString>("entry");
+    QTest::addColumn<int>("expectedIndex");
+
+    QTest::newRow("selected file")
+            << QStringList {QStringLiteral("a.txt"), QStringLiteral("dir/b.txt")}
+            << true
+            << QStringLiteral("dir/b.txt")
+            << 1;
+
+    QTest::newRow("unselected file")
+            << QStringList {QStringLiteral("a.txt"), QStringLiteral("dir/b.txt")}
+            << true
+            << QStringLiteral("dir/c.txt")
+            << -1;
+
+    QTest::newRow("file in selected folder")
+            << QStringList {QStringLiteral("a.txt"), QStringLiteral("dir/")}
+            << true
+            << QStringLiteral("dir/sub/c.txt")
+            << 1;
+
+    QTest::newRow("file in selected folder, folder contents disabled")
+            << QStringList {QStringLiteral("a.txt"), QStringLiteral("dir/")}
+            << false
+            << QStringLiteral("dir/sub/c.txt")
+            << -1;
+
+    QTest::newRow("folder with selected children")
+            << QStringList {QStringLiteral("dir/"), QStringLiteral("dir/b.txt")}
+            << true
+            << QStringLiteral("dir/c.txt")
+            << -1;
+
+    QTest::newRow("nested folder without selected children")
+            << QStringList {QStringLiteral("dir/"), QStringLiteral("dir/sub/")}
+            << true
+            << QStringLiteral("dir/sub/c.txt")
+            << 1;
+
+    QTest::newRow("folder prefix of a file name")
+            << QStringList {QStringLiteral("dir/")}
+            << true
+            << QStringLiteral("directory/c.txt")
+            << -1;
+
+    QTest::newRow("non-ASCII file")
+            << QStringList {QString::fromUtf8("dir/\xc3\xa9t\xc3\xa9.txt")}
+            << true
+            << QString::fromUtf8("dir/\xc3\xa9t\xc3\xa9.txt")
+            << 0;
+}
+
+void LibarchiveSelectionTest::testMatching()
+{
+    QFETCH(QStringList, selectedPaths);
+    QFETCH(bool, matchFolderContents);
+    QFETCH(QString, entry);
+    QFETCH(int, expectedIndex);
+
+    LibarchiveEntrySelection selection(selectedPaths, matchFolderContents);
+    const QByteArray pathname = QFile::encodeName(entry);
+
+    QCOMPARE(selection.indexOf(pathname.constData()), expectedIndex);
+    QCOMPARE(selection.take(pathname.constData()), expectedIndex);
+}
+
+void LibarchiveSelectionTest::testExhaustion()
+{
+    LibarchiveEntrySelection files({QStringLiteral("dir/"), QStringLiteral("dir/a.txt"), QStringLiteral("b.txt")});
+    QVERIFY(!files.isEmpty());
+    QCOMPARE(files.take("dir/"), 0);
+    QCOMPARE(files.take("b.txt"), 2);
+    QVERIFY(!files.isExhausted());
+
+    // Exact matches are taken only once.
+    QCOMPARE(files.take("b.txt"), -1);
+    QCOMPARE(files.indexOf("b.txt"), 2);
+
+    QCOMPARE(files.take("dir/a.txt"), 1);
+    QVERIFY(files.isExhausted());
+
+    // Entries of a folder can be anywhere in the archive.
+    LibarchiveEntrySelection folder({QStringLiteral("dir/")});
+    QCOMPARE(folder.take("dir/"), 0);
+    QVERIFY(!folder.isExhausted());
+    QCOMPARE(folder.take("dir/a.txt"), 0);
+    QCOMPARE(folder.take("dir/a.txt"), 0);
+
+    QVERIFY(LibarchiveEntrySelection().isEmpty());
+}
+
+void LibarchiveSelectionTest::benchmarkSelectiveExtraction_data()
+{
+    QTest::addColumn<int>("entriesCount");
+    QTest::addColumn<int>("selectionStep");
+
+    QTest::newRow("50k of 500k entries") << 500000 << 10;
+    QTest::newRow("5k of 500k entries") << 500000 << 100;
+    QTest::newRow("folders, 50k of 500k entries") << 500000 << -10;
+}
+
+// Runs the selection the way LibarchivePlugin::extractFiles() does for every
+// header of the archive. A negative step selects whole folders.
+void LibarchiveSelectionTest::benchmarkSelectiveExtraction()
+{
+    QFETCH(int, entriesCount);
+    QFETCH(int, selectionStep);
+
+    const QList<QByteArray> entries = archiveEntries(entriesCount);
+
+    QStringList selectedPaths;
+    if (selectionStep > 0) {
+        for (int i = 0; i < entries.size(); i += selectionStep) {
+            selectedPaths << QFile::decodeName(entries.at(i));
+        }
+    } else {
+        for (int i = 0; i < entries.size(); i += 10 * -selectionStep) {
+            selectedPaths << QStringLiteral("dir%1/").arg(i / 10);
+        }
+    }
+
+    int matched = 0;
+    QBENCHMARK {
+        LibarchiveEntrySelection selection(selectedPaths);
+        matched = 0;
+        foreach (const QByteArray &entry, entries) {
+            if (selection.isExhausted()) {
+                break;
+            }
+            if (selection.take(entry.constData()) != -1) {
+                ++matched;
+            }
+        }
+    }
+
+    QCOMPARE(matched, entriesCount / qAbs(selectionStep));
+}
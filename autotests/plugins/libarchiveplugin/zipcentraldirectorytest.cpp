@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "zipcentraldirectorytest.h"
+#include "kerfuffle/zipcentraldirectory.h"
+#include "ziprangereader.h"
+
+#include <QFile>
+#include <QTemporaryFile>
+#include <QTest>
+
+using namespace Kerfuffle;
+
+QTEST_GUILESS_MAIN(ZipCentralDirectoryTest)
+
+void ZipCentralDirectoryTest::testRecords()
+{
+    QFile file(QFINDTESTDATA("data/test.zip"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    ZipCentralDirectory centralDirectory;
+    QVERIFY(centralDirectory.read(&file));
+
+    const QVector<ZipCentralDirectory::Record> &records = centralDirectory.records();
+    QCOMPARE(records.size(), 13);
+    QCOMPARE(centralDirectory.offset(), qint64(674));
+
+    QCOMPARE(records.at(0).fullPath(), QStringLiteral("a.txt"));
+    QCOMPARE(records.at(0).size, quint64(20));
+    QCOMPARE(records.at(0).compressedSize, quint64(20));
+    QCOMPARE(records.at(0).method, quint16(0));
+    QCOMPARE(records.at(0).localHeaderOffset, qint64(0));
+    QCOMPARE(records.at(0).timestamp, QDateTime(QDate(2016, 7, 23), QTime(0, 10, 44)));
+    QVERIFY(!records.at(0).isDir());
+    QVERIFY(!records.at(0).isEncrypted());
+
+    QCOMPARE(records.at(2).fullPath(), QStringLiteral("dir1/"));
+    QVERIFY(records.at(2).isDir());
+    QCOMPARE(records.at(3).fullPath(), QStringLiteral("dir1/a.txt"));
+    QCOMPARE(records.at(3).localHeaderOffset, qint64(145));
+    QCOMPARE(records.at(12).fullPath(), QStringLiteral("empty_dir/"));
+
+    qulonglong unpackedSize = 0;
+    foreach (const ZipCentralDirectory::Record &record, records) {
+        unpackedSize += record.size;
+    }
+    QCOMPARE(centralDirectory.unpackedSize(), unpackedSize);
+
+    // Only the end of the archive has been read.
+    QVERIFY(centralDirectory.bytesRead() <= file.size() - records.at(0).size);
+}
+
+void ZipCentralDirectoryTest::testPrependedData()
+{
+    QFile file(QFINDTESTDATA("data/test.zip"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    // Like a self-extracting archive.
+    QTemporaryFile selfExtracting;
+    QVERIFY(selfExtracting.open());
+    selfExtracting.write(QByteArray(1000, 'x'));
+    selfExtracting.write(file.readAll());
+    selfExtracting.flush();
+
+    ZipCentralDirectory centralDirectory;
+    QVERIFY(centralDirectory.read(&selfExtracting));
+    QCOMPARE(centralDirectory.records().size(), 13);
+    QCOMPARE(centralDirectory.offset(), qint64(1674));
+    QCOMPARE(centralDirectory.records().at(0).localHeaderOffset, qint64(1000));
+    QCOMPARE(centralDirectory.records().at(3).localHeaderOffset, qint64(1145));
+}
+
+void ZipCentralDirectoryTest::testRanges_data()
+{
+    QTest::addColumn<QVector<int>>("indexes");
+    QTest::addColumn<QVector<qint64>>("expectedRanges");
+
+    QTest::newRow("single entry")
+            << (QVector<int>() << 3)
+            << (QVector<qint64>() << 145 << 60);
+
+    QTest::newRow("adjacent entries are merged")
+            << (QVector<int>() << 1 << 0)
+            << (QVector<qint64>() << 0 << 110);
+
+    QTest::newRow("separate entries")
+            << (QVector<int>() << 0 << 3)
+            << (QVector<qint64>() << 0 << 55 << 145 << 60);
+
+    QTest::newRow("last entry ends with the central directory")
+            << (QVector<int>() << 12)
+            << (QVector<qint64>() << 634 << 40);
+
+    QTest::newRow("nothing")
+            << QVector<int>()
+            << QVector<qint64>();
+}
+
+void ZipCentralDirectoryTest::testRanges()
+{
+    QFETCH(QVector<int>, indexes);
+    QFETCH(QVector<qint64>, expectedRanges);
+
+    QFile file(QFINDTESTDATA("data/test.zip"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    ZipCentralDirectory centralDirectory;
+    QVERIFY(centralDirectory.read(&file));
+
+    QVector<qint64> ranges;
+    foreach (const ZipRangeReader::Range &range, ZipRangeReader::rangesFor(centralDirectory, indexes)) {
+        ranges << range.offset << range.length;
+    }
+
+    QCOMPARE(ranges, expectedRanges);
+}
+
+void ZipCentralDirectoryTest::testNotZip()
+{
+    QFile file(QFINDTESTDATA("zipcentraldirectorytest.cpp"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    ZipCentralDirectory centralDirectory;
+    QVERIFY(!centralDirectory.read(&file));
+    QVERIFY(centralDirectory.records().isEmpty());
+    QVERIFY(!centralDirectory.errorString().isEmpty());
+}
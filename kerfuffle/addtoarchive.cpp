@@ -144,7 +144,7 @@ void AddToArchive::slotStartJob()
 
     Kerfuffle::Archive *archive;
     if (!m_filename.isEmpty()) {
-        archive = Kerfuffle::Archive::create(m_filename, m_mimeType, this);
+        archive = Kerfuffle::Archive::createEditable(m_filename, m_mimeType, this);
         qCDebug(ARK) << "Set filename to " << m_filename;
     } else {
         if (m_autoFilenameSuffix.isEmpty()) {
@@ -172,7 +172,7 @@ void AddToArchive::slotStartJob()
         }
 
         qCDebug(ARK) << "Autoset filename to "<< finalName;
-        archive = Kerfuffle::Archive::create(finalName, m_mimeType, this);
+        archive = Kerfuffle::Archive::createEditable(finalName, m_mimeType, this);
     }
 
     Q_ASSERT(archive);
@@ -32,11 +32,14 @@
 #include "jobs.h"
 #include "mimetypes.h"
 #include "pluginmanager.h"
+#include "zipcentraldirectory.h"
 
 #include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
 
 #include <KPluginFactory>
-#include <KPluginLoader>
 
 namespace Kerfuffle
 {
@@ -53,7 +56,28 @@ Archive *Archive::create(const QString &fileName, const QString &fixedMimeType,
     PluginManager pluginManager;
     const QMimeType mimeType = fixedMimeType.isEmpty() ? determineMimeType(fileName) : QMimeDatabase().mimeTypeForName(fixedMimeType);
 
-    const QVector<Plugin*> offers = pluginManager.preferredPluginsFor(mimeType);
+    return create(fileName, pluginManager.preferredPluginsFor(mimeType), parent);
+}
+
+Archive *Archive::createEditable(const QString &fileName, const QString &fixedMimeType, QObject *parent)
+{
+    qCDebug(ARK) << "Going to create editable archive" << fileName;
+
+    PluginManager pluginManager;
+    const QMimeType mimeType = fixedMimeType.isEmpty() ? determineMimeType(fileName) : QMimeDatabase().mimeTypeForName(fixedMimeType);
+
+    QVector<Plugin*> offers = pluginManager.preferredWritePluginsFor(mimeType);
+    foreach (Plugin *plugin, pluginManager.preferredPluginsFor(mimeType)) {
+        if (!offers.contains(plugin)) {
+            offers << plugin;
+        }
+    }
+
+    return create(fileName, offers, parent);
+}
+
+Archive *Archive::create(const QString &fileName, const QVector<Plugin*> &offers, QObject *parent)
+{
     if (offers.isEmpty()) {
         qCCritical(ARK) << "Could not find a plugin to handle" << fileName;
         return new Archive(NoPlugin, parent);
@@ -78,7 +102,7 @@ Archive *Archive::create(const QString &fileName, Plugin *plugin, QObject *paren
 
     qCDebug(ARK) << "Checking plugin" << plugin->metaData().pluginId();
 
-    KPluginFactory *factory = KPluginLoader(plugin->metaData().fileName()).factory();
+    KPluginFactory *factory = plugin->factory();
     if (!factory) {
         qCWarning(ARK) << "Invalid plugin factory for" << plugin->metaData().pluginId();
         return new Archive(FailedPlugin, parent);
@@ -96,6 +120,14 @@ Archive *Archive::create(const QString &fileName, Plugin *plugin, QObject *paren
         return new Archive(FailedPlugin, parent);
     }
 
+    // The plugin may not be able to handle this particular archive, e.g. a read-only
+    // one which doesn't support some feature used by it.
+    if (!iface->open()) {
+        qCDebug(ARK) << "Plugin" << plugin->metaData().pluginId() << "cannot open" << fileName;
+        delete iface;
+        return new Archive(FailedPlugin, parent);
+    }
+
     qCDebug(ARK) << "Successfully loaded plugin" << plugin->metaData().pluginId();
     return new Archive(iface, !plugin->isReadWrite(), parent);
 }
@@ -103,6 +135,8 @@ Archive *Archive::create(const QString &fileName, Plugin *plugin, QObject *paren
 Archive::Archive(ArchiveError errorCode, QObject *parent)
         : QObject(parent)
         , m_iface(Q_NULLPTR)
+        , m_metaDataJob(Q_NULLPTR)
+        , m_hasBeenListed(false)
         , m_error(errorCode)
 {
     qCDebug(ARK) << "Created archive instance with error";
@@ -111,6 +145,7 @@ Archive::Archive(ArchiveError errorCode, QObject *parent)
 Archive::Archive(ReadOnlyArchiveInterface *archiveInterface, bool isReadOnly, QObject *parent)
         : QObject(parent)
         , m_iface(archiveInterface)
+        , m_metaDataJob(Q_NULLPTR)
         , m_hasBeenListed(false)
         , m_isReadOnly(isReadOnly)
         , m_isSingleFolderArchive(false)
@@ -130,6 +165,13 @@ Archive::Archive(ReadOnlyArchiveInterface *archiveInterface, bool isReadOnly, QO
 
 Archive::~Archive()
 {
+    // The listing started by loadMetaData() uses the interface, which is deleted
+    // along with this archive, from the thread of the job.
+    if (m_metaDataJob) {
+        disconnect(m_metaDataJob, Q_NULLPTR, this, Q_NULLPTR);
+        m_metaDataJob->killAndWait();
+        m_metaDataJob = Q_NULLPTR;
+    }
 }
 
 QString Archive::completeBaseName() const
@@ -256,6 +298,67 @@ QString Archive::subfolderName()
     return m_subfolderName;
 }
 
+void Archive::loadMetaData()
+{
+    if (m_metaDataJob) {
+        return;
+    }
+
+    if (!m_hasBeenListed) {
+        m_metaDataJob = list();
+    }
+
+    if (!m_metaDataJob) {
+        QMetaObject::invokeMethod(this, "metaDataLoaded", Qt::QueuedConnection);
+        return;
+    }
+
+    connect(m_metaDataJob, &ListJob::userQuery, this, &Archive::onUserQuery);
+    connect(m_metaDataJob, &KJob::result, this, &Archive::onMetaDataListed);
+    m_metaDataJob->start();
+}
+
+bool Archive::hasMetaData() const
+{
+    return m_hasBeenListed;
+}
+
+void Archive::onMetaDataListed(KJob *job)
+{
+    Q_UNUSED(job)
+    m_metaDataJob = Q_NULLPTR;
+    emit metaDataLoaded();
+}
+
+qulonglong Archive::estimatedUnpackedSize()
+{
+    if (!isValid()) {
+        return 0;
+    }
+
+    if (m_hasBeenListed) {
+        return m_extractedFilesSize;
+    }
+
+    QFile file(fileName());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    const QMimeType mime = mimeType();
+    if (mime.inherits(QStringLiteral("application/zip"))) {
+        ZipCentralDirectory centralDirectory;
+        return centralDirectory.read(&file) ? centralDirectory.unpackedSize() : 0;
+    }
+
+    // The ISIZE field ending gzip files.
+    if (mime.inherits(QStringLiteral("application/gzip")) && file.size() >= 18 && file.seek(file.size() - 4)) {
+        return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(file.read(4).constData()));
+    }
+
+    return 0;
+}
+
 void Archive::onNewEntry(const Archive::Entry *entry)
 {
     if (!entry->isDir()) {
@@ -397,6 +500,21 @@ PreviewJob *Archive::preview(Archive::Entry *entry)
     return job;
 }
 
+EntryDeviceJob *Archive::openEntryDevice(Archive::Entry *entry)
+{
+    if (!isValid()) {
+        return Q_NULLPTR;
+    }
+
+    // Password prompts are handled by the jobs, so let PreviewJob deal with encrypted archives.
+    if (encryptionType() != Unencrypted && m_iface->password().isEmpty()) {
+        return Q_NULLPTR;
+    }
+
+    EntryDeviceJob *job = new EntryDeviceJob(entry, m_iface);
+    return job;
+}
+
 OpenJob *Archive::open(Archive::Entry *entry)
 {
     if (!isValid()) {
@@ -462,17 +580,22 @@ void Archive::onListFinished(KJob* job)
 void Archive::listIfNotListed()
 {
     if (!m_hasBeenListed) {
-        ListJob *job = list();
+        // The listing started by loadMetaData() is waited for, if any.
+        ListJob *job = m_metaDataJob;
         if (!job) {
-            return;
+            job = list();
+            if (!job) {
+                return;
+            }
+            connect(job, &ListJob::userQuery, this, &Archive::onUserQuery);
         }
 
-        connect(job, &ListJob::userQuery, this, &Archive::onUserQuery);
-
         QEventLoop loop(this);
 
         connect(job, &KJob::result, &loop, &QEventLoop::quit);
-        job->start();
+        if (job != m_metaDataJob) {
+            job->start();
+        }
         loop.exec(); // krazy:exclude=crashy
     }
 }
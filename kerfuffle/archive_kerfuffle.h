@@ -49,6 +49,7 @@ class AddJob;
 class MoveJob;
 class CopyJob;
 class CommentJob;
+class EntryDeviceJob;
 class TestJob;
 class OpenJob;
 class OpenWithJob;
@@ -114,12 +115,40 @@ public:
     qulonglong unpackedSize();
     qulonglong packedSize() const;
     QString subfolderName();
+
+    /**
+     * Loads isSingleFolderArchive(), subfolderName(), encryptionType(), numberOfFiles()
+     * and unpackedSize() in the background, listing the archive if it has not been
+     * listed yet. Unlike these getters, this never blocks the caller.
+     * metaDataLoaded() is emitted from the event loop once they are known.
+     */
+    void loadMetaData();
+
+    /**
+     * @return Whether the metadata is known, so that the getters return right away.
+     */
+    bool hasMetaData() const;
+
+    /**
+     * @return The unpacked size found without listing the archive, from the central
+     * directory of zip archives or the size stored at the end of gzip files (modulo
+     * 4 GB, for the whole tar of compressed tarballs). 0 if it can't be found this way.
+     * Same as unpackedSize() once the archive has been listed.
+     */
+    qulonglong estimatedUnpackedSize();
+
     void setCompressionOptions(const CompressionOptions &opts);
     CompressionOptions compressionOptions() const;
 
     static Archive *create(const QString &fileName, QObject *parent = 0);
     static Archive *create(const QString &fileName, const QString &fixedMimeType, QObject *parent = 0);
 
+    /**
+     * Like create(), but tries the read-write plugins first, so that the archive can be modified.
+     * The read-only plugins, which may read some formats faster, are only used if none of them is usable.
+     */
+    static Archive *createEditable(const QString &fileName, const QString &fixedMimeType, QObject *parent = Q_NULLPTR);
+
     /**
      * Create an archive instance from a given @p plugin.
      * @param fileName The name of the archive.
@@ -149,6 +178,18 @@ public:
      *
      * GlobalWorkDir - Change to this dir before adding the new files.
      * The path names should then be added relative to this directory.
+     *
+     * Compression options handled by the interfaces whose format has hardlinks:
+     *
+     * DeduplicateContent - Store the files with the same content, permissions and
+     * owner as hardlinks to the first one. See AddJob::bytesSaved().
+     *
+     * Compression options handled only if the ArchiveFormat advertises them:
+     *
+     * DictionarySize - The dictionary (window) size, in KiB.
+     * BlockSize - The solid block (or frame) size, in KiB.
+     * Threads - The number of compression threads.
+     * LongDistanceMatching - Whether to look for matches beyond the default window.
      */
     AddJob* addFiles(const QList<Archive::Entry*> &files, const Archive::Entry *destination, const CompressionOptions& options = CompressionOptions());
 
@@ -176,6 +217,14 @@ public:
     ExtractJob* extractFiles(const QList<Archive::Entry*> &files, const QString &destinationDir, const ExtractionOptions &options = ExtractionOptions());
 
     PreviewJob* preview(Archive::Entry *entry);
+
+    /**
+     * Returns a job opening a device which streams the contents of @p entry, or a null
+     * pointer if the entry has to be extracted with preview() instead.
+     * The job fails if the plugin cannot decode the entry on demand.
+     */
+    EntryDeviceJob *openEntryDevice(Archive::Entry *entry);
+
     OpenJob* open(Archive::Entry *entry);
     OpenWithJob* openWith(Archive::Entry *entry);
 
@@ -185,8 +234,15 @@ public:
      */
     void encrypt(const QString &password, bool encryptHeader);
 
+signals:
+    /**
+     * Emitted when the metadata requested by loadMetaData() is known.
+     */
+    void metaDataLoaded();
+
 private slots:
     void onListFinished(KJob*);
+    void onMetaDataListed(KJob*);
     void onAddFinished(KJob*);
     void onUserQuery(Kerfuffle::Query*);
     void onNewEntry(const Archive::Entry *entry);
@@ -195,8 +251,14 @@ private:
     Archive(ReadOnlyArchiveInterface *archiveInterface, bool isReadOnly, QObject *parent = 0);
     Archive(ArchiveError errorCode, QObject *parent = 0);
 
+    /**
+     * Creates the archive with the first usable plugin among @p offers.
+     */
+    static Archive *create(const QString &fileName, const QVector<Plugin*> &offers, QObject *parent);
+
     void listIfNotListed();
     ReadOnlyArchiveInterface *m_iface;
+    ListJob *m_metaDataJob;
     bool m_hasBeenListed;
     bool m_isReadOnly;
     bool m_isSingleFolderArchive;
@@ -35,6 +35,7 @@ Archive::Entry::Entry(QObject *parent, QString fullPath, QString rootNode)
     , m_compressedSize(0)
     , m_isDirectory(false)
     , m_isPasswordProtected(false)
+    , m_solidBlock(-1)
 {
     if (!fullPath.isEmpty())
         setFullPath(fullPath);
@@ -62,6 +63,7 @@ void Archive::Entry::copyMetaData(const Archive::Entry *sourceEntry)
     setProperty("isDirectory", sourceEntry->property("isDirectory"));
     setProperty("comment", sourceEntry->property("comment"));
     setProperty("isPasswordProtected", sourceEntry->property("isPasswordProtected"));
+    setProperty("solidBlock", sourceEntry->property("solidBlock"));
 }
 
 QVector<Archive::Entry*> Archive::Entry::entries()
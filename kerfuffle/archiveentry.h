@@ -67,6 +67,8 @@ class Archive::Entry : public QObject
     Q_PROPERTY(bool isDirectory MEMBER m_isDirectory WRITE setIsDirectory)
     Q_PROPERTY(QString comment MEMBER m_comment)
     Q_PROPERTY(bool isPasswordProtected MEMBER m_isPasswordProtected)
+    // Index of the solid block holding the entry, -1 if it can be extracted on its own.
+    Q_PROPERTY(int solidBlock MEMBER m_solidBlock)
 
 public:
 
@@ -120,6 +122,7 @@ private:
     bool m_isDirectory;
     QString m_comment;
     bool m_isPasswordProtected;
+    int m_solidBlock;
 };
 
 QDebug KERFUFFLE_EXPORT operator<<(QDebug d, const Kerfuffle::Archive::Entry &entry);
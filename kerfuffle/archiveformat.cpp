@@ -29,7 +29,13 @@ namespace Kerfuffle
 {
 
 ArchiveFormat::ArchiveFormat() :
-    m_encryptionType(Archive::Unencrypted)
+    m_encryptionType(Archive::Unencrypted),
+    m_minDictionarySize(0),
+    m_maxDictionarySize(0),
+    m_minBlockSize(0),
+    m_maxBlockSize(0),
+    m_supportsThreads(false),
+    m_supportsLongDistanceMatching(false)
 {
 }
 
@@ -46,7 +52,13 @@ ArchiveFormat::ArchiveFormat(const QMimeType& mimeType,
     m_maxCompressionLevel(maxCompLevel),
     m_defaultCompressionLevel(defaultCompLevel),
     m_supportsWriteComment(supportsWriteComment),
-    m_supportsTesting(supportsTesting)
+    m_supportsTesting(supportsTesting),
+    m_minDictionarySize(0),
+    m_maxDictionarySize(0),
+    m_minBlockSize(0),
+    m_maxBlockSize(0),
+    m_supportsThreads(false),
+    m_supportsLongDistanceMatching(false)
 {
 }
 
@@ -74,7 +86,17 @@ ArchiveFormat ArchiveFormat::fromMetadata(const QMimeType& mimeType, const KPlug
             encType = Archive::Encrypted;
         }
 
-        return ArchiveFormat(mimeType, encType, minCompLevel, maxCompLevel, defaultCompLevel, supportsWriteComment, supportsTesting);
+        ArchiveFormat format(mimeType, encType, minCompLevel, maxCompLevel, defaultCompLevel, supportsWriteComment, supportsTesting);
+
+        // Optional tuning knobs, in KiB where applicable.
+        format.m_minDictionarySize = formatProps[QStringLiteral("DictionarySizeMin")].toInt();
+        format.m_maxDictionarySize = formatProps[QStringLiteral("DictionarySizeMax")].toInt();
+        format.m_minBlockSize = formatProps[QStringLiteral("BlockSizeMin")].toInt();
+        format.m_maxBlockSize = formatProps[QStringLiteral("BlockSizeMax")].toInt();
+        format.m_supportsThreads = formatProps[QStringLiteral("SupportsThreads")].toBool();
+        format.m_supportsLongDistanceMatching = formatProps[QStringLiteral("SupportsLongDistanceMatching")].toBool();
+
+        return format;
     }
 
     return ArchiveFormat();
@@ -115,4 +137,34 @@ bool ArchiveFormat::supportsTesting() const
     return m_supportsTesting;
 }
 
+int ArchiveFormat::minDictionarySize() const
+{
+    return m_minDictionarySize;
+}
+
+int ArchiveFormat::maxDictionarySize() const
+{
+    return m_maxDictionarySize;
+}
+
+int ArchiveFormat::minBlockSize() const
+{
+    return m_minBlockSize;
+}
+
+int ArchiveFormat::maxBlockSize() const
+{
+    return m_maxBlockSize;
+}
+
+bool ArchiveFormat::supportsThreads() const
+{
+    return m_supportsThreads;
+}
+
+bool ArchiveFormat::supportsLongDistanceMatching() const
+{
+    return m_supportsLongDistanceMatching;
+}
+
 }
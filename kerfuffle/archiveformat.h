@@ -66,6 +66,28 @@ public:
     bool supportsWriteComment() const;
     bool supportsTesting() const;
 
+    /**
+     * @return The range of dictionary sizes (in KiB) the format accepts, or 0 if it cannot be set.
+     */
+    int minDictionarySize() const;
+    int maxDictionarySize() const;
+
+    /**
+     * @return The range of (solid) block sizes (in KiB) the format accepts, or 0 if it cannot be set.
+     */
+    int minBlockSize() const;
+    int maxBlockSize() const;
+
+    /**
+     * @return Whether the number of compression threads can be set.
+     */
+    bool supportsThreads() const;
+
+    /**
+     * @return Whether long-distance matching can be enabled.
+     */
+    bool supportsLongDistanceMatching() const;
+
 private:
     QMimeType m_mimeType;
     Kerfuffle::Archive::EncryptionType m_encryptionType;
@@ -74,6 +96,12 @@ private:
     int m_defaultCompressionLevel;
     bool m_supportsWriteComment;
     bool m_supportsTesting;
+    int m_minDictionarySize;
+    int m_maxDictionarySize;
+    int m_minBlockSize;
+    int m_maxBlockSize;
+    bool m_supportsThreads;
+    bool m_supportsLongDistanceMatching;
 };
 
 }
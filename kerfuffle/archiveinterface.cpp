@@ -129,6 +129,12 @@ bool ReadOnlyArchiveInterface::waitForFinishedSignal()
     return m_waitForFinishedSignal;
 }
 
+QIODevice *ReadOnlyArchiveInterface::createEntryDevice(Archive::Entry *entry)
+{
+    Q_UNUSED(entry)
+    return Q_NULLPTR;
+}
+
 int ReadOnlyArchiveInterface::moveRequiredSignals() const {
     return 1;
 }
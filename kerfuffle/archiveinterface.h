@@ -39,6 +39,8 @@
 #include <QString>
 #include <QVariantList>
 
+class QIODevice;
+
 namespace Kerfuffle
 {
 class Query;
@@ -99,6 +101,21 @@ public:
      * the user of the error condition.
      */
     virtual bool extractFiles(const QList<Archive::Entry*> &files, const QString &destinationDirectory, const ExtractionOptions &options) = 0;
+
+    /**
+     * Creates a device which decodes the contents of @p entry on demand, without
+     * extracting it to the disk first.
+     *
+     * This is called by EntryDeviceJob, and may block while the device is positioned
+     * on the entry unless you called setWaitForFinishedSignal(true).
+     * The returned device is already open for reading and is owned by the caller.
+     * It must not share any state with this interface, since it is read from the
+     * GUI thread and may outlive any running job.
+     * The default implementation returns a null pointer, which means that the entry
+     * has to be extracted to a temporary location instead (see PreviewJob).
+     */
+    virtual QIODevice *createEntryDevice(Archive::Entry *entry);
+
     bool waitForFinishedSignal();
 
     /**
@@ -162,6 +179,7 @@ signals:
     void finished(bool result);
     void userQuery(Query *query);
     void testSuccess();
+    void bytesSaved(qlonglong bytes);
 
 protected:
 
@@ -29,6 +29,8 @@
 
 #include "cliinterface.h"
 #include "ark_debug.h"
+#include "conflictdecisions.h"
+#include "plugin.h"
 #include "queries.h"
 
 #ifdef Q_OS_WIN
@@ -36,6 +38,14 @@
 #else
 # include <KPtyDevice>
 # include <KPtyProcess>
+
+# include <dirent.h>
+# include <fcntl.h>
+# include <sys/stat.h>
+# include <unistd.h>
+# include <cerrno>
+# include <cstdio>
+# include <cstring>
 #endif
 
 #include <KLocalizedString>
@@ -47,24 +57,281 @@
 #include <QDirIterator>
 #include <QEventLoop>
 #include <QFile>
+#include <QFileInfo>
 #include <QProcess>
 #include <QRegularExpression>
+#include <QSet>
 #include <QStandardPaths>
+#include <QStorageInfo>
 #include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QThread>
 #include <QTimer>
 #include <QUrl>
+#include <QtConcurrentMap>
 
 namespace Kerfuffle
 {
+
+// Solid blocks bigger than this are not worth extracting to open a single file.
+static const qulonglong s_solidBlockSizeLimit = 64 * 1024 * 1024;
+// Above this, the blocks extracted so far are dropped before extracting a new one.
+static const qulonglong s_solidBlockCacheLimit = 256 * 1024 * 1024;
+// Keeps the command line of the extraction of a whole block reasonably short.
+static const int s_solidBlockFilesLimit = 1000;
+
+#ifndef Q_OS_WIN
+
+/**
+ * A file (or an empty directory) to be moved out of the temporary extraction dir.
+ * Paths are kept encoded and relative to the temporary and destination dirs.
+ */
+struct PendingMove
+{
+    QByteArray source;
+    QByteArray destination;
+    bool isDir;
+    bool skip;
+};
+
+/**
+ * All the moves below one top-level entry of the temporary extraction dir.
+ * When the paths are preserved, subtrees are disjoint and can be moved in parallel.
+ */
+struct MoveSubtree
+{
+    QByteArray name;
+    bool moveWhole;
+    QVector<PendingMove> moves;
+};
+
+/**
+ * Lists the files and empty directories below @p dirFd, taking ownership of it.
+ */
+static bool scanTree(int dirFd, const QByteArray &prefix, bool preservePaths, QVector<PendingMove> &moves)
+{
+    DIR *dir = fdopendir(dirFd);
+    if (!dir) {
+        close(dirFd);
+        return false;
+    }
+
+    bool result = true;
+    bool isEmpty = true;
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        isEmpty = false;
+
+        bool isDir = (entry->d_type == DT_DIR);
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat st;
+            isDir = (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode));
+        }
+
+        const QByteArray path = prefix + entry->d_name;
+        if (isDir) {
+            const int childFd = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (childFd < 0 || !scanTree(childFd, path + '/', preservePaths, moves)) {
+                result = false;
+            }
+        } else {
+            moves.append({path, preservePaths ? path : QByteArray(entry->d_name), false, false});
+        }
+    }
+    closedir(dir);
+
+    // Only empty directories need to be moved explicitly, the others are
+    // created when moving their children.
+    if (isEmpty && preservePaths && !prefix.isEmpty()) {
+        const QByteArray path = prefix.left(prefix.size() - 1);
+        moves.append({path, path, true, false});
+    }
+
+    return result;
+}
+
+/**
+ * Creates the parent directories of @p path below @p destFd, skipping the ones
+ * found in @p createdDirs.
+ */
+static bool createParentDirs(int destFd, const QByteArray &path, QSet<QByteArray> &createdDirs)
+{
+    QByteArray buffer(path);
+    char *data = buffer.data();
+
+    for (int i = 0; i < buffer.size(); ++i) {
+        if (data[i] != '/') {
+            continue;
+        }
+
+        const QByteArray dir = QByteArray::fromRawData(data, i);
+        if (createdDirs.contains(dir)) {
+            continue;
+        }
+
+        data[i] = '\0';
+        const bool created = (mkdirat(destFd, data, 0777) == 0 || errno == EEXIST);
+        data[i] = '/';
+        if (!created) {
+            qCWarning(ARK) << "Failed to create directory" << QByteArray(data, i) << ":" << strerror(errno);
+            return false;
+        }
+
+        createdDirs.insert(QByteArray(data, i));
+    }
+
+    return true;
+}
+
+/**
+ * Moves all the entries of @p subtree from @p tempFd to @p destFd, copying them when
+ * they cannot be renamed (e.g. if the destination is on another filesystem).
+ */
+static bool moveSubtree(int tempFd, int destFd, const QString &tempPath, const QString &destPath, MoveSubtree &subtree)
+{
+    if (subtree.moveWhole) {
+        if (renameat(tempFd, subtree.name.constData(), destFd, subtree.name.constData()) == 0) {
+            return true;
+        }
+
+        if (errno != EXDEV) {
+            qCWarning(ARK) << "Failed to move" << subtree.name << "to final destination:" << strerror(errno);
+            return false;
+        }
+
+        // Fall back to copying the files one by one.
+        const int childFd = openat(tempFd, subtree.name.constData(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (childFd < 0 || !scanTree(childFd, subtree.name + '/', true, subtree.moves)) {
+            return false;
+        }
+    }
+
+    QSet<QByteArray> createdDirs;
+    bool result = true;
+
+    foreach (const PendingMove &move, subtree.moves) {
+        if (move.skip) {
+            continue;
+        }
+
+        if (!createParentDirs(destFd, move.isDir ? move.destination + '/' : move.destination, createdDirs)) {
+            result = false;
+            continue;
+        }
+
+        if (move.isDir) {
+            continue;
+        }
+
+        // renameat() atomically replaces any existing file.
+        if (renameat(tempFd, move.source.constData(), destFd, move.destination.constData()) == 0) {
+            continue;
+        }
+
+        if (errno != EXDEV) {
+            qCWarning(ARK) << "Failed to move" << move.source << "to final destination:" << strerror(errno);
+            result = false;
+            continue;
+        }
+
+        const QString source = tempPath + QLatin1Char('/') + QFile::decodeName(move.source);
+        const QString destination = destPath + QLatin1Char('/') + QFile::decodeName(move.destination);
+        QFile::remove(destination);
+        if (!QFile::copy(source, destination) || !QFile::remove(source)) {
+            qCWarning(ARK) << "Failed to copy" << source << "to final destination.";
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+#endif
+
+/**
+ * Renames @p source to @p destination. When this fails because they are on different
+ * filesystems, @p crossDevice is set and the file has to be copied instead. Any other
+ * failure is an error.
+ */
+static bool renameFile(const QString &source, const QString &destination, bool &crossDevice)
+{
+#ifndef Q_OS_WIN
+    if (rename(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData()) == 0) {
+        crossDevice = false;
+        return true;
+    }
+    crossDevice = (errno == EXDEV);
+    if (!crossDevice) {
+        qCWarning(ARK) << "Failed to move" << source << "to" << destination << ":" << strerror(errno);
+    }
+#else
+    if (QDir().rename(source, destination)) {
+        crossDevice = false;
+        return true;
+    }
+    // The reason of the failure is not available, so compare the volumes instead.
+    crossDevice = (QStorageInfo(QFileInfo(source).absolutePath()) != QStorageInfo(QFileInfo(destination).absolutePath()));
+    if (!crossDevice) {
+        qCWarning(ARK) << "Failed to move" << source << "to" << destination;
+    }
+#endif
+    return false;
+}
+
+/**
+ * Returns the template of the temporary dir to extract to before moving the files to
+ * @p destination. It is created outside of the destination, but preferably on the same
+ * filesystem so that the files can be renamed into place instead of being copied.
+ */
+static QString extractTempDirTemplate(const QString &destination)
+{
+    const QString tempDirName = QApplication::applicationName() + QLatin1Char('-');
+    const QStorageInfo destinationStorage(destination);
+
+    if (destinationStorage.isValid()) {
+        const QStringList candidates = {QDir::tempPath(), QStandardPaths::writableLocation(QStandardPaths::CacheLocation)};
+        foreach (const QString &candidate, candidates) {
+            if (!candidate.isEmpty() && QDir().mkpath(candidate) && QStorageInfo(candidate) == destinationStorage) {
+                return QDir(candidate).absoluteFilePath(tempDirName);
+            }
+        }
+    }
+
+    return QDir::temp().absoluteFilePath(tempDirName);
+}
+
+/**
+ * Copies each source file of @p moves to its destination in parallel and removes
+ * the source afterwards. Used when a rename is not possible across filesystems.
+ *
+ * @return Whether all the files have been moved.
+ */
+static bool copyAcrossFilesystems(QVector<QPair<QString, QString> > moves)
+{
+    QAtomicInt failures;
+    QtConcurrent::blockingMap(moves, [&failures](const QPair<QString, QString> &move) {
+        if (!QFile::copy(move.first, move.second) || !QFile::remove(move.first)) {
+            qCWarning(ARK) << "Failed to move file" << move.first << "to" << move.second;
+            failures.ref();
+        }
+    });
+
+    return failures.load() == 0;
+}
+
 CliInterface::CliInterface(QObject *parent, const QVariantList & args)
         : ReadWriteArchiveInterface(parent, args),
         m_process(0),
         m_listEmptyLines(false),
         m_abortingOperation(false),
         m_extractTempDir(Q_NULLPTR),
-        m_commentTempFile(Q_NULLPTR)
+        m_commentTempFile(Q_NULLPTR),
+        m_solidBlockCacheDir(Q_NULLPTR),
+        m_solidBlockCacheSize(0),
+        m_extractingSolidBlock(-1)
 {
     //because this interface uses the event loop
     setWaitForFinishedSignal(true);
@@ -88,6 +355,9 @@ CliInterface::~CliInterface()
 {
     Q_ASSERT(!m_process);
     delete m_commentTempFile;
+    qDeleteAll(m_addedEntries);
+    qDeleteAll(m_solidBlockEntries);
+    delete m_solidBlockCacheDir;
 }
 
 void CliInterface::setListEmptyLines(bool emptyLines)
@@ -104,6 +374,7 @@ bool CliInterface::list()
 {
     resetParsing();
     cacheParameterList();
+    clearSolidBlocks();
     m_operationMode = List;
 
     const auto args = substituteListVariables(m_param.value(ListArgs).toStringList(), password());
@@ -124,6 +395,7 @@ bool CliInterface::extractFiles(const QList<Archive::Entry*> &files, const QStri
     m_compressionOptions = options;
     m_extractedFiles = files;
     m_extractDestDir = destinationDirectory;
+    m_conflictDecisions = ConflictDecisions(options);
     const QStringList extractArgs = m_param.value(ExtractArgs).toStringList();
 
     if (extractArgs.contains(QStringLiteral("$PasswordSwitch")) &&
@@ -135,14 +407,55 @@ bool CliInterface::extractFiles(const QList<Archive::Entry*> &files, const QStri
         }
     }
 
+    // Opening the files of a solid block one by one would decompress the block
+    // from its start every time, so the whole block is extracted once instead.
+    const int solidBlock = cachableSolidBlock(files, destinationDirectory, options);
+    if (solidBlock != -1 && m_cachedSolidBlocks.contains(solidBlock)) {
+        qCDebug(ARK) << "Extracting" << files.first()->fullPath() << "from the cached solid block" << solidBlock;
+        if (!copyFromSolidBlockCache(files.first(), destinationDirectory)) {
+            emit error(i18n("Extraction failed because of an unexpected error."));
+            emit finished(false);
+            return false;
+        }
+        emit progress(1.0);
+        emit finished(true);
+        return true;
+    }
+
+    if (solidBlock != -1) {
+        if (m_solidBlockCacheSize + m_solidBlocks.value(solidBlock).size > s_solidBlockCacheLimit) {
+            qCDebug(ARK) << "Dropping the cached solid blocks";
+            delete m_solidBlockCacheDir;
+            m_solidBlockCacheDir = Q_NULLPTR;
+            m_cachedSolidBlocks.clear();
+            m_solidBlockCacheSize = 0;
+        }
+        if (!m_solidBlockCacheDir) {
+            m_solidBlockCacheDir = new QTemporaryDir();
+        }
+
+        qDeleteAll(m_solidBlockEntries);
+        m_solidBlockEntries.clear();
+        foreach (const QString &fullPath, m_solidBlocks.value(solidBlock).fullPaths) {
+            m_solidBlockEntries << new Archive::Entry(Q_NULLPTR, fullPath);
+        }
+    }
+
+    const bool extractSolidBlock = (solidBlock != -1 && m_solidBlockCacheDir->isValid() &&
+                                    QDir().mkpath(solidBlockCachePath(solidBlock)));
+    if (extractSolidBlock) {
+        qCDebug(ARK) << "Extracting the solid block" << solidBlock << "with" << m_solidBlockEntries.size() << "files";
+        m_extractingSolidBlock = solidBlock;
+    }
+
     // Populate the argument list.
     const QStringList args = substituteExtractVariables(extractArgs,
-                                                        files,
+                                                        extractSolidBlock ? m_solidBlockEntries : files,
                                                         options.value(QStringLiteral("PreservePaths")).toBool(),
                                                         password());
 
     QUrl destDir = QUrl(destinationDirectory);
-    QDir::setCurrent(destDir.adjusted(QUrl::RemoveScheme).url());
+    m_workingDir = extractSolidBlock ? solidBlockCachePath(solidBlock) : destDir.adjusted(QUrl::RemoveScheme).url();
 
     bool useTmpExtractDir = options.value(QStringLiteral("DragAndDrop")).toBool() ||
                             options.value(QStringLiteral("AlwaysUseTmpDir")).toBool();
@@ -150,7 +463,7 @@ bool CliInterface::extractFiles(const QList<Archive::Entry*> &files, const QStri
     if (useTmpExtractDir) {
 
         Q_ASSERT(!m_extractTempDir);
-        m_extractTempDir = new QTemporaryDir(QApplication::applicationName() + QLatin1Char('-'));
+        m_extractTempDir = new QTemporaryDir(extractTempDirTemplate(destDir.adjusted(QUrl::RemoveScheme).url()));
 
         qCDebug(ARK) << "Using temporary extraction dir:" << m_extractTempDir->path();
         if (!m_extractTempDir->isValid()) {
@@ -158,9 +471,7 @@ bool CliInterface::extractFiles(const QList<Archive::Entry*> &files, const QStri
             emit finished(false);
             return false;
         }
-        m_oldWorkingDir = QDir::currentPath();
-        destDir = QUrl(m_extractTempDir->path());
-        QDir::setCurrent(destDir.adjusted(QUrl::RemoveScheme).url());
+        m_workingDir = m_extractTempDir->path();
     }
 
     if (!runProcess(m_param.value(ExtractProgram).toStringList(), args)) {
@@ -170,20 +481,83 @@ bool CliInterface::extractFiles(const QList<Archive::Entry*> &files, const QStri
     return true;
 }
 
+QIODevice *CliInterface::createEntryDevice(Archive::Entry *entry)
+{
+    cacheParameterList();
+
+    const QStringList streamArgs = m_param.value(ExtractToStdoutArgs).toStringList();
+    if (streamArgs.isEmpty()) {
+        return Q_NULLPTR;
+    }
+
+    // There is no terminal to answer a password prompt, so encrypted entries
+    // need to be extracted the usual way unless we already know the password.
+    if (entry->property("isPasswordProtected").toBool() && password().isEmpty()) {
+        return Q_NULLPTR;
+    }
+
+    QString programPath;
+    foreach (const QString &programName, m_param.value(ExtractProgram).toStringList()) {
+        programPath = Plugin::findExecutable(programName);
+        if (!programPath.isEmpty()) {
+            break;
+        }
+    }
+    if (programPath.isEmpty()) {
+        return Q_NULLPTR;
+    }
+
+    const QStringList args = substituteExtractVariables(streamArgs,
+                                                        QList<Archive::Entry*>() << entry,
+                                                        true,
+                                                        password());
+
+    qCDebug(ARK) << "Streaming" << entry->fullPath() << "with" << programPath << args;
+
+    // The process is started asynchronously, EntryDeviceJob waits for it.
+    QProcess *process = new QProcess;
+    process->setReadChannel(QProcess::StandardOutput);
+    process->start(programPath, args, QIODevice::ReadOnly);
+    // Make any unexpected prompt fail instead of waiting for input forever.
+    process->closeWriteChannel();
+
+    return process;
+}
+
 bool CliInterface::addFiles(const QList<Archive::Entry*> &files, const Archive::Entry *destination, const CompressionOptions& options)
 {
     cacheParameterList();
+    clearSolidBlocks();
 
     m_operationMode = Add;
 
     const QStringList addArgs = m_param.value(AddArgs).toStringList();
 
+    // The paths of the files are relative to GlobalWorkDir, if any.
+    const QString globalWorkDir = options.value(QStringLiteral("GlobalWorkDir")).toString();
+    m_workingDir = globalWorkDir.isEmpty() ? QDir::currentPath() : globalWorkDir;
+
     QList<Archive::Entry*> filesToPass = QList<Archive::Entry*>();
     // If destination path is specified, we have recreate its structure inside the temp directory
     // and then place symlinks of targeted files there.
     const QString destinationPath = (destination == Q_NULLPTR)
                                     ? QString()
                                     : destination->fullPath();
+
+    if (addArgs.contains(QStringLiteral("$PasswordSwitch")) &&
+        options.value(QStringLiteral("PasswordProtectedHint")).toBool() &&
+        password().isEmpty()) {
+        qCDebug(ARK) << "Password hint enabled, querying user";
+        if (!passwordQuery()) {
+            return false;
+        }
+    }
+
+    const bool isPasswordProtected = addArgs.contains(QStringLiteral("$PasswordSwitch")) && !password().isEmpty();
+    if (!setAddedEntries(files, destinationPath, isPasswordProtected)) {
+        qCDebug(ARK) << "Some of the added files were not found or are symlinks, the archive will be listed again";
+    }
+
     if (!destinationPath.isEmpty()) {
         m_extractTempDir = new QTemporaryDir();
         const QString absoluteDestinationPath = m_extractTempDir->path() + QLatin1Char('/') + destinationPath;
@@ -199,7 +573,7 @@ bool CliInterface::addFiles(const QList<Archive::Entry*> &files, const Archive::
                 preservedParent = file->parent();
             }
 
-            const QString filePath = QDir::currentPath() + QLatin1Char('/') + file->fullPath(true);
+            const QString filePath = m_workingDir + QLatin1Char('/') + file->fullPath(true);
             const QString newFilePath = absoluteDestinationPath + file->fullPath(true);
             if (QFile::link(filePath, newFilePath)) {
                 qCDebug(ARK) << "Symlink's created:" << filePath << newFilePath;
@@ -213,7 +587,7 @@ bool CliInterface::addFiles(const QList<Archive::Entry*> &files, const Archive::
         }
 
         qCDebug(ARK) << "Changing working dir again to " << m_extractTempDir->path();
-        QDir::setCurrent(m_extractTempDir->path());
+        m_workingDir = m_extractTempDir->path();
 
         filesToPass.push_back(new Archive::Entry(preservedParent, destinationPath.split(QLatin1Char('/'), QString::SkipEmptyParts).at(0)));
     }
@@ -221,22 +595,14 @@ bool CliInterface::addFiles(const QList<Archive::Entry*> &files, const Archive::
         filesToPass = files;
     }
 
-    if (addArgs.contains(QStringLiteral("$PasswordSwitch")) &&
-        options.value(QStringLiteral("PasswordProtectedHint")).toBool() &&
-        password().isEmpty()) {
-        qCDebug(ARK) << "Password hint enabled, querying user";
-        if (!passwordQuery()) {
-            return false;
-        }
-    }
-
     int compLevel = options.value(QStringLiteral("CompressionLevel"), -1).toInt();
 
     const auto args = substituteAddVariables(m_param.value(AddArgs).toStringList(),
                                              filesToPass,
                                              password(),
                                              isHeaderEncryptionEnabled(),
-                                             compLevel);
+                                             compLevel,
+                                             options);
 
     return runProcess(m_param.value(AddProgram).toStringList(), args);
 }
@@ -244,6 +610,7 @@ bool CliInterface::addFiles(const QList<Archive::Entry*> &files, const Archive::
 bool CliInterface::moveFiles(const QList<Archive::Entry*> &files, Archive::Entry *destination, const CompressionOptions &options)
 {
     cacheParameterList();
+    clearSolidBlocks();
     m_operationMode = Move;
 
     m_removedFiles = files;
@@ -259,10 +626,8 @@ bool CliInterface::moveFiles(const QList<Archive::Entry*> &files, Archive::Entry
 
 bool CliInterface::copyFiles(const QList<Archive::Entry*> &files, Archive::Entry *destination, const CompressionOptions &options)
 {
-    m_oldWorkingDir = QDir::currentPath();
     m_tempExtractDir = new QTemporaryDir();
     m_tempAddDir = new QTemporaryDir();
-    QDir::setCurrent(m_tempExtractDir->path());
     m_passedFiles = files;
     m_passedDestination = destination;
     m_passedOptions = options;
@@ -271,12 +636,13 @@ bool CliInterface::copyFiles(const QList<Archive::Entry*> &files, Archive::Entry
     m_subOperation = Extract;
     connect(this, &CliInterface::finished, this, &CliInterface::continueCopying);
 
-    return extractFiles(files, QDir::currentPath(), m_passedOptions);
+    return extractFiles(files, m_tempExtractDir->path(), m_passedOptions);
 }
 
 bool CliInterface::deleteFiles(const QList<Archive::Entry*> &files)
 {
     cacheParameterList();
+    clearSolidBlocks();
     m_operationMode = Delete;
 
     m_removedFiles = files;
@@ -319,7 +685,7 @@ bool CliInterface::runProcess(const QStringList& programNames, const QStringList
         return false;
     }
 
-    qCDebug(ARK) << "Executing" << programPath << arguments << "within directory" << QDir::currentPath();
+    qCDebug(ARK) << "Executing" << programPath << arguments << "within directory" << m_workingDir;
 
 #ifdef Q_OS_WIN
 
@@ -333,6 +699,12 @@ bool CliInterface::runProcess(const QStringList& programNames, const QStringList
     m_process->setNextOpenMode(QIODevice::ReadWrite | QIODevice::Unbuffered | QIODevice::Text);
     m_process->setProgram(programPath, arguments);
 
+    // Extracted and added files are relative to the working directory of the program.
+    // Ark's own working directory is shared by all the jobs and is never changed.
+    if (m_operationMode == Extract || m_operationMode == Add) {
+        m_process->setWorkingDirectory(m_workingDir);
+    }
+
     connect(m_process, SIGNAL(readyReadStandardOutput()), SLOT(readStdout()), Qt::DirectConnection);
 
     if (m_operationMode == Extract) {
@@ -388,7 +760,23 @@ void CliInterface::processFinished(int exitCode, QProcess::ExitStatus exitStatus
             delete m_extractTempDir;
             m_extractTempDir = Q_NULLPTR;
         }
-        list();
+
+        // The entries written are known beforehand, the whole archive is only
+        // listed again when they are not, or when the program failed.
+        if (m_exitCode != 0 || m_addedEntries.isEmpty()) {
+            qDeleteAll(m_addedEntries);
+            m_addedEntries.clear();
+            list();
+            return;
+        }
+
+        foreach (Archive::Entry *e, m_addedEntries) {
+            emit entry(e);
+        }
+        m_addedEntries.clear();
+
+        emit progress(1.0);
+        emit finished(true);
     } else if (m_operationMode == List && isCorrupt()) {
         Kerfuffle::LoadCorruptQuery query(filename());
         emit userQuery(&query);
@@ -421,6 +809,33 @@ void CliInterface::extractProcessFinished(int exitCode, QProcess::ExitStatus exi
         m_process = Q_NULLPTR;
     }
 
+    if (m_extractingSolidBlock != -1) {
+        const int block = m_extractingSolidBlock;
+        m_extractingSolidBlock = -1;
+        qDeleteAll(m_solidBlockEntries);
+        m_solidBlockEntries.clear();
+
+        // A failure of the program has already been reported while parsing its output.
+        if (m_exitCode != 0) {
+            QDir(solidBlockCachePath(block)).removeRecursively();
+            emit finished(false);
+            return;
+        }
+
+        m_cachedSolidBlocks << block;
+        m_solidBlockCacheSize += m_solidBlocks.value(block).size;
+
+        if (!copyFromSolidBlockCache(m_extractedFiles.first(), m_extractDestDir)) {
+            emit error(i18n("Extraction failed because of an unexpected error."));
+            emit finished(false);
+            return;
+        }
+
+        emit progress(1.0);
+        emit finished(true);
+        return;
+    }
+
     if (m_compressionOptions.value(QStringLiteral("AlwaysUseTmpDir")).toBool()) {
         // unar exits with code 1 if extraction fails.
         // This happens at least with wrong passwords or not enough space in the destination folder.
@@ -439,7 +854,7 @@ void CliInterface::extractProcessFinished(int exitCode, QProcess::ExitStatus exi
         }
 
         if (!m_compressionOptions.value(QStringLiteral("DragAndDrop")).toBool()) {
-            if (!moveToDestination(QDir::current(), QDir(m_extractDestDir), m_compressionOptions[QStringLiteral("PreservePaths")].toBool())) {
+            if (!moveToDestination(QDir(m_workingDir), QDir(m_extractDestDir), m_compressionOptions[QStringLiteral("PreservePaths")].toBool())) {
                 emit error(i18ncp("@info",
                                   "Could not move the extracted file to the destination directory.",
                                   "Could not move the extracted files to the destination directory.",
@@ -499,6 +914,8 @@ void CliInterface::continueCopying(bool result)
 bool CliInterface::moveDroppedFilesToDest(const QList<Archive::Entry*> &files, const QString &finalDest)
 {
     // Move extracted files from a QTemporaryDir to the final destination.
+    // The temporary dir is preferably on the destination's filesystem (see
+    // extractFiles()), so files and whole directories are simply renamed into place.
 
     QDir finalDestDir(finalDest);
     qCDebug(ARK) << "Setting final dir to" << finalDest;
@@ -506,15 +923,44 @@ bool CliInterface::moveDroppedFilesToDest(const QList<Archive::Entry*> &files, c
     bool overwriteAll = false;
     bool skipAll = false;
 
+    // Directories which have been moved as a whole, together with their children.
+    QStringList movedDirs;
+    // Files which could not be renamed, because they are on another filesystem.
+    QVector<QPair<QString, QString> > pendingCopies;
+    bool crossDevice = false;
+
     foreach (const Archive::Entry *file, files) {
 
-        QFileInfo relEntry(file->fullPath().remove(file->rootNode));
-        QFileInfo absSourceEntry(QDir::current().absolutePath() + QLatin1Char('/') + file->fullPath());
+        const QString fullPath = file->fullPath();
+        bool isInMovedDir = false;
+        foreach (const QString &movedDir, movedDirs) {
+            if (fullPath.startsWith(movedDir)) {
+                isInMovedDir = true;
+                break;
+            }
+        }
+        if (isInMovedDir) {
+            continue;
+        }
+
+        QFileInfo relEntry(QString(fullPath).remove(file->rootNode));
+        QFileInfo absSourceEntry(m_workingDir + QLatin1Char('/') + fullPath);
         QFileInfo absDestEntry(finalDestDir.path() + QLatin1Char('/') + relEntry.filePath());
 
         if (absSourceEntry.isDir()) {
 
-            // For directories, just create the path.
+            // Move the whole directory at once if nothing needs to be merged.
+            if (!absDestEntry.exists() && finalDestDir.mkpath(relEntry.path())) {
+                if (renameFile(absSourceEntry.absoluteFilePath(), absDestEntry.absoluteFilePath(), crossDevice)) {
+                    movedDirs << (fullPath.endsWith(QLatin1Char('/')) ? fullPath : fullPath + QLatin1Char('/'));
+                    continue;
+                }
+                if (!crossDevice) {
+                    return false;
+                }
+            }
+
+            // Otherwise just create the path, the children are moved one by one.
             if (!finalDestDir.mkpath(relEntry.filePath())) {
                 qCWarning(ARK) << "Failed to create directory" << relEntry.filePath() << "in final destination.";
             }
@@ -525,7 +971,17 @@ bool CliInterface::moveDroppedFilesToDest(const QList<Archive::Entry*> &files, c
             if (absDestEntry.exists()) {
                 qCWarning(ARK) << "File" << absDestEntry.absoluteFilePath() << "exists.";
 
-                if (!skipAll && !overwriteAll) {
+                const ConflictDecisions::Decision decision = m_conflictDecisions.decisionFor(absDestEntry.absoluteFilePath());
+
+                if (decision == ConflictDecisions::Skip) {
+                    continue;
+
+                } else if (decision == ConflictDecisions::Overwrite) {
+                    if (!QFile::remove(absDestEntry.absoluteFilePath())) {
+                        qCWarning(ARK) << "Failed to remove" << absDestEntry.absoluteFilePath();
+                    }
+
+                } else if (!skipAll && !overwriteAll) {
 
                     Kerfuffle::OverwriteQuery query(absDestEntry.absoluteFilePath());
                     query.setNoRenameMode(true);
@@ -568,13 +1024,22 @@ bool CliInterface::moveDroppedFilesToDest(const QList<Archive::Entry*> &files, c
                 qCWarning(ARK) << "Failed to create parent directory for file:" << absDestEntry.filePath();
             }
 
-            // Move files to the final destination.
-            if (!QFile(absSourceEntry.absoluteFilePath()).rename(absDestEntry.absoluteFilePath())) {
-                qCWarning(ARK) << "Failed to move file" << absSourceEntry.filePath() << "to final destination.";
-                return false;
+            // Move files to the final destination. Unlike QFile::rename(), renameFile()
+            // never falls back to copying, so the copies can be done in parallel below.
+            if (!renameFile(absSourceEntry.absoluteFilePath(), absDestEntry.absoluteFilePath(), crossDevice)) {
+                if (!crossDevice) {
+                    return false;
+                }
+                pendingCopies << qMakePair(absSourceEntry.absoluteFilePath(), absDestEntry.absoluteFilePath());
             }
         }
     }
+
+    if (!pendingCopies.isEmpty()) {
+        qCDebug(ARK) << "Copying" << pendingCopies.size() << "files to final destination";
+        return copyAcrossFilesystems(pendingCopies);
+    }
+
     return true;
 }
 
@@ -586,12 +1051,83 @@ bool CliInterface::isEmptyDir(const QDir &dir)
     return d.count() == 0;
 }
 
-void CliInterface::cleanUpExtracting()
+void CliInterface::setSolidBlock(Archive::Entry *entry, int block)
+{
+    entry->setProperty("solidBlock", block);
+
+    SolidBlock &solidBlock = m_solidBlocks[block];
+    solidBlock.fullPaths << entry->fullPath();
+    solidBlock.size += entry->property("size").toULongLong();
+}
+
+int CliInterface::cachableSolidBlock(const QList<Archive::Entry*> &files, const QString &destinationDirectory, const ExtractionOptions &options) const
+{
+    // Only the single files extracted to be opened or previewed, with their paths.
+    if (files.size() != 1 || !options.value(QStringLiteral("PreservePaths")).toBool() ||
+        options.value(QStringLiteral("DragAndDrop")).toBool() ||
+        options.value(QStringLiteral("AlwaysUseTmpDir")).toBool()) {
+        return -1;
+    }
+
+    // Encrypted files are not cached, so that their password is checked every time.
+    const Archive::Entry *entry = files.first();
+    const int block = entry->property("solidBlock").toInt();
+    if (block == -1 || !m_solidBlocks.contains(block) || entry->property("isPasswordProtected").toBool() ||
+        entry->fullPath().contains(QLatin1String("../"))) {
+        return -1;
+    }
+
+    const SolidBlock solidBlock = m_solidBlocks.value(block);
+    if (solidBlock.fullPaths.size() < 2 || solidBlock.fullPaths.size() > s_solidBlockFilesLimit ||
+        solidBlock.size > s_solidBlockSizeLimit || !solidBlock.fullPaths.contains(entry->fullPath())) {
+        return -1;
+    }
+
+    // Let the usual extraction deal with the conflicts.
+    if (QFileInfo::exists(QDir(destinationDirectory).filePath(entry->fullPath()))) {
+        return -1;
+    }
+
+    return block;
+}
+
+QString CliInterface::solidBlockCachePath(int block) const
+{
+    Q_ASSERT(m_solidBlockCacheDir);
+    return m_solidBlockCacheDir->path() + QLatin1Char('/') + QString::number(block);
+}
+
+bool CliInterface::copyFromSolidBlockCache(const Archive::Entry *entry, const QString &destinationDirectory)
 {
-    if (!m_oldWorkingDir.isEmpty()) {
-        QDir::setCurrent(m_oldWorkingDir);
+    const int block = entry->property("solidBlock").toInt();
+    const QString source = solidBlockCachePath(block) + QLatin1Char('/') + entry->fullPath();
+    const QString destination = QDir(destinationDirectory).filePath(entry->fullPath());
+
+    if (!QDir().mkpath(QFileInfo(destination).absolutePath())) {
+        qCWarning(ARK) << "Could not create the directory of" << destination;
+        return false;
     }
 
+    // Copied rather than linked, since opened files may be modified.
+    if (!QFile::copy(source, destination)) {
+        qCWarning(ARK) << "Could not copy" << source << "to" << destination;
+        return false;
+    }
+
+    return true;
+}
+
+void CliInterface::clearSolidBlocks()
+{
+    m_solidBlocks.clear();
+    m_cachedSolidBlocks.clear();
+    m_solidBlockCacheSize = 0;
+    delete m_solidBlockCacheDir;
+    m_solidBlockCacheDir = Q_NULLPTR;
+}
+
+void CliInterface::cleanUpExtracting()
+{
     if (m_extractTempDir) {
         delete m_extractTempDir;
         m_extractTempDir = Q_NULLPTR;
@@ -610,6 +1146,160 @@ bool CliInterface::moveToDestination(const QDir &tempDir, const QDir &destDir, b
 {
     qCDebug(ARK) << "Moving extracted files from temp dir" << tempDir.path() << "to final destination" << destDir.path();
 
+#ifndef Q_OS_WIN
+    const int tempFd = open(QFile::encodeName(tempDir.absolutePath()).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    const int destFd = open(QFile::encodeName(destDir.absolutePath()).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (tempFd < 0 || destFd < 0) {
+        qCWarning(ARK) << "Failed to open the temporary or the destination directory:" << strerror(errno);
+        if (tempFd >= 0) {
+            close(tempFd);
+        }
+        if (destFd >= 0) {
+            close(destFd);
+        }
+        return false;
+    }
+
+    // Collect what has to be moved. Top-level directories which don't exist in the
+    // destination yet are moved with a single rename, without listing them.
+    QVector<MoveSubtree> subtrees;
+    bool result = true;
+
+    DIR *dir = fdopendir(dup(tempFd));
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        MoveSubtree subtree;
+        subtree.name = QByteArray(entry->d_name);
+
+        struct stat st;
+        const bool isDir = (fstatat(tempFd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode));
+        subtree.moveWhole = (isDir && preservePaths && faccessat(destFd, entry->d_name, F_OK, AT_SYMLINK_NOFOLLOW) != 0);
+
+        if (isDir && !subtree.moveWhole) {
+            const int childFd = openat(tempFd, entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (childFd < 0 || !scanTree(childFd, subtree.name + '/', preservePaths, subtree.moves)) {
+                result = false;
+            }
+        } else if (!isDir) {
+            subtree.moves.append({subtree.name, subtree.name, false, false});
+        }
+
+        subtrees.append(subtree);
+    }
+    if (dir) {
+        closedir(dir);
+    }
+
+    // Resolve all the conflicts before moving anything, so that cancelling
+    // leaves the destination untouched. The files decided upon before the
+    // extraction started are not asked about again, the others at once.
+    // Without paths, files of different directories may also end up with the same
+    // name, in which case the ones coming later conflict with the earlier ones.
+    QVector<PendingMove*> conflicts;
+    QStringList conflictPaths;
+    QSet<QByteArray> flattenedDestinations;
+    for (int i = 0; i < subtrees.size() && result; ++i) {
+        for (int j = 0; j < subtrees[i].moves.size(); ++j) {
+            PendingMove &move = subtrees[i].moves[j];
+            if (move.isDir) {
+                continue;
+            }
+
+            bool isDuplicate = false;
+            if (!preservePaths) {
+                isDuplicate = flattenedDestinations.contains(move.destination);
+                flattenedDestinations.insert(move.destination);
+            }
+            if (!isDuplicate && faccessat(destFd, move.destination.constData(), F_OK, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+
+            const QString destination = destDir.absoluteFilePath(QFile::decodeName(move.destination));
+            if (isDuplicate) {
+                qCWarning(ARK) << "File" << destination << "is extracted more than once.";
+            } else {
+                qCWarning(ARK) << "File" << destination << "exists.";
+            }
+
+            switch (m_conflictDecisions.decisionFor(destination)) {
+            case ConflictDecisions::Skip:
+                move.skip = true;
+                break;
+            case ConflictDecisions::Overwrite:
+                break;
+            case ConflictDecisions::Ask:
+                conflicts << &move;
+                conflictPaths << destination;
+                break;
+            }
+        }
+    }
+
+    bool cancelled = false;
+    if (conflicts.size() > 1) {
+        Kerfuffle::BatchOverwriteQuery query(conflictPaths);
+        emit userQuery(&query);
+        query.waitForResponse();
+
+        if (query.responseCancelled()) {
+            cancelled = true;
+        } else {
+            const QSet<QString> skippedFiles = query.skippedFiles().toSet();
+            for (int i = 0; i < conflicts.size(); ++i) {
+                conflicts[i]->skip = skippedFiles.contains(conflictPaths.at(i));
+            }
+        }
+    } else if (conflicts.size() == 1) {
+        Kerfuffle::OverwriteQuery query(conflictPaths.first());
+        query.setNoRenameMode(true);
+        emit userQuery(&query);
+        query.waitForResponse();
+
+        if (query.responseSkip() || query.responseAutoSkip()) {
+            conflicts.first()->skip = true;
+        } else if (query.responseCancelled()) {
+            cancelled = true;
+        }
+    }
+
+    if (cancelled) {
+        qCDebug(ARK) << "Copy action cancelled.";
+        close(tempFd);
+        close(destFd);
+        return false;
+    }
+
+    if (result) {
+        const QString tempPath = tempDir.absolutePath();
+        const QString destPath = destDir.absolutePath();
+        QAtomicInt failures;
+        const auto move = [&](MoveSubtree &subtree) {
+            if (!moveSubtree(tempFd, destFd, tempPath, destPath, subtree)) {
+                failures.ref();
+            }
+        };
+
+        // The duplicated flattened files overwrite each other in the order they
+        // were decided upon, so they are moved one after the other.
+        if (preservePaths) {
+            QtConcurrent::blockingMap(subtrees, move);
+        } else {
+            for (int i = 0; i < subtrees.size(); ++i) {
+                move(subtrees[i]);
+            }
+        }
+        result = (failures.load() == 0);
+    }
+
+    close(tempFd);
+    close(destFd);
+
+    return result;
+#else
     bool overwriteAll = false;
     bool skipAll = false;
 
@@ -636,7 +1326,17 @@ bool CliInterface::moveToDestination(const QDir &tempDir, const QDir &destDir, b
 
         QFileInfo absDestEntry(destDir.path() + QLatin1Char('/') + relEntry.filePath());
 
-        if (absDestEntry.exists()) {
+        const ConflictDecisions::Decision decision = absDestEntry.exists()
+                                                     ? m_conflictDecisions.decisionFor(absDestEntry.absoluteFilePath())
+                                                     : ConflictDecisions::Ask;
+
+        if (decision == ConflictDecisions::Skip) {
+            continue;
+        } else if (decision == ConflictDecisions::Overwrite) {
+            if (!QFile::remove(absDestEntry.absoluteFilePath())) {
+                qCWarning(ARK) << "Failed to remove" << absDestEntry.absoluteFilePath();
+            }
+        } else if (absDestEntry.exists()) {
             qCWarning(ARK) << "File" << absDestEntry.absoluteFilePath() << "exists.";
 
             Kerfuffle::OverwriteQuery query(absDestEntry.absoluteFilePath());
@@ -684,6 +1384,7 @@ bool CliInterface::moveToDestination(const QDir &tempDir, const QDir &destDir, b
     }
 
     return true;
+#endif
 }
 
 QStringList CliInterface::substituteListVariables(const QStringList &listArgs, const QString &password)
@@ -752,7 +1453,8 @@ QStringList CliInterface::substituteExtractVariables(const QStringList &extractA
     return args;
 }
 
-QStringList CliInterface::substituteAddVariables(const QStringList &addArgs, const QList<Archive::Entry*> &entries, const QString &password, bool encryptHeader, int compLevel)
+QStringList CliInterface::substituteAddVariables(const QStringList &addArgs, const QList<Archive::Entry*> &entries, const QString &password, bool encryptHeader, int compLevel,
+                                                 const CompressionOptions &options)
 {
     // Required if we call this function from unit tests.
     cacheParameterList();
@@ -776,6 +1478,24 @@ QStringList CliInterface::substituteAddVariables(const QStringList &addArgs, con
             continue;
         }
 
+        if (arg == QLatin1String("$DictionarySizeSwitch")) {
+            args << compressionOptionSwitch(DictionarySizeSwitch, QStringLiteral("$DictionarySize"),
+                                            options.value(QStringLiteral("DictionarySize")).toInt());
+            continue;
+        }
+
+        if (arg == QLatin1String("$BlockSizeSwitch")) {
+            args << compressionOptionSwitch(BlockSizeSwitch, QStringLiteral("$BlockSize"),
+                                            options.value(QStringLiteral("BlockSize")).toInt());
+            continue;
+        }
+
+        if (arg == QLatin1String("$ThreadsSwitch")) {
+            args << compressionOptionSwitch(ThreadsSwitch, QStringLiteral("$Threads"),
+                                            options.value(QStringLiteral("Threads")).toInt());
+            continue;
+        }
+
         if (arg == QLatin1String("$Files")) {
             args << entryFullPaths(entries, true);
             continue;
@@ -960,6 +1680,64 @@ void CliInterface::setNewMovedFiles(const QList<Archive::Entry*> &entries, const
     }
 }
 
+bool CliInterface::setAddedEntries(const QList<Archive::Entry*> &files, const QString &destinationPath, bool isPasswordProtected)
+{
+    qDeleteAll(m_addedEntries);
+    m_addedEntries.clear();
+
+    // Whether a symlink is stored as a link or as the content of its target, and
+    // whether a linked directory is descended into, depends on each program and
+    // its switches, so the archive is listed again instead of guessing it.
+    const QDir workDir(m_workingDir);
+    foreach (const Archive::Entry *file, files) {
+        const QFileInfo fileInfo(workDir, file->fullPath(true));
+        if (!fileInfo.exists() || fileInfo.isSymLink()) {
+            qDeleteAll(m_addedEntries);
+            m_addedEntries.clear();
+            return false;
+        }
+
+        const QString path = destinationPath + file->fullPath(true);
+        appendAddedEntry(fileInfo, path, isPasswordProtected);
+
+        if (fileInfo.isDir()) {
+            const QDir dir(fileInfo.absoluteFilePath());
+            QDirIterator it(dir.path(), QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                            QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                it.next();
+                if (it.fileInfo().isSymLink()) {
+                    qDeleteAll(m_addedEntries);
+                    m_addedEntries.clear();
+                    return false;
+                }
+                appendAddedEntry(it.fileInfo(), path + QLatin1Char('/') + dir.relativeFilePath(it.filePath()),
+                                 isPasswordProtected);
+            }
+        }
+    }
+
+    return true;
+}
+
+void CliInterface::appendAddedEntry(const QFileInfo &fileInfo, const QString &path, bool isPasswordProtected)
+{
+    const bool isDir = fileInfo.isDir();
+
+    Archive::Entry *e = new Archive::Entry(Q_NULLPTR);
+    e->setProperty("fullPath", isDir ? path + QLatin1Char('/') : path);
+    e->setProperty("isDirectory", isDir);
+    e->setProperty("timestamp", fileInfo.lastModified());
+    // Only known once the archive is listed again, keep the one of a replaced entry.
+    e->compressedSizeIsSet = false;
+    if (!isDir) {
+        e->setProperty("size", qulonglong(fileInfo.size()));
+        e->setProperty("isPasswordProtected", isPasswordProtected);
+    }
+
+    m_addedEntries << e;
+}
+
 QString CliInterface::preservePathSwitch(bool preservePaths) const
 {
     Q_ASSERT(m_param.contains(PreservePathSwitch));
@@ -1025,6 +1803,18 @@ QString CliInterface::compressionLevelSwitch(int level) const
     return compLevelSwitch;
 }
 
+QString CliInterface::compressionOptionSwitch(CliInterfaceParameters switchName, const QString &variable, int value) const
+{
+    if (value <= 0 || !m_param.contains(switchName)) {
+        return QString();
+    }
+
+    QString optionSwitch = m_param.value(switchName).toString();
+    optionSwitch.replace(variable, QString::number(value));
+
+    return optionSwitch;
+}
+
 QStringList CliInterface::extractFilesList(const QList<Archive::Entry*> &entries) const
 {
     QStringList filesList;
@@ -1077,7 +1867,6 @@ void CliInterface::cleanUp()
 {
     qDeleteAll(m_tempAddedFiles);
     m_tempAddedFiles.clear();
-    QDir::setCurrent(m_oldWorkingDir);
     delete m_tempExtractDir;
     m_tempExtractDir = Q_NULLPTR;
     delete m_tempAddDir;
@@ -1163,7 +1952,7 @@ void CliInterface::readStdout(bool handleAll)
 
 bool CliInterface::setAddedFiles()
 {
-    QDir::setCurrent(m_tempAddDir->path());
+    m_passedOptions[QStringLiteral("GlobalWorkDir")] = m_tempAddDir->path();
     foreach (const Archive::Entry *file, m_passedFiles) {
         const QString oldPath = m_tempExtractDir->path() + QLatin1Char('/') + file->fullPath(true);
         const QString newPath = m_tempAddDir->path() + QLatin1Char('/') + file->name();
@@ -1343,7 +2132,19 @@ bool CliInterface::handleFileExistsMessage(const QString& line)
         return false;
     }
 
-    Kerfuffle::OverwriteQuery query(QDir::current().path() + QLatin1Char( '/' ) + m_storedFileName);
+    const QStringList choices = m_param.value(FileExistsInput).toStringList();
+
+    // Answer on behalf of the user if the file was decided upon before the extraction.
+    const QString existingFile = QDir(m_workingDir).absoluteFilePath(m_storedFileName);
+    const ConflictDecisions::Decision decision = m_conflictDecisions.decisionFor(existingFile);
+    if (decision != ConflictDecisions::Ask) {
+        qCDebug(ARK) << "Using the decision taken before the extraction for" << existingFile;
+        const QString response = choices.at(decision == ConflictDecisions::Overwrite ? 0 : 1) + QLatin1Char('\n');
+        writeToProcess(response.toLocal8Bit());
+        return true;
+    }
+
+    Kerfuffle::OverwriteQuery query(m_workingDir + QLatin1Char( '/' ) + m_storedFileName);
     query.setNoRenameMode(true);
     emit userQuery(&query);
     qCDebug(ARK) << "Waiting response";
@@ -1352,7 +2153,6 @@ bool CliInterface::handleFileExistsMessage(const QString& line)
     qCDebug(ARK) << "Finished response";
 
     QString responseToProcess;
-    const QStringList choices = m_param.value(FileExistsInput).toStringList();
 
     if (query.responseOverwrite()) {
         responseToProcess = choices.at(0);
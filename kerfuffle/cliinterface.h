@@ -31,16 +31,19 @@
 
 #include "archiveinterface.h"
 #include "archiveentry.h"
+#include "conflictdecisions.h"
 #include "kerfuffle_export.h"
 #include "part/archivemodel.h"
 
 #include <QProcess>
 #include <QRegularExpression>
+#include <QSet>
 
 class KProcess;
 class KPtyProcess;
 
 class QDir;
+class QFileInfo;
 class QTemporaryDir;
 class QTemporaryFile;
 
@@ -188,6 +191,16 @@ enum CliInterfaceParameters {
       * Regexp patterns capturing disk is full error messages.
       */
     DiskFullPatterns,
+    /**
+     * QStringList (default empty)
+     * The arguments that are passed to ExtractProgram for writing the
+     * contents of a single entry to the standard output, so that it can be
+     * previewed without extracting it to the disk. The special strings are
+     * the same as for ExtractArgs. Leave it empty if the program does not
+     * support this.
+     * Example (7z plugin): ("e", "-so", "$PasswordSwitch", "$Archive", "$Files")
+     */
+    ExtractToStdoutArgs,
 
     ///////////////[ DELETE ]/////////////
 
@@ -236,8 +249,31 @@ enum CliInterfaceParameters {
      * substituted:
      * $Archive - the path of the archive
      * $Files - the files selected to be added
+     * $CompressionLevelSwitch, $DictionarySizeSwitch, $BlockSizeSwitch
+     * and $ThreadsSwitch - the switches below, if the option is set
      */
     AddArgs,
+    /**
+     * QString
+     * The format of the dictionary size switch. The variable $DictionarySize
+     * will be substituted for the size in KiB.
+     * Example: ("-md=$DictionarySizek")
+     */
+    DictionarySizeSwitch,
+    /**
+     * QString
+     * The format of the (solid) block size switch. The variable $BlockSize
+     * will be substituted for the size in KiB.
+     * Example: ("-ms=$BlockSizek")
+     */
+    BlockSizeSwitch,
+    /**
+     * QString
+     * The format of the compression threads switch. The variable $Threads
+     * will be substituted for the number of threads.
+     * Example: ("-mmt=$Threads")
+     */
+    ThreadsSwitch,
 
     ///////////////[ MOVE ]/////////////
 
@@ -304,6 +340,7 @@ public:
 
     virtual bool list() Q_DECL_OVERRIDE;
     virtual bool extractFiles(const QList<Archive::Entry*> &files, const QString &destinationDirectory, const ExtractionOptions &options) Q_DECL_OVERRIDE;
+    virtual QIODevice *createEntryDevice(Archive::Entry *entry) Q_DECL_OVERRIDE;
     virtual bool addFiles(const QList<Archive::Entry*> &files, const Archive::Entry *destination, const CompressionOptions& options) Q_DECL_OVERRIDE;
     virtual bool moveFiles(const QList<Archive::Entry*> &files, Archive::Entry *destination, const CompressionOptions& options) Q_DECL_OVERRIDE;
     virtual bool copyFiles(const QList<Archive::Entry*> &files, Archive::Entry *destination, const CompressionOptions& options) Q_DECL_OVERRIDE;
@@ -333,7 +370,8 @@ public:
 
     QStringList substituteListVariables(const QStringList &listArgs, const QString &password);
     QStringList substituteExtractVariables(const QStringList &extractArgs, const QList<Archive::Entry*> &entries, bool preservePaths, const QString &password);
-    QStringList substituteAddVariables(const QStringList &addArgs, const QList<Archive::Entry*> &entries, const QString &password, bool encryptHeader, int compLevel);
+    QStringList substituteAddVariables(const QStringList &addArgs, const QList<Archive::Entry*> &entries, const QString &password, bool encryptHeader, int compLevel,
+                                       const CompressionOptions &options = CompressionOptions());
     QStringList substituteMoveVariables(const QStringList &moveArgs, const QList<Archive::Entry*> &entriesWithoutChildren, const Archive::Entry *destination, const QString &password);
     QStringList substituteDeleteVariables(const QStringList &deleteArgs, const QList<Archive::Entry*> &entries, const QString &password);
     QStringList substituteCommentVariables(const QStringList &commentArgs, const QString &commentFile);
@@ -344,6 +382,25 @@ public:
      */
     void setNewMovedFiles(const QList<Archive::Entry*> &entries, const Archive::Entry *destination, int entriesWithoutChildren);
 
+    /**
+     * Creates the entries which adding @p files to @p destinationPath will write, from
+     * the files on disk, so that the archive doesn't have to be listed again. The files
+     * are encrypted if @p isPasswordProtected.
+     *
+     * @return Whether all the files have been found and none of them is a symlink.
+     */
+    bool setAddedEntries(const QList<Archive::Entry*> &files, const QString &destinationPath, bool isPasswordProtected);
+    void appendAddedEntry(const QFileInfo &fileInfo, const QString &path, bool isPasswordProtected);
+
+    /**
+     * Records that @p entry is stored in the solid @p block, i.e. that extracting it
+     * decompresses the block from its start. To be called by the plugins while listing.
+     *
+     * Opening or previewing the files of a block one by one then extracts the
+     * whole block once, and serves the next files from a per-archive cache.
+     */
+    void setSolidBlock(Archive::Entry *entry, int block);
+
     /**
      * @return The preserve path switch, according to the @p preservePaths extraction option.
      */
@@ -364,6 +421,12 @@ public:
      */
     QString compressionLevelSwitch(int level) const;
 
+    /**
+     * @return The @p switchName parameter with @p variable substituted for @p value,
+     * or an empty string if the plugin has no such switch or @p value is not positive.
+     */
+    QString compressionOptionSwitch(CliInterfaceParameters switchName, const QString &variable, int value) const;
+
     /**
      * @return The list of selected files to extract.
      */
@@ -399,7 +462,11 @@ protected:
 
     void cleanUp();
 
-    QString m_oldWorkingDir;
+    /**
+     * Directory the program is run in when extracting or adding files,
+     * the relative paths of the files are resolved against it.
+     */
+    QString m_workingDir;
     ParameterList m_param;
     int m_exitCode;
     QTemporaryDir *m_tempExtractDir;
@@ -470,6 +537,27 @@ private:
 
     void finishCopying(bool result);
 
+    /**
+     * @return The solid block worth extracting as a whole in order to extract
+     * @p files, or -1 if the files should be extracted the usual way.
+     */
+    int cachableSolidBlock(const QList<Archive::Entry*> &files, const QString &destinationDirectory, const ExtractionOptions &options) const;
+
+    /**
+     * @return The directory @p block is (or will be) extracted to.
+     */
+    QString solidBlockCachePath(int block) const;
+
+    /**
+     * Copies @p entry from the extracted solid block to @p destinationDirectory.
+     */
+    bool copyFromSolidBlockCache(const Archive::Entry *entry, const QString &destinationDirectory);
+
+    /**
+     * Forgets the solid blocks, to be called when the archive is listed or modified.
+     */
+    void clearSolidBlocks();
+
     QByteArray m_stdOutData;
     QRegularExpression m_passwordPromptPattern;
     QHash<int, QList<QRegularExpression> > m_patternCache;
@@ -482,16 +570,30 @@ private:
 
     QList<Archive::Entry*> m_removedFiles;
     QList<Archive::Entry*> m_newMovedFiles;
+    QList<Archive::Entry*> m_addedEntries;
     bool m_listEmptyLines;
     bool m_abortingOperation;
     QString m_storedFileName;
 
     CompressionOptions m_compressionOptions;
     QString m_extractDestDir;
+    ConflictDecisions m_conflictDecisions;
     QTemporaryDir *m_extractTempDir;
     QTemporaryFile *m_commentTempFile;
     QList<Archive::Entry*> m_extractedFiles;
 
+    struct SolidBlock
+    {
+        QStringList fullPaths;
+        qulonglong size;
+    };
+    QHash<int, SolidBlock> m_solidBlocks;
+    QSet<int> m_cachedSolidBlocks;
+    QTemporaryDir *m_solidBlockCacheDir;
+    qulonglong m_solidBlockCacheSize;
+    int m_extractingSolidBlock;
+    QList<Archive::Entry*> m_solidBlockEntries;
+
 protected slots:
     virtual void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
 
@@ -31,12 +31,34 @@
 #include "pluginmanager.h"
 
 #include <KColorScheme>
+#include <KIO/Global>
 #include <KPluginMetaData>
 
 #include <QMimeDatabase>
 
 namespace Kerfuffle
 {
+
+/**
+ * Fills @p comboBox with the powers of two between @p minSize and @p maxSize (in KiB),
+ * preceded by an entry which leaves the choice to the archiver.
+ */
+static void populateSizeComboBox(QComboBox *comboBox, int minSize, int maxSize, int selectedSize)
+{
+    comboBox->clear();
+    comboBox->addItem(i18nc("@item:inlistbox let the archiver choose", "Default"), 0);
+
+    for (qint64 size = 1; size <= maxSize; size *= 2) {
+        if (size < minSize) {
+            continue;
+        }
+        comboBox->addItem(KIO::convertSize(size * 1024), static_cast<int>(size));
+    }
+
+    const int index = comboBox->findData(selectedSize);
+    comboBox->setCurrentIndex(index != -1 ? index : 0);
+}
+
 CompressionOptionsWidget::CompressionOptionsWidget(QWidget *parent,
                                                    const CompressionOptions &opts)
     : QWidget(parent)
@@ -54,6 +76,19 @@ CompressionOptions CompressionOptionsWidget::commpressionOptions() const
     CompressionOptions opts;
     opts[QStringLiteral("CompressionLevel")] = compLevelSlider->value();
 
+    if (!dictionarySizeComboBox->isHidden() && dictionarySizeComboBox->currentData().toInt() > 0) {
+        opts[QStringLiteral("DictionarySize")] = dictionarySizeComboBox->currentData().toInt();
+    }
+    if (!blockSizeComboBox->isHidden() && blockSizeComboBox->currentData().toInt() > 0) {
+        opts[QStringLiteral("BlockSize")] = blockSizeComboBox->currentData().toInt();
+    }
+    if (!threadsSpinBox->isHidden() && threadsSpinBox->value() > 0) {
+        opts[QStringLiteral("Threads")] = threadsSpinBox->value();
+    }
+    if (!longDistanceCheckBox->isHidden() && longDistanceCheckBox->isChecked()) {
+        opts[QStringLiteral("LongDistanceMatching")] = true;
+    }
+
     return opts;
 }
 
@@ -74,7 +109,7 @@ QString CompressionOptionsWidget::password() const
 
 void CompressionOptionsWidget::updateWidgets()
 {
-    const KPluginMetaData metadata = PluginManager().preferredPluginFor(m_mimetype)->metaData();
+    const KPluginMetaData metadata = PluginManager().preferredWritePluginFor(m_mimetype)->metaData();
     const ArchiveFormat archiveFormat = ArchiveFormat::fromMetadata(m_mimetype, metadata);
     Q_ASSERT(archiveFormat.isValid());
 
@@ -122,6 +157,30 @@ void CompressionOptionsWidget::updateWidgets()
             compLevelSlider->setValue(archiveFormat.defaultCompressionLevel());
         }
     }
+
+    // The tuning options are only shown for the formats whose plugin can pass them on.
+    const bool hasDictionarySize = archiveFormat.maxDictionarySize() > 0;
+    dictionarySizeLabel->setVisible(hasDictionarySize);
+    dictionarySizeComboBox->setVisible(hasDictionarySize);
+    if (hasDictionarySize) {
+        populateSizeComboBox(dictionarySizeComboBox, archiveFormat.minDictionarySize(), archiveFormat.maxDictionarySize(),
+                             m_opts.value(QStringLiteral("DictionarySize")).toInt());
+    }
+
+    const bool hasBlockSize = archiveFormat.maxBlockSize() > 0;
+    blockSizeLabel->setVisible(hasBlockSize);
+    blockSizeComboBox->setVisible(hasBlockSize);
+    if (hasBlockSize) {
+        populateSizeComboBox(blockSizeComboBox, archiveFormat.minBlockSize(), archiveFormat.maxBlockSize(),
+                             m_opts.value(QStringLiteral("BlockSize")).toInt());
+    }
+
+    threadsLabel->setVisible(archiveFormat.supportsThreads());
+    threadsSpinBox->setVisible(archiveFormat.supportsThreads());
+    threadsSpinBox->setValue(m_opts.value(QStringLiteral("Threads")).toInt());
+
+    longDistanceCheckBox->setVisible(archiveFormat.supportsLongDistanceMatching());
+    longDistanceCheckBox->setChecked(m_opts.value(QStringLiteral("LongDistanceMatching")).toBool());
 }
 
 void CompressionOptionsWidget::setMimeType(const QMimeType &mimeType)
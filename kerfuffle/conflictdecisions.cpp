@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "conflictdecisions.h"
+#include "archiveentry.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+
+namespace Kerfuffle
+{
+
+ConflictDecisions::ConflictDecisions(const ExtractionOptions &options)
+{
+    foreach (const QString &file, options.value(QStringLiteral("OverwrittenFiles")).toStringList()) {
+        m_overwrittenFiles.insert(QDir::cleanPath(file));
+    }
+    foreach (const QString &file, options.value(QStringLiteral("SkippedFiles")).toStringList()) {
+        m_skippedFiles.insert(QDir::cleanPath(file));
+    }
+}
+
+ConflictDecisions::Decision ConflictDecisions::decisionFor(const QString &absoluteFilePath) const
+{
+    if (m_overwrittenFiles.isEmpty() && m_skippedFiles.isEmpty()) {
+        return Ask;
+    }
+
+    const QString file = QDir::cleanPath(absoluteFilePath);
+    if (m_skippedFiles.contains(file)) {
+        return Skip;
+    }
+    if (m_overwrittenFiles.contains(file)) {
+        return Overwrite;
+    }
+
+    return Ask;
+}
+
+void ConflictDecisions::store(ExtractionOptions &options, const QStringList &overwrittenFiles, const QStringList &skippedFiles)
+{
+    options[QStringLiteral("OverwrittenFiles")] = overwrittenFiles;
+    options[QStringLiteral("SkippedFiles")] = skippedFiles;
+}
+
+QStringList ConflictDecisions::findConflicts(const QList<Archive::Entry*> &entries, const QString &destination, const ExtractionOptions &options)
+{
+    const bool preservePaths = options.value(QStringLiteral("PreservePaths")).toBool();
+    const bool removeRootNode = options.value(QStringLiteral("RemoveRootNode")).toBool();
+    const QDir destDir(destination);
+
+    // Destination folder -> names of the files extracted in it.
+    QHash<QString, QStringList> filesByFolder;
+    foreach (const Archive::Entry *entry, entries) {
+        // Folders are merged, they never conflict.
+        if (entry->isDir()) {
+            continue;
+        }
+
+        QString path;
+        if (!preservePaths) {
+            path = entry->name();
+        } else {
+            path = entry->fullPath();
+            if (removeRootNode && !entry->rootNode.isEmpty() && path.startsWith(entry->rootNode)) {
+                path.remove(0, entry->rootNode.size());
+            }
+        }
+
+        const QFileInfo destinationInfo(QDir::cleanPath(destDir.absoluteFilePath(path)));
+        filesByFolder[destinationInfo.path()] << destinationInfo.fileName();
+    }
+
+    QStringList conflicts;
+    QHash<QString, QStringList>::const_iterator it = filesByFolder.constBegin();
+    for (; it != filesByFolder.constEnd(); ++it) {
+        const QDir folder(it.key());
+        if (!folder.exists()) {
+            continue;
+        }
+
+        const QSet<QString> existingFiles = folder.entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot).toSet();
+        foreach (const QString &name, it.value()) {
+            if (existingFiles.contains(name)) {
+                conflicts << folder.absoluteFilePath(name);
+            }
+        }
+    }
+
+    conflicts.removeDuplicates();
+    conflicts.sort();
+    return conflicts;
+}
+
+}
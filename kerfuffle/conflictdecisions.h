@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONFLICTDECISIONS_H
+#define CONFLICTDECISIONS_H
+
+#include "kerfuffle_export.h"
+#include "archive_kerfuffle.h"
+
+#include <QSet>
+#include <QStringList>
+
+namespace Kerfuffle
+{
+
+/**
+ * Decisions taken before an extraction about the existing files it would overwrite.
+ *
+ * The existing files are found by findConflicts() from the listing of the archive,
+ * and the decisions are stored in the ExtractionOptions passed to the job. The
+ * interfaces then only ask the user about files which appeared meanwhile.
+ */
+class KERFUFFLE_EXPORT ConflictDecisions
+{
+public:
+    enum Decision {
+        Ask,
+        Overwrite,
+        Skip
+    };
+
+    explicit ConflictDecisions(const ExtractionOptions &options = ExtractionOptions());
+
+    /**
+     * @return The decision about the existing file at @p absoluteFilePath.
+     */
+    Decision decisionFor(const QString &absoluteFilePath) const;
+
+    /**
+     * Stores the decisions about the existing files in @p options.
+     */
+    static void store(ExtractionOptions &options, const QStringList &overwrittenFiles, const QStringList &skippedFiles);
+
+    /**
+     * Finds the files which the extraction of @p entries to @p destination would
+     * overwrite, taking the PreservePaths and RemoveRootNode options into account.
+     *
+     * Every destination folder is listed once instead of checking the entries
+     * one by one.
+     *
+     * @return The absolute paths of the existing files.
+     */
+    static QStringList findConflicts(const QList<Archive::Entry*> &entries, const QString &destination, const ExtractionOptions &options);
+
+private:
+    QSet<QString> m_overwrittenFiles;
+    QSet<QString> m_skippedFiles;
+};
+
+}
+
+#endif // CONFLICTDECISIONS_H
@@ -32,6 +32,8 @@
 
 #include <QDir>
 #include <QFileInfo>
+#include <QMutex>
+#include <QProcess>
 #include <QRegularExpression>
 #include <QThread>
 #include <QTimer>
@@ -48,6 +50,9 @@ class Job::Private : public QThread
 public:
     Private(Job *job, QObject *parent = 0)
         : QThread(parent)
+        , pendingProgress(0)
+        , hasPendingProgress(false)
+        , isPublishingScheduled(false)
         , q(job)
     {
         connect(q, &KJob::result, this, &QThread::quit);
@@ -55,10 +60,24 @@ public:
 
     virtual void run() Q_DECL_OVERRIDE;
 
+    // Events of the interface waiting to be published, guarded by pendingMutex.
+    QMutex pendingMutex;
+    QVector<Archive::Entry*> pendingEntries;
+    QStringList pendingRemovedPaths;
+    double pendingProgress;
+    bool hasPendingProgress;
+    bool isPublishingScheduled;
+
+    // Only used in the thread of the job.
+    QElapsedTimer publishTimer;
+
 private:
     Job *q;
 };
 
+// Minimum time between two publications of the interface events, in milliseconds.
+static const int s_publishInterval = 100;
+
 void Job::Private::run()
 {
     q->doWork();
@@ -109,6 +128,24 @@ bool Job::isRunning() const
     return m_isRunning;
 }
 
+void Job::killAndWait()
+{
+    if (!m_isRunning) {
+        return;
+    }
+
+    archiveInterface()->doKill();
+    if (d->isRunning()) {
+        d->wait();
+    }
+
+    // Interfaces running a process kill it synchronously, without finishing the job.
+    if (m_isRunning) {
+        setError(KJob::KilledJobError);
+        emitResult();
+    }
+}
+
 void Job::start()
 {
     jobTimer.start();
@@ -125,6 +162,8 @@ void Job::start()
 
 void Job::emitResult()
 {
+    flushPendingEvents();
+
     m_isRunning = false;
     KJob::emitResult();
 }
@@ -133,14 +172,100 @@ void Job::connectToArchiveInterfaceSignals()
 {
     connect(archiveInterface(), &ReadOnlyArchiveInterface::cancelled, this, &Job::onCancelled);
     connect(archiveInterface(), &ReadOnlyArchiveInterface::error, this, &Job::onError);
-    connect(archiveInterface(), &ReadOnlyArchiveInterface::entry, this, &Job::onEntry);
-    connect(archiveInterface(), &ReadOnlyArchiveInterface::entryRemoved, this, &Job::onEntryRemoved);
-    connect(archiveInterface(), &ReadOnlyArchiveInterface::progress, this, &Job::onProgress);
+    connect(archiveInterface(), &ReadOnlyArchiveInterface::entry, this, &Job::queueEntry, Qt::DirectConnection);
+    connect(archiveInterface(), &ReadOnlyArchiveInterface::entryRemoved, this, &Job::queueEntryRemoved, Qt::DirectConnection);
+    connect(archiveInterface(), &ReadOnlyArchiveInterface::progress, this, &Job::queueProgress, Qt::DirectConnection);
     connect(archiveInterface(), &ReadOnlyArchiveInterface::info, this, &Job::onInfo);
     connect(archiveInterface(), &ReadOnlyArchiveInterface::finished, this, &Job::onFinished, Qt::DirectConnection);
     connect(archiveInterface(), &ReadOnlyArchiveInterface::userQuery, this, &Job::onUserQuery);
 }
 
+void Job::queueEntry(Archive::Entry *entry)
+{
+    QMutexLocker locker(&d->pendingMutex);
+    d->pendingEntries << entry;
+    schedulePublishing();
+}
+
+void Job::queueEntryRemoved(const QString &path)
+{
+    QMutexLocker locker(&d->pendingMutex);
+    d->pendingRemovedPaths << path;
+    schedulePublishing();
+}
+
+void Job::queueProgress(double progress)
+{
+    QMutexLocker locker(&d->pendingMutex);
+    d->pendingProgress = progress;
+    d->hasPendingProgress = true;
+    schedulePublishing();
+}
+
+void Job::schedulePublishing()
+{
+    // Called with pendingMutex locked. A single publication is pending at a time,
+    // everything queued meanwhile is published along with it.
+    if (!d->isPublishingScheduled) {
+        d->isPublishingScheduled = true;
+        QMetaObject::invokeMethod(this, "publishPendingEvents", Qt::QueuedConnection);
+    }
+}
+
+void Job::publishPendingEvents()
+{
+    if (d->publishTimer.isValid() && d->publishTimer.elapsed() < s_publishInterval) {
+        QTimer::singleShot(s_publishInterval - d->publishTimer.elapsed(), this, &Job::publishPendingEvents);
+        return;
+    }
+
+    flushPendingEvents();
+}
+
+void Job::flushPendingEvents()
+{
+    // The interface may still be running in another thread, the events are
+    // then published by the queued call which follows.
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, "flushPendingEvents", Qt::QueuedConnection);
+        return;
+    }
+
+    QVector<Archive::Entry*> entries;
+    QStringList removedPaths;
+    bool hasProgress;
+    double progress;
+    {
+        QMutexLocker locker(&d->pendingMutex);
+        entries.swap(d->pendingEntries);
+        removedPaths.swap(d->pendingRemovedPaths);
+        hasProgress = d->hasPendingProgress;
+        progress = d->pendingProgress;
+        d->hasPendingProgress = false;
+        d->isPublishingScheduled = false;
+    }
+    d->publishTimer.start();
+
+    // Entries are removed before new ones are added, as when moving entries.
+    if (!removedPaths.isEmpty()) {
+        foreach (const QString &path, removedPaths) {
+            onEntryRemoved(path);
+        }
+        emit entriesRemoved(removedPaths);
+    }
+
+    if (!entries.isEmpty()) {
+        foreach (Archive::Entry *entry, entries) {
+            onEntry(entry);
+        }
+        emit newEntries(entries);
+    }
+
+    if (hasProgress) {
+        onProgress(progress);
+    }
+}
+
 void Job::onCancelled()
 {
     qCDebug(ARK) << "Cancelled emitted";
@@ -423,15 +548,102 @@ OpenWithJob::OpenWithJob(Archive::Entry *entry, bool passwordProtectedHint, Read
     qCDebug(ARK) << "OpenWithJob started";
 }
 
+EntryDeviceJob::EntryDeviceJob(Archive::Entry *entry, ReadOnlyArchiveInterface *interface)
+    : Job(interface)
+    , m_entry(entry)
+    , m_device(Q_NULLPTR)
+{
+    qCDebug(ARK) << "EntryDeviceJob started";
+}
+
+EntryDeviceJob::~EntryDeviceJob()
+{
+    delete m_device;
+}
+
+Archive::Entry *EntryDeviceJob::entry() const
+{
+    return m_entry;
+}
+
+QIODevice *EntryDeviceJob::takeDevice()
+{
+    QIODevice *device = m_device;
+    if (device) {
+        disconnect(device, Q_NULLPTR, this, Q_NULLPTR);
+    }
+    m_device = Q_NULLPTR;
+    return device;
+}
+
+void EntryDeviceJob::doWork()
+{
+    emit description(this, i18n("Opening one file"));
+
+    qCDebug(ARK) << "Opening a device for:" << m_entry;
+
+    m_device = archiveInterface()->createEntryDevice(m_entry);
+    if (!m_device) {
+        setError(KJob::UserDefinedError);
+        emitResult();
+        return;
+    }
+
+    // The device is read from the thread the job was created in.
+    m_device->moveToThread(thread());
+
+    // Don't block until the program streaming the entry has started.
+    QProcess *process = qobject_cast<QProcess*>(m_device);
+    if (process && process->state() == QProcess::Starting) {
+        connect(process, &QProcess::started, this, &EntryDeviceJob::onProcessStarted);
+        connect(process, static_cast<void (QProcess::*)(QProcess::ProcessError)>(&QProcess::error), this, &EntryDeviceJob::onProcessError);
+        return;
+    }
+
+    emitResult();
+}
+
+void EntryDeviceJob::onProcessStarted()
+{
+    if (isRunning()) {
+        emitResult();
+    }
+}
+
+void EntryDeviceJob::onProcessError()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    qCWarning(ARK) << "Could not stream" << m_entry->fullPath() << ":" << m_device->errorString();
+    delete m_device;
+    m_device = Q_NULLPTR;
+
+    setError(KJob::UserDefinedError);
+    emitResult();
+}
+
 AddJob::AddJob(const QList<Archive::Entry*> &entries, const Archive::Entry *destination, const CompressionOptions& options , ReadWriteArchiveInterface *interface)
     : Job(interface)
     , m_entries(entries)
     , m_destination(destination)
     , m_options(options)
+    , m_bytesSaved(0)
 {
     qCDebug(ARK) << "AddJob started";
 }
 
+qlonglong AddJob::bytesSaved() const
+{
+    return m_bytesSaved;
+}
+
+void AddJob::onBytesSaved(qlonglong bytes)
+{
+    m_bytesSaved += bytes;
+}
+
 void AddJob::doWork()
 {
     qCDebug(ARK) << "AddJob: going to add" << m_entries.count() << "file(s)";
@@ -446,12 +658,11 @@ void AddJob::doWork()
     const QString globalWorkDir = m_options.value(QStringLiteral("GlobalWorkDir")).toString();
     const QDir workDir = globalWorkDir.isEmpty() ? QDir::current() : QDir(globalWorkDir);
     if (!globalWorkDir.isEmpty()) {
-        qCDebug(ARK) << "GlobalWorkDir is set, changing dir to " << globalWorkDir;
-        m_oldWorkingDir = QDir::currentPath();
-        QDir::setCurrent(globalWorkDir);
+        qCDebug(ARK) << "GlobalWorkDir is set to" << globalWorkDir;
     }
 
-    // The file paths must be relative to GlobalWorkDir.
+    // The file paths must be relative to GlobalWorkDir, the interface resolves them
+    // against it instead of changing the working directory of the whole process.
     foreach (Archive::Entry *entry, m_entries) {
         // #191821: workDir must be used instead of QDir::current()
         //          so that symlinks aren't resolved automatically
@@ -466,6 +677,7 @@ void AddJob::doWork()
     }
 
     connectToArchiveInterfaceSignals();
+    connect(archiveInterface(), &ReadOnlyArchiveInterface::bytesSaved, this, &AddJob::onBytesSaved, Qt::DirectConnection);
     bool ret = m_writeInterface->addFiles(m_entries, m_destination, m_options);
 
     if (!archiveInterface()->waitForFinishedSignal()) {
@@ -473,15 +685,6 @@ void AddJob::doWork()
     }
 }
 
-void AddJob::onFinished(bool result)
-{
-    if (!m_oldWorkingDir.isEmpty()) {
-        QDir::setCurrent(m_oldWorkingDir);
-    }
-
-    Job::onFinished(result);
-}
-
 MoveJob::MoveJob(const QList<Archive::Entry*> &entries, Archive::Entry *destination, const CompressionOptions& options , ReadWriteArchiveInterface *interface)
     : Job(interface)
     , m_finishedSignalsCount(0)
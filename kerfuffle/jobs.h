@@ -39,6 +39,7 @@
 
 #include <QElapsedTimer>
 #include <QTemporaryDir>
+#include <QVector>
 
 namespace Kerfuffle
 {
@@ -52,6 +53,13 @@ public:
 
     bool isRunning() const;
 
+    /**
+     * Stops the job and blocks until it doesn't use the interface anymore, e.g. before
+     * the interface is deleted. The job must not be waiting for a query to be answered.
+     * The job still emits its result, with KJob::KilledJobError unless it finished first.
+     */
+    void killAndWait();
+
 protected:
     Job(ReadOnlyArchiveInterface *interface);
     virtual ~Job();
@@ -82,7 +90,27 @@ signals:
     void newEntry(Archive::Entry*);
     void userQuery(Kerfuffle::Query*);
 
+    /**
+     * Emitted with the entries received since the previous batch, right after
+     * newEntry() has been emitted for each of them.
+     */
+    void newEntries(const QVector<Archive::Entry*> &entries);
+    void entriesRemoved(const QStringList &paths);
+
+private slots:
+    void publishPendingEvents();
+    void flushPendingEvents();
+
 private:
+    /**
+     * The entries and progress reported by the interface are queued from the thread
+     * they are emitted in, and published at most every few milliseconds.
+     */
+    void queueEntry(Archive::Entry *entry);
+    void queueEntryRemoved(const QString &path);
+    void queueProgress(double progress);
+    void schedulePublishing();
+
     ReadOnlyArchiveInterface *m_archiveInterface;
 
     bool m_isRunning;
@@ -220,6 +248,41 @@ public:
     OpenWithJob(Archive::Entry *entry, bool passwordProtectedHint, ReadOnlyArchiveInterface *interface);
 };
 
+/**
+ * This job opens a device decoding a single entry on demand, so that the entry can be
+ * previewed without being extracted first.
+ * Positioning the device on the entry can take as long as decompressing all the entries
+ * before it, so this is done in the thread of the job rather than in the GUI thread.
+ * The job fails if the entry cannot be streamed and has to be extracted instead.
+ */
+class KERFUFFLE_EXPORT EntryDeviceJob : public Job
+{
+    Q_OBJECT
+
+public:
+    EntryDeviceJob(Archive::Entry *entry, ReadOnlyArchiveInterface *interface);
+    virtual ~EntryDeviceJob();
+
+    Archive::Entry *entry() const;
+
+    /**
+     * @return The open device decoding the entry, or a null pointer if the job failed.
+     * The caller takes ownership of the device.
+     */
+    QIODevice *takeDevice();
+
+public slots:
+    virtual void doWork() Q_DECL_OVERRIDE;
+
+private slots:
+    void onProcessStarted();
+    void onProcessError();
+
+private:
+    Archive::Entry *m_entry;
+    QIODevice *m_device;
+};
+
 class KERFUFFLE_EXPORT AddJob : public Job
 {
     Q_OBJECT
@@ -227,17 +290,23 @@ class KERFUFFLE_EXPORT AddJob : public Job
 public:
     AddJob(const QList<Archive::Entry*> &files, const Archive::Entry *destination, const CompressionOptions& options, ReadWriteArchiveInterface *interface);
 
+    /**
+     * @return The size of the files which have not been stored, because they were
+     * hardlinks or duplicates of files already added.
+     */
+    qlonglong bytesSaved() const;
+
 public slots:
     virtual void doWork() Q_DECL_OVERRIDE;
 
-protected slots:
-    virtual void onFinished(bool result) Q_DECL_OVERRIDE;
+private slots:
+    void onBytesSaved(qlonglong bytes);
 
 private:
-    QString m_oldWorkingDir;
     const QList<Archive::Entry*> m_entries;
     const Archive::Entry *m_destination;
     CompressionOptions m_options;
+    qlonglong m_bytesSaved;
 };
 
 /**
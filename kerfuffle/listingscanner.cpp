@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "listingscanner.h"
+
+namespace Kerfuffle
+{
+
+qulonglong ListingScanner::toSize(const QStringRef &text, bool *ok)
+{
+    const QChar *pos = text.unicode();
+    const QChar *end = pos + text.size();
+
+    while (pos < end && pos->isSpace()) {
+        ++pos;
+    }
+    while (end > pos && (end - 1)->isSpace()) {
+        --end;
+    }
+
+    bool valid = (pos < end);
+    qulonglong value = 0;
+    for (; valid && pos < end; ++pos) {
+        const ushort digit = pos->unicode() - '0';
+        if (digit > 9 || value > (Q_UINT64_C(0xFFFFFFFFFFFFFFFF) - digit) / 10) {
+            valid = false;
+            break;
+        }
+        value = value * 10 + digit;
+    }
+
+    if (ok) {
+        *ok = valid;
+    }
+    return valid ? value : 0;
+}
+
+qulonglong ListingScanner::toSize(const QString &text, bool *ok)
+{
+    return toSize(QStringRef(&text), ok);
+}
+
+QDateTime ListingScanner::toDateTime(const QStringRef &text)
+{
+    const QChar *pos = text.unicode();
+    const QChar *end = pos + text.size();
+
+    while (pos < end && pos->isSpace()) {
+        ++pos;
+    }
+
+    int year, month, day, hour, minute, second;
+    if (!readNumber(pos, end, 4, &year) || !skip(pos, end, QLatin1Char('-')) ||
+        !readNumber(pos, end, 2, &month) || !skip(pos, end, QLatin1Char('-')) ||
+        !readNumber(pos, end, 2, &day) || !skip(pos, end, QLatin1Char(' ')) ||
+        !readNumber(pos, end, 2, &hour) || !skip(pos, end, QLatin1Char(':')) ||
+        !readNumber(pos, end, 2, &minute) || !skip(pos, end, QLatin1Char(':')) ||
+        !readNumber(pos, end, 2, &second)) {
+        return QDateTime();
+    }
+
+    // Only the milliseconds of the fraction are kept.
+    int msec = 0;
+    if (pos < end && (*pos == QLatin1Char(',') || *pos == QLatin1Char('.'))) {
+        ++pos;
+        int scale = 100;
+        for (; pos < end && pos->isDigit(); ++pos) {
+            msec += (pos->unicode() - '0') * scale;
+            scale /= 10;
+        }
+    }
+
+    while (pos < end && pos->isSpace()) {
+        ++pos;
+    }
+    if (pos != end) {
+        return QDateTime();
+    }
+
+    return dateTime(year, month, day, hour, minute, second, msec);
+}
+
+QDateTime ListingScanner::toDateTime(const QString &text)
+{
+    return toDateTime(QStringRef(&text));
+}
+
+QDateTime ListingScanner::toCompactDateTime(const QStringRef &date, const QStringRef &time)
+{
+    if (date.size() != 8 || time.size() != 6) {
+        return QDateTime();
+    }
+
+    const QChar *datePos = date.unicode();
+    const QChar *dateEnd = datePos + date.size();
+    const QChar *timePos = time.unicode();
+    const QChar *timeEnd = timePos + time.size();
+
+    int year, month, day, hour, minute, second;
+    if (!readNumber(datePos, dateEnd, 4, &year) ||
+        !readNumber(datePos, dateEnd, 2, &month) ||
+        !readNumber(datePos, dateEnd, 2, &day) ||
+        !readNumber(timePos, timeEnd, 2, &hour) ||
+        !readNumber(timePos, timeEnd, 2, &minute) ||
+        !readNumber(timePos, timeEnd, 2, &second)) {
+        return QDateTime();
+    }
+
+    return dateTime(year, month, day, hour, minute, second);
+}
+
+QDateTime ListingScanner::toShortDateTime(const QStringRef &date, const QStringRef &time)
+{
+    const QChar *datePos = date.unicode();
+    const QChar *dateEnd = datePos + date.size();
+    const QChar *timePos = time.unicode();
+    const QChar *timeEnd = timePos + time.size();
+
+    int year, month, day, hour, minute;
+    if (!readNumber(datePos, dateEnd, 2, &day) || !skip(datePos, dateEnd, QLatin1Char('-')) ||
+        !readNumber(datePos, dateEnd, 2, &month) || !skip(datePos, dateEnd, QLatin1Char('-')) ||
+        !readNumber(datePos, dateEnd, 2, &year) || datePos != dateEnd ||
+        !readNumber(timePos, timeEnd, 2, &hour) || !skip(timePos, timeEnd, QLatin1Char(':')) ||
+        !readNumber(timePos, timeEnd, 2, &minute) || timePos != timeEnd) {
+        return QDateTime();
+    }
+
+    // Let's take 1950 as cut-off; similar to KDateTime.
+    year += (year < 50) ? 2000 : 1900;
+
+    return dateTime(year, month, day, hour, minute, 0);
+}
+
+bool ListingScanner::readNumber(const QChar *&pos, const QChar *end, int digits, int *value)
+{
+    if (end - pos < digits) {
+        return false;
+    }
+
+    *value = 0;
+    for (int i = 0; i < digits; ++i, ++pos) {
+        const ushort digit = pos->unicode() - '0';
+        if (digit > 9) {
+            return false;
+        }
+        *value = *value * 10 + digit;
+    }
+
+    return true;
+}
+
+bool ListingScanner::skip(const QChar *&pos, const QChar *end, QChar separator)
+{
+    if (pos == end || *pos != separator) {
+        return false;
+    }
+
+    ++pos;
+    return true;
+}
+
+QDateTime ListingScanner::dateTime(int year, int month, int day, int hour, int minute, int second, int msec)
+{
+    const QDate date(year, month, day);
+    const QTime time(hour, minute, second, msec);
+    if (!date.isValid() || !time.isValid()) {
+        return QDateTime();
+    }
+
+    return QDateTime(date, time);
+}
+
+}
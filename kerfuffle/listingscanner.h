@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LISTINGSCANNER_H
+#define LISTINGSCANNER_H
+
+#include "kerfuffle_export.h"
+
+#include <QDateTime>
+#include <QStringRef>
+
+namespace Kerfuffle
+{
+
+/**
+ * Scanner for the fixed-layout fields found in the listings of the command line
+ * programs.
+ *
+ * The fields are read in place from the line, without the temporary strings and
+ * format parsing of QString::toInt() and QDateTime::fromString(). Sizes are read
+ * as 64-bit unsigned integers, so entries bigger than 4 GB are reported correctly.
+ */
+class KERFUFFLE_EXPORT ListingScanner
+{
+public:
+    /**
+     * Reads a decimal size, ignoring the surrounding whitespace.
+     *
+     * @param ok Set to false if @p text is not a number or does not fit in 64 bits.
+     * @return The size, or 0 on failure.
+     */
+    static qulonglong toSize(const QStringRef &text, bool *ok = Q_NULLPTR);
+    static qulonglong toSize(const QString &text, bool *ok = Q_NULLPTR);
+
+    /**
+     * Reads a timestamp laid out as "yyyy-MM-dd hh:mm:ss", optionally followed by
+     * a fraction of second after a ',' or a '.', as printed by 7z and unrar 5.
+     *
+     * @return The timestamp, or an invalid QDateTime on failure.
+     */
+    static QDateTime toDateTime(const QStringRef &text);
+    static QDateTime toDateTime(const QString &text);
+
+    /**
+     * Reads a timestamp split into a "yyyyMMdd" date and a "hhmmss" time, as
+     * printed by zipinfo -T.
+     */
+    static QDateTime toCompactDateTime(const QStringRef &date, const QStringRef &time);
+
+    /**
+     * Reads a timestamp split into a "dd-MM-yy" date and a "hh:mm" time, as printed
+     * by unrar 3 and 4. Two-digit years before 50 are taken as 20yy.
+     */
+    static QDateTime toShortDateTime(const QStringRef &date, const QStringRef &time);
+
+private:
+    static bool readNumber(const QChar *&pos, const QChar *end, int digits, int *value);
+    static bool skip(const QChar *&pos, const QChar *end, QChar separator);
+    static QDateTime dateTime(int year, int month, int day, int hour, int minute, int second, int msec = 0);
+};
+
+}
+
+#endif // LISTINGSCANNER_H
@@ -26,37 +26,198 @@
 #include "mimetypes.h"
 #include "ark_debug.h"
 
+#include <QCache>
+#include <QDateTime>
+#include <QFile>
 #include <QFileInfo>
 #include <QMimeDatabase>
-#include <QRegularExpression>
+#include <QMutex>
 #include <QStandardPaths>
 
+#include <KCompressionDevice>
 #include <KPluginLoader>
 
+#include <cstring>
+
 namespace Kerfuffle
 {
 
-QMimeType determineMimeType(const QString& filename)
+// Large enough for the ustar magic at offset 257 and for every signature below.
+static const int HeaderSize = 512;
+
+struct MagicNumber
+{
+    int offset;
+    const char *bytes;
+    int length;
+    const char *mimeType;
+};
+
+// Signatures of the formats handled by the plugins. More specific ones come first.
+static const MagicNumber s_magicNumbers[] = {
+    { 0, "PK\x03\x04", 4, "application/zip" },
+    { 0, "PK\x05\x06", 4, "application/zip" },
+    { 0, "7z\xBC\xAF\x27\x1C", 6, "application/x-7z-compressed" },
+    { 0, "Rar!\x1A\x07", 6, "application/x-rar" },
+    { 0, "\x1F\x8B", 2, "application/gzip" },
+    { 0, "BZh", 3, "application/x-bzip" },
+    { 0, "\xFD" "7zXZ\x00", 6, "application/x-xz" },
+    { 0, "\x28\xB5\x2F\xFD", 4, "application/zstd" },
+    { 0, "\x1F\x9D", 2, "application/x-compress" },
+    { 0, "\x89LZO\x00\x0D\x0A\x1A\x0A", 9, "application/x-lzop" },
+    { 0, "LZIP", 4, "application/x-lzip" },
+    { 0, "LRZI", 4, "application/x-lrzip" },
+    { 0, "\x04\x22\x4D\x18", 4, "application/x-lz4" },
+    { 0, "xar!", 4, "application/x-xar" },
+    { 0, "!<arch>\ndebian-binary", 21, "application/x-deb" },
+    { 0, "!<arch>\n", 8, "application/x-archive" },
+    { 0, "\xED\xAB\xEE\xDB", 4, "application/x-rpm" },
+    { 0, "MSCF\x00\x00\x00\x00", 8, "application/vnd.ms-cab-compressed" },
+    { 257, "ustar", 5, "application/x-tar" }
+};
+
+// Pairs of extension-based and content-based mimetypes of compressed tar archives.
+// Detection by content only sees the compression, unless the tar header can be peeked.
+static const char *const s_compressedTarMimeTypes[][2] = {
+    { "application/x-compressed-tar", "application/gzip" },
+    { "application/x-bzip-compressed-tar", "application/x-bzip" },
+    { "application/x-xz-compressed-tar", "application/x-xz" },
+    { "application/x-zstd-compressed-tar", "application/zstd" },
+    { "application/x-tarz", "application/x-compress" },
+    { "application/x-tzo", "application/x-lzop" },
+    { "application/x-lzip-compressed-tar", "application/x-lzip" },
+    { "application/x-lrzip-compressed-tar", "application/x-lrzip" },
+    { "application/x-lz4-compressed-tar", "application/x-lz4" }
+};
+
+struct CachedMimeType
+{
+    qint64 size;
+    QDateTime lastModified;
+    QString name;
+};
+
+// Opening many archives at once (e.g. batch extraction) detects the same files
+// more than once, so the result is kept until the file changes.
+struct MimeTypeCache
+{
+    MimeTypeCache() : entries(1024) {}
+
+    QMutex mutex;
+    QCache<QString, CachedMimeType> entries;
+};
+
+Q_GLOBAL_STATIC(MimeTypeCache, s_mimeTypeCache)
+
+static bool isMimeType(const QMimeType &mime, const char *name)
+{
+    const QString mimeName = QLatin1String(name);
+    return mime.name() == mimeName || mime.aliases().contains(mimeName);
+}
+
+static bool hasMagic(const QByteArray &header, const MagicNumber &magic)
+{
+    return header.size() >= magic.offset + magic.length &&
+           std::memcmp(header.constData() + magic.offset, magic.bytes, magic.length) == 0;
+}
+
+static bool isTarHeader(const QByteArray &header)
+{
+    return header.size() >= 262 && header.mid(257, 5) == "ustar";
+}
+
+// Decompresses the first block of the file to tell a compressed tar from a single compressed file.
+static bool containsTar(const QString &filename, KCompressionDevice::CompressionType type)
+{
+    KCompressionDevice device(filename, type);
+    if (!device.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return isTarHeader(device.read(HeaderSize));
+}
+
+/**
+ * @return The mimetype matching the header of @p filename, or an empty string
+ * when the header is unknown and QMimeDatabase has to decide.
+ */
+static QString sniffMimeType(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    const QByteArray header = file.read(HeaderSize);
+    file.close();
+
+    for (const MagicNumber &magic : s_magicNumbers) {
+        if (!hasMagic(header, magic)) {
+            continue;
+        }
+
+        const QString mimeType = QLatin1String(magic.mimeType);
+        if (mimeType == QLatin1String("application/gzip") && containsTar(filename, KCompressionDevice::GZip)) {
+            return QStringLiteral("application/x-compressed-tar");
+        }
+        if (mimeType == QLatin1String("application/x-bzip") && containsTar(filename, KCompressionDevice::BZip2)) {
+            return QStringLiteral("application/x-bzip-compressed-tar");
+        }
+        if (mimeType == QLatin1String("application/x-xz") && containsTar(filename, KCompressionDevice::Xz)) {
+            return QStringLiteral("application/x-xz-compressed-tar");
+        }
+        return mimeType;
+    }
+
+    return QString();
+}
+
+// Keeps letters and periods only, e.g. "tar~1.gz" becomes "tar.gz".
+static QString lettersAndPeriods(const QString &extension)
+{
+    QString cleanExtension;
+    cleanExtension.reserve(extension.size());
+    foreach (const QChar &c, extension) {
+        if ((c >= QLatin1Char('a') && c <= QLatin1Char('z')) || c == QLatin1Char('.')) {
+            cleanExtension.append(c);
+        }
+    }
+    return cleanExtension;
+}
+
+static QMimeType mimeTypeFromContent(const QMimeDatabase &db, const QString &filename)
+{
+    const QString sniffedName = sniffMimeType(filename);
+    if (!sniffedName.isEmpty()) {
+        const QMimeType sniffed = db.mimeTypeForName(sniffedName);
+        // Older shared-mime-info releases may not know every format (e.g. zstd).
+        if (sniffed.isValid()) {
+            return sniffed;
+        }
+    }
+
+    return db.mimeTypeForFile(filename, QMimeDatabase::MatchContent);
+}
+
+static QMimeType detectMimeType(const QString& filename, const QFileInfo &fileinfo)
 {
     QMimeDatabase db;
 
-    QFileInfo fileinfo(filename);
     QString inputFile = filename;
+    const QString suffix = fileinfo.completeSuffix().toLower();
 
     // #328815: since detection-by-content does not work for compressed tar archives (see below why)
     // we cannot rely on it when the archive extension is wrong; we need to validate by hand.
-    if (fileinfo.completeSuffix().toLower().remove(QRegularExpression(QStringLiteral("[^a-z\\.]"))).contains(QStringLiteral("tar."))) {
+    if (lettersAndPeriods(suffix).contains(QStringLiteral("tar."))) {
         inputFile.chop(fileinfo.completeSuffix().length());
-        QString cleanExtension(fileinfo.completeSuffix().toLower());
+        QString cleanExtension(suffix);
 
         // tar.bz2 and tar.lz4 need special treatment since they contain numbers.
         bool isBZ2 = false;
         bool isLZ4 = false;
-        if (fileinfo.completeSuffix().toLower().contains(QStringLiteral("bz2"))) {
+        if (suffix.contains(QStringLiteral("bz2"))) {
             cleanExtension.remove(QStringLiteral("bz2"));
             isBZ2 = true;
         }
-        if (fileinfo.completeSuffix().toLower().contains(QStringLiteral("lz4"))) {
+        if (suffix.contains(QStringLiteral("lz4"))) {
             cleanExtension.remove(QStringLiteral("lz4"));
             isLZ4 = true;
         }
@@ -64,7 +225,7 @@ QMimeType determineMimeType(const QString& filename)
         // We remove non-alpha chars from the filename extension, but not periods.
         // If the filename is e.g. "foo.tar.gz.1", we get the "foo.tar.gz." string,
         // so we need to manually drop the last period character from it.
-        cleanExtension.remove(QRegularExpression(QStringLiteral("[^a-z\\.]")));
+        cleanExtension = lettersAndPeriods(cleanExtension);
         if (cleanExtension.endsWith(QLatin1Char('.'))) {
             cleanExtension.chop(1);
         }
@@ -82,36 +243,29 @@ QMimeType determineMimeType(const QString& filename)
     }
 
     QMimeType mimeFromExtension = db.mimeTypeForFile(inputFile, QMimeDatabase::MatchExtension);
-    QMimeType mimeFromContent = db.mimeTypeForFile(filename, QMimeDatabase::MatchContent);
 
-    // mimeFromContent will be "application/octet-stream" when file is
+    // Detection by content would give "application/octet-stream" when file is
     // unreadable, so use extension.
     if (!fileinfo.isReadable()) {
         return mimeFromExtension;
     }
 
-    // Compressed tar-archives are detected as single compressed files when
-    // detecting by content. The following code fixes detection of tar.gz, tar.bz2, tar.xz,
-    // tar.lzo, tar.lz and tar.lrz.
-    if ((mimeFromExtension == db.mimeTypeForName(QStringLiteral("application/x-compressed-tar")) &&
-         mimeFromContent == db.mimeTypeForName(QStringLiteral("application/gzip"))) ||
-        (mimeFromExtension == db.mimeTypeForName(QStringLiteral("application/x-bzip-compressed-tar")) &&
-         mimeFromContent == db.mimeTypeForName(QStringLiteral("application/x-bzip"))) ||
-        (mimeFromExtension == db.mimeTypeForName(QStringLiteral("application/x-xz-compressed-tar")) &&
-         mimeFromContent == db.mimeTypeForName(QStringLiteral("application/x-xz"))) ||
-        (mimeFromExtension == db.mimeTypeForName(QStringLiteral("application/x-tarz")) &&
-         mimeFromContent == db.mimeTypeForName(QStringLiteral("application/x-compress"))) ||
-        (mimeFromExtension == db.mimeTypeForName(QStringLiteral("application/x-tzo")) &&
-         mimeFromContent == db.mimeTypeForName(QStringLiteral("application/x-lzop"))) ||
-        (mimeFromExtension == db.mimeTypeForName(QStringLiteral("application/x-lzip-compressed-tar")) &&
-         mimeFromContent == db.mimeTypeForName(QStringLiteral("application/x-lzip"))) ||
-        (mimeFromExtension == db.mimeTypeForName(QStringLiteral("application/x-lrzip-compressed-tar")) &&
-         mimeFromContent == db.mimeTypeForName(QStringLiteral("application/x-lrzip"))) ||
-        (mimeFromExtension == db.mimeTypeForName(QStringLiteral("application/x-lz4-compressed-tar")) &&
-         mimeFromContent == db.mimeTypeForName(QStringLiteral("application/x-lz4")))) {
+    // #354344: ISO files are currently wrongly detected-by-content, and the extension
+    // wins anyway, so do not read them.
+    if (mimeFromExtension.inherits(QStringLiteral("application/x-cd-image"))) {
         return mimeFromExtension;
     }
 
+    QMimeType mimeFromContent = mimeTypeFromContent(db, filename);
+
+    // Compressed tar-archives are detected as single compressed files when the tar
+    // header cannot be peeked (e.g. tar.lzo, tar.lz, tar.lrz or old tar formats).
+    for (const auto &mimeTypes : s_compressedTarMimeTypes) {
+        if (isMimeType(mimeFromExtension, mimeTypes[0]) && isMimeType(mimeFromContent, mimeTypes[1])) {
+            return mimeFromExtension;
+        }
+    }
+
     if (mimeFromExtension != mimeFromContent) {
 
         if (mimeFromContent.isDefault()) {
@@ -120,8 +274,9 @@ QMimeType determineMimeType(const QString& filename)
             return mimeFromExtension;
         }
 
-        // #354344: ISO files are currently wrongly detected-by-content.
-        if (mimeFromExtension.inherits(QStringLiteral("application/x-cd-image"))) {
+        // The header only tells the container format, the extension may be more
+        // specific (e.g. a jar or an odt file are zip archives).
+        if (mimeFromExtension.inherits(mimeFromContent.name())) {
             return mimeFromExtension;
         }
 
@@ -133,4 +288,41 @@ QMimeType determineMimeType(const QString& filename)
     return mimeFromContent;
 }
 
+QMimeType determineMimeType(const QString& filename)
+{
+    QFileInfo fileinfo(filename);
+    if (filename.isEmpty() || !fileinfo.isFile()) {
+        return detectMimeType(filename, fileinfo);
+    }
+
+    const QString key = fileinfo.absoluteFilePath();
+    const qint64 size = fileinfo.size();
+    const QDateTime lastModified = fileinfo.lastModified();
+
+    QString cachedName;
+    {
+        QMutexLocker locker(&s_mimeTypeCache->mutex);
+        const CachedMimeType *cached = s_mimeTypeCache->entries.object(key);
+        if (cached && cached->size == size && cached->lastModified == lastModified) {
+            cachedName = cached->name;
+        }
+    }
+    if (!cachedName.isEmpty()) {
+        return QMimeDatabase().mimeTypeForName(cachedName);
+    }
+
+    const QMimeType mime = detectMimeType(filename, fileinfo);
+
+    QMutexLocker locker(&s_mimeTypeCache->mutex);
+    s_mimeTypeCache->entries.insert(key, new CachedMimeType { size, lastModified, mime.name() });
+
+    return mime;
+}
+
+void clearMimeTypeCache()
+{
+    QMutexLocker locker(&s_mimeTypeCache->mutex);
+    s_mimeTypeCache->entries.clear();
+}
+
 } // namespace Kerfuffle
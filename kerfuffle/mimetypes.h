@@ -32,7 +32,16 @@
 
 namespace Kerfuffle
 {
+    /**
+     * Detects the mimetype of @p filename from its header and its extension.
+     * The result is cached until the size or the modification time of the file change.
+     */
     KERFUFFLE_EXPORT QMimeType determineMimeType(const QString& filename);
+
+    /**
+     * Forgets the mimetypes detected so far.
+     */
+    KERFUFFLE_EXPORT void clearMimeTypeCache();
 }
 
 #endif // MIMETYPES_H
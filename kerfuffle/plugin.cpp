@@ -28,23 +28,47 @@
 #include "ark_debug.h"
 #include "plugin.h"
 
+#include <KPluginFactory>
+#include <KPluginLoader>
+
+#include <QHash>
 #include <QJsonArray>
+#include <QJsonObject>
+#include <QMutex>
 #include <QStandardPaths>
 
 namespace Kerfuffle
 {
 
+// Looking up an executable scans $PATH and loading a plugin factory resolves the
+// library, so both are done once per process.
+struct PluginLookupCache
+{
+    QMutex mutex;
+    // The path of every executable looked up, empty if it was not found.
+    QHash<QString, QString> foundExecutables;
+    QHash<QString, KPluginFactory*> factories;
+};
+
+Q_GLOBAL_STATIC(PluginLookupCache, s_lookupCache)
+
 Plugin::Plugin(QObject *parent, const KPluginMetaData &metaData)
     : QObject(parent)
     , m_enabled(true)
     , m_metaData(metaData)
 {
+    const QJsonObject json = m_metaData.rawData();
+
+    const int priority = json[QStringLiteral("X-KDE-Priority")].toInt();
+    m_priority = (priority > 0 ? priority : 0);
+    m_isDeclaredReadWrite = json[QStringLiteral("X-KDE-Kerfuffle-ReadWrite")].toBool();
+    m_readOnlyExecutables = executablesFrom(json[QStringLiteral("X-KDE-Kerfuffle-ReadOnlyExecutables")]);
+    m_readWriteExecutables = executablesFrom(json[QStringLiteral("X-KDE-Kerfuffle-ReadWriteExecutables")]);
 }
 
 unsigned int Plugin::priority() const
 {
-    const int priority = m_metaData.rawData()[QStringLiteral("X-KDE-Priority")].toInt();
-    return (priority > 0 ? priority : 0);
+    return m_priority;
 }
 
 bool Plugin::isEnabled() const
@@ -60,32 +84,17 @@ void Plugin::setEnabled(bool enabled)
 
 bool Plugin::isReadWrite() const
 {
-    const bool isDeclaredReadWrite = m_metaData.rawData()[QStringLiteral("X-KDE-Kerfuffle-ReadWrite")].toBool();
-    return isDeclaredReadWrite && findExecutables(readWriteExecutables());
+    return m_isDeclaredReadWrite && findExecutables(m_readWriteExecutables);
 }
 
 QStringList Plugin::readOnlyExecutables() const
 {
-    QStringList readOnlyExecutables;
-
-    const QJsonArray array = m_metaData.rawData()[QStringLiteral("X-KDE-Kerfuffle-ReadOnlyExecutables")].toArray();
-    foreach (const QJsonValue &value, array) {
-        readOnlyExecutables << value.toString();
-    }
-
-    return readOnlyExecutables;
+    return m_readOnlyExecutables;
 }
 
 QStringList Plugin::readWriteExecutables() const
 {
-    QStringList readWriteExecutables;
-
-    const QJsonArray array = m_metaData.rawData()[QStringLiteral("X-KDE-Kerfuffle-ReadWriteExecutables")].toArray();
-    foreach (const QJsonValue &value, array) {
-        readWriteExecutables << value.toString();
-    }
-
-    return readWriteExecutables;
+    return m_readWriteExecutables;
 }
 
 KPluginMetaData Plugin::metaData() const
@@ -95,7 +104,26 @@ KPluginMetaData Plugin::metaData() const
 
 bool Plugin::isValid() const
 {
-    return isEnabled() && m_metaData.isValid() && findExecutables(readOnlyExecutables());
+    return isEnabled() && m_metaData.isValid() && findExecutables(m_readOnlyExecutables);
+}
+
+KPluginFactory *Plugin::factory() const
+{
+    const QString fileName = m_metaData.fileName();
+
+    QMutexLocker locker(&s_lookupCache->mutex);
+    QHash<QString, KPluginFactory*>::const_iterator it = s_lookupCache->factories.constFind(fileName);
+    if (it != s_lookupCache->factories.constEnd()) {
+        return it.value();
+    }
+
+    KPluginFactory *factory = KPluginLoader(fileName).factory();
+    // Failures are not cached, the plugin may be fixed meanwhile.
+    if (factory) {
+        s_lookupCache->factories.insert(fileName, factory);
+    }
+
+    return factory;
 }
 
 bool Plugin::findExecutables(const QStringList &executables)
@@ -105,7 +133,7 @@ bool Plugin::findExecutables(const QStringList &executables)
             continue;
         }
 
-        if (QStandardPaths::findExecutable(executable).isEmpty()) {
+        if (findExecutable(executable).isEmpty()) {
             qCDebug(ARK) << "Could not find executable" << executable;
             return false;
         }
@@ -114,4 +142,33 @@ bool Plugin::findExecutables(const QStringList &executables)
     return true;
 }
 
+QString Plugin::findExecutable(const QString &executable)
+{
+    QMutexLocker locker(&s_lookupCache->mutex);
+
+    QHash<QString, QString>::iterator it = s_lookupCache->foundExecutables.find(executable);
+    if (it == s_lookupCache->foundExecutables.end()) {
+        it = s_lookupCache->foundExecutables.insert(executable, QStandardPaths::findExecutable(executable));
+    }
+
+    return it.value();
+}
+
+void Plugin::clearExecutableCache()
+{
+    QMutexLocker locker(&s_lookupCache->mutex);
+    s_lookupCache->foundExecutables.clear();
+}
+
+QStringList Plugin::executablesFrom(const QJsonValue &value)
+{
+    QStringList executables;
+
+    foreach (const QJsonValue &executable, value.toArray()) {
+        executables << executable.toString();
+    }
+
+    return executables;
+}
+
 }
@@ -34,6 +34,9 @@
 
 #include <KPluginMetaData>
 
+class KPluginFactory;
+class QJsonValue;
+
 namespace Kerfuffle
 {
 
@@ -92,18 +95,42 @@ public:
      */
     bool isValid() const;
 
-signals:
-    void enabledChanged();
-
-private:
+    /**
+     * @return The factory creating the archive interfaces of the plugin, or null if
+     * the plugin could not be loaded. The factories are loaded once per process.
+     */
+    KPluginFactory *factory() const;
 
     /**
      * @return Whether all the given executables are found in $PATH.
+     * Every executable is looked up once, until clearExecutableCache() is called.
      */
     static bool findExecutables(const QStringList &executables);
 
+    /**
+     * @return The path of @p executable in $PATH, or an empty string if it is not found.
+     * The path is cached like in findExecutables().
+     */
+    static QString findExecutable(const QString &executable);
+
+    /**
+     * Forgets the executables looked up so far, e.g. after some have been installed.
+     */
+    static void clearExecutableCache();
+
+signals:
+    void enabledChanged();
+
+private:
+
+    static QStringList executablesFrom(const QJsonValue &value);
+
     bool m_enabled;
     KPluginMetaData m_metaData;
+    unsigned int m_priority;
+    bool m_isDeclaredReadWrite;
+    QStringList m_readOnlyExecutables;
+    QStringList m_readWriteExecutables;
 };
 
 }
@@ -31,7 +31,9 @@
 #include <KPluginLoader>
 #include <KSharedConfig>
 
+#include <QHash>
 #include <QMimeDatabase>
+#include <QMutex>
 #include <QSet>
 
 #include <algorithm>
@@ -39,11 +41,44 @@
 namespace Kerfuffle
 {
 
+/**
+ * What the instances of PluginManager share: the plugins found with their settings,
+ * and the answers to the queries about mimetypes, as indexes in the plugins.
+ */
+class PluginRegistry
+{
+public:
+    QVector<KPluginMetaData> metaData;
+    QVector<bool> enabled;
+
+    QMutex mutex;
+    QHash<QString, QVector<int> > preferredPlugins;
+    QHash<QString, QVector<int> > preferredWritePlugins;
+    QStringList supportedMimeTypes;
+    QStringList supportedWriteMimeTypes;
+};
+
+struct CurrentPluginRegistry
+{
+    QMutex mutex;
+    QSharedPointer<PluginRegistry> registry;
+};
+
+Q_GLOBAL_STATIC(CurrentPluginRegistry, s_currentRegistry)
+
 PluginManager::PluginManager(QObject *parent) : QObject(parent)
 {
     loadPlugins();
 }
 
+void PluginManager::invalidateCache()
+{
+    Plugin::clearExecutableCache();
+
+    QMutexLocker locker(&s_currentRegistry->mutex);
+    s_currentRegistry->registry.clear();
+}
+
 QVector<Plugin*> PluginManager::installedPlugins() const
 {
     return m_plugins;
@@ -109,42 +144,54 @@ Plugin *PluginManager::preferredWritePluginFor(const QMimeType &mimeType) const
 
 QStringList PluginManager::supportedMimeTypes() const
 {
+    QMutexLocker locker(&m_registry->mutex);
+    if (!m_registry->supportedMimeTypes.isEmpty()) {
+        return m_registry->supportedMimeTypes;
+    }
+
     QSet<QString> supported;
     foreach (Plugin *plugin, availablePlugins()) {
         supported += plugin->metaData().mimeTypes().toSet();
     }
 
     // Remove entry for lrzipped tar if lrzip executable not found in path.
-    if (QStandardPaths::findExecutable(QStringLiteral("lrzip")).isEmpty()) {
+    if (!Plugin::findExecutables(QStringList() << QStringLiteral("lrzip"))) {
         supported.remove(QStringLiteral("application/x-lrzip-compressed-tar"));
     }
 
     // Remove entry for lz4-compressed tar if lz4 executable not found in path.
-    if (QStandardPaths::findExecutable(QStringLiteral("lz4")).isEmpty()) {
+    if (!Plugin::findExecutables(QStringList() << QStringLiteral("lz4"))) {
         supported.remove(QStringLiteral("application/x-lz4-compressed-tar"));
     }
 
-    return sortByComment(supported);
+    m_registry->supportedMimeTypes = sortByComment(supported);
+    return m_registry->supportedMimeTypes;
 }
 
 QStringList PluginManager::supportedWriteMimeTypes() const
 {
+    QMutexLocker locker(&m_registry->mutex);
+    if (!m_registry->supportedWriteMimeTypes.isEmpty()) {
+        return m_registry->supportedWriteMimeTypes;
+    }
+
     QSet<QString> supported;
     foreach (Plugin *plugin, availableWritePlugins()) {
         supported += plugin->metaData().mimeTypes().toSet();
     }
 
     // Remove entry for lrzipped tar if lrzip executable not found in path.
-    if (QStandardPaths::findExecutable(QStringLiteral("lrzip")).isEmpty()) {
+    if (!Plugin::findExecutables(QStringList() << QStringLiteral("lrzip"))) {
         supported.remove(QStringLiteral("application/x-lrzip-compressed-tar"));
     }
 
     // Remove entry for lz4-compressed tar if lz4 executable not found in path.
-    if (QStandardPaths::findExecutable(QStringLiteral("lz4")).isEmpty()) {
+    if (!Plugin::findExecutables(QStringList() << QStringLiteral("lz4"))) {
         supported.remove(QStringLiteral("application/x-lz4-compressed-tar"));
     }
 
-    return sortByComment(supported);
+    m_registry->supportedWriteMimeTypes = sortByComment(supported);
+    return m_registry->supportedWriteMimeTypes;
 }
 
 QVector<Plugin*> PluginManager::filterBy(const QVector<Plugin*> &plugins, const QMimeType &mimeType) const
@@ -169,29 +216,71 @@ QVector<Plugin*> PluginManager::filterBy(const QVector<Plugin*> &plugins, const
 
 void PluginManager::loadPlugins()
 {
-    const QVector<KPluginMetaData> plugins = KPluginLoader::findPlugins(QStringLiteral("kerfuffle"));
-    // TODO: once we have a GUI in the settings dialog,
-    // use this group to write whether a plugin gets disabled.
-    const KConfigGroup conf(KSharedConfig::openConfig(), "EnabledPlugins");
+    {
+        QMutexLocker locker(&s_currentRegistry->mutex);
+        if (!s_currentRegistry->registry) {
+            QSharedPointer<PluginRegistry> registry(new PluginRegistry);
+            registry->metaData = KPluginLoader::findPlugins(QStringLiteral("kerfuffle"));
+
+            // TODO: once we have a GUI in the settings dialog,
+            // use this group to write whether a plugin gets disabled.
+            const KConfigGroup conf(KSharedConfig::openConfig(), "EnabledPlugins");
+            foreach (const KPluginMetaData &metaData, registry->metaData) {
+                registry->enabled << conf.readEntry(metaData.pluginId(), true);
+            }
 
-    foreach (const KPluginMetaData &metaData, plugins) {
-        Plugin *plugin = new Plugin(this, metaData);
-        plugin->setEnabled(conf.readEntry(metaData.pluginId(), true));
+            s_currentRegistry->registry = registry;
+        }
+        m_registry = s_currentRegistry->registry;
+    }
+
+    for (int i = 0; i < m_registry->metaData.size(); ++i) {
+        Plugin *plugin = new Plugin(this, m_registry->metaData.at(i));
+        plugin->setEnabled(m_registry->enabled.at(i));
         m_plugins << plugin;
     }
 }
 
 QVector<Plugin*> PluginManager::preferredPluginsFor(const QMimeType &mimeType, bool readWrite) const
 {
+    {
+        QMutexLocker locker(&m_registry->mutex);
+        const QHash<QString, QVector<int> > &cache = readWrite ? m_registry->preferredWritePlugins : m_registry->preferredPlugins;
+        QHash<QString, QVector<int> >::const_iterator it = cache.constFind(mimeType.name());
+        if (it != cache.constEnd()) {
+            return pluginsAt(it.value());
+        }
+    }
+
     QVector<Plugin*> preferredPlugins = filterBy((readWrite ? availableWritePlugins() : availablePlugins()), mimeType);
 
     std::sort(preferredPlugins.begin(), preferredPlugins.end(), [](Plugin* p1, Plugin* p2) {
         return p1->priority() > p2->priority();
     });
 
+    QVector<int> indexes;
+    indexes.reserve(preferredPlugins.size());
+    foreach (Plugin *plugin, preferredPlugins) {
+        indexes << m_plugins.indexOf(plugin);
+    }
+
+    QMutexLocker locker(&m_registry->mutex);
+    (readWrite ? m_registry->preferredWritePlugins : m_registry->preferredPlugins).insert(mimeType.name(), indexes);
+
     return preferredPlugins;
 }
 
+QVector<Plugin*> PluginManager::pluginsAt(const QVector<int> &indexes) const
+{
+    QVector<Plugin*> plugins;
+    plugins.reserve(indexes.size());
+    foreach (int index, indexes) {
+        plugins << m_plugins.at(index);
+    }
+
+    return plugins;
+}
+
 QStringList PluginManager::sortByComment(const QSet<QString> &mimeTypes)
 {
     QMap<QString,QString> map;
@@ -31,10 +31,13 @@
 #include "plugin.h"
 
 #include <QMimeType>
+#include <QSharedPointer>
 
 namespace Kerfuffle
 {
 
+class PluginRegistry;
+
 class KERFUFFLE_EXPORT PluginManager : public QObject
 {
     Q_OBJECT
@@ -105,6 +108,14 @@ public:
      */
     QVector<Plugin*> filterBy(const QVector<Plugin*> &plugins, const QMimeType &mimeType) const;
 
+    /**
+     * Forgets the installed plugins, the executables looked up and the preferred
+     * plugins of each mimetype, which are otherwise shared by all the instances of
+     * the process. To be called when plugins or executables are installed, or when
+     * the plugin settings change. The existing instances keep what they loaded.
+     */
+    static void invalidateCache();
+
 private:
 
     void loadPlugins();
@@ -120,6 +131,12 @@ private:
      */
     static QStringList sortByComment(const QSet<QString> &mimeTypes);
 
+    /**
+     * @return The plugins at @p indexes in m_plugins.
+     */
+    QVector<Plugin*> pluginsAt(const QVector<int> &indexes) const;
+
+    QSharedPointer<PluginRegistry> m_registry;
     QVector<Plugin*> m_plugins;
 };
 
@@ -65,25 +65,25 @@ PropertiesDialog::PropertiesDialog(QWidget *parent, Archive *archive)
     m_ui->lblMimetype->setText(archive->mimeType().name());
     m_ui->lblReadOnly->setText(archive->isReadOnly() ?  i18n("yes") : i18n("no"));
     m_ui->lblHasComment->setText(archive->hasComment() ?  i18n("yes") : i18n("no"));
-    m_ui->lblNumberOfFiles->setText(QString::number(archive->numberOfFiles()));
-    m_ui->lblUnpackedSize->setText(KIO::convertSize(archive->unpackedSize()));
     m_ui->lblPackedSize->setText(KIO::convertSize(archive->packedSize()));
-    m_ui->lblCompressionRatio->setText(QString::number(float(archive->unpackedSize()) / float(archive->packedSize()), 'f', 1));
     m_ui->lblLastModified->setText(fi.lastModified().toString(QStringLiteral("yyyy-MM-dd HH:mm")));
     m_ui->lblMD5->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
     m_ui->lblSHA1->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
     m_ui->lblSHA256->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
 
-    switch (archive->encryptionType()) {
-    case Archive::Unencrypted:
-        m_ui->lblPasswordProtected->setText(i18n("no"));
-        break;
-    case Archive::Encrypted:
-        m_ui->lblPasswordProtected->setText(i18n("yes (excluding the list of files)"));
-        break;
-    case Archive::HeaderEncrypted:
-        m_ui->lblPasswordProtected->setText(i18n("yes (including the list of files)"));
-        break;
+    if (archive->hasMetaData()) {
+        showMetaData(archive);
+    } else {
+        // The dialog doesn't wait for the archive to be listed: the size found
+        // without listing it, if any, is shown meanwhile.
+        m_ui->lblNumberOfFiles->setText(i18n("Calculating..."));
+        m_ui->lblPasswordProtected->setText(i18n("Calculating..."));
+        showUnpackedSize(archive->estimatedUnpackedSize(), archive->packedSize());
+
+        connect(archive, &Archive::metaDataLoaded, this, [this, archive]() {
+            showMetaData(archive);
+        });
+        archive->loadMetaData();
     }
 
     // The Sha256 label is populated with 64 chars in the ui file. We fix the
@@ -130,6 +130,30 @@ PropertiesDialog::PropertiesDialog(QWidget *parent, Archive *archive)
     connect(m_ui->buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
 }
 
+void PropertiesDialog::showMetaData(Archive *archive)
+{
+    m_ui->lblNumberOfFiles->setText(QString::number(archive->numberOfFiles()));
+    showUnpackedSize(archive->unpackedSize(), archive->packedSize());
+
+    switch (archive->encryptionType()) {
+    case Archive::Unencrypted:
+        m_ui->lblPasswordProtected->setText(i18n("no"));
+        break;
+    case Archive::Encrypted:
+        m_ui->lblPasswordProtected->setText(i18n("yes (excluding the list of files)"));
+        break;
+    case Archive::HeaderEncrypted:
+        m_ui->lblPasswordProtected->setText(i18n("yes (including the list of files)"));
+        break;
+    }
+}
+
+void PropertiesDialog::showUnpackedSize(qulonglong unpackedSize, qulonglong packedSize)
+{
+    m_ui->lblUnpackedSize->setText(KIO::convertSize(unpackedSize));
+    m_ui->lblCompressionRatio->setText(QString::number(float(unpackedSize) / float(packedSize), 'f', 1));
+}
+
 QString PropertiesDialog::calcHash(QCryptographicHash::Algorithm algorithm)
 {
     QCryptographicHash hash(algorithm);
@@ -50,6 +50,12 @@ private slots:
 private:
     QString calcHash(QCryptographicHash::Algorithm algorithm);
 
+    /**
+     * Shows the properties only known once @p archive has been listed.
+     */
+    void showMetaData(Archive *archive);
+    void showUnpackedSize(qulonglong unpackedSize, qulonglong packedSize);
+
     class PropertiesDialogUI *m_ui;
     QByteArray m_byteArray;
     QFuture<QString> m_futureCalcSha1;
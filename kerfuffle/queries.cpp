@@ -35,10 +35,16 @@
 
 #include <QApplication>
 #include <QCheckBox>
+#include <QDialog>
+#include <QDialogButtonBox>
 #include <QDir>
+#include <QLabel>
+#include <QListWidget>
 #include <QMessageBox>
 #include <QPointer>
+#include <QPushButton>
 #include <QUrl>
+#include <QVBoxLayout>
 
 namespace Kerfuffle
 {
@@ -161,6 +167,98 @@ bool OverwriteQuery::multiMode()
     return m_multiMode;
 }
 
+BatchOverwriteQuery::BatchOverwriteQuery(const QStringList &filenames)
+{
+    m_data[QStringLiteral("filenames")] = filenames;
+}
+
+void BatchOverwriteQuery::execute()
+{
+    qCDebug(ARK) << "Executing batch overwrite prompt";
+
+    // If we are being called from the KPart, the cursor is probably Qt::WaitCursor
+    // at the moment (#231974)
+    QApplication::setOverrideCursor(QCursor(Qt::ArrowCursor));
+
+    const QStringList filenames = m_data.value(QStringLiteral("filenames")).toStringList();
+
+    QPointer<QDialog> dialog = new QDialog;
+    dialog.data()->setWindowTitle(i18nc("@title:window", "Files Already Exist"));
+
+    QLabel *label = new QLabel(i18ncp("@info", "The following file already exists in the destination. Check it to overwrite it:",
+                                      "The following %1 files already exist in the destination. Check the ones to overwrite:",
+                                      filenames.count()));
+    label->setWordWrap(true);
+
+    QListWidget *list = new QListWidget;
+    foreach (const QString &filename, filenames) {
+        QListWidgetItem *item = new QListWidgetItem(filename, list);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Unchecked);
+    }
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Cancel);
+    QPushButton *overwriteAllButton = buttons->addButton(i18nc("@action:button", "Overwrite All"), QDialogButtonBox::AcceptRole);
+    QPushButton *skipAllButton = buttons->addButton(i18nc("@action:button", "Skip All"), QDialogButtonBox::AcceptRole);
+    QPushButton *continueButton = buttons->addButton(i18nc("@action:button", "Overwrite Checked"), QDialogButtonBox::AcceptRole);
+    continueButton->setDefault(true);
+
+    QObject::connect(overwriteAllButton, &QPushButton::clicked, [list]() {
+        for (int i = 0; i < list->count(); ++i) {
+            list->item(i)->setCheckState(Qt::Checked);
+        }
+    });
+    QObject::connect(skipAllButton, &QPushButton::clicked, [list]() {
+        for (int i = 0; i < list->count(); ++i) {
+            list->item(i)->setCheckState(Qt::Unchecked);
+        }
+    });
+    QObject::connect(buttons, &QDialogButtonBox::accepted, dialog.data(), &QDialog::accept);
+    QObject::connect(buttons, &QDialogButtonBox::rejected, dialog.data(), &QDialog::reject);
+
+    QVBoxLayout *layout = new QVBoxLayout(dialog.data());
+    layout->addWidget(label);
+    layout->addWidget(list);
+    layout->addWidget(buttons);
+
+    const int result = dialog.data()->exec();
+
+    if (dialog) {
+        QStringList overwritten;
+        QStringList skipped;
+        for (int i = 0; i < list->count(); ++i) {
+            if (list->item(i)->checkState() == Qt::Checked) {
+                overwritten << list->item(i)->text();
+            } else {
+                skipped << list->item(i)->text();
+            }
+        }
+        m_data[QStringLiteral("overwrittenFiles")] = overwritten;
+        m_data[QStringLiteral("skippedFiles")] = skipped;
+    }
+
+    setResponse(result);
+
+    delete dialog.data();
+
+    QApplication::restoreOverrideCursor();
+}
+
+bool BatchOverwriteQuery::responseCancelled()
+{
+    return m_data.value(QStringLiteral("response")).toInt() != QDialog::Accepted;
+}
+
+QStringList BatchOverwriteQuery::overwrittenFiles()
+{
+    return m_data.value(QStringLiteral("overwrittenFiles")).toStringList();
+}
+
+QStringList BatchOverwriteQuery::skippedFiles()
+{
+    return m_data.value(QStringLiteral("skippedFiles")).toStringList();
+}
+
 PasswordNeededQuery::PasswordNeededQuery(const QString& archiveFilename, bool incorrectTryAgain)
 {
     m_data[QStringLiteral( "archiveFilename" )] = archiveFilename;
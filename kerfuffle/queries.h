@@ -32,6 +32,7 @@
 
 #include <QCheckBox>
 #include <QString>
+#include <QStringList>
 #include <QHash>
 #include <QWaitCondition>
 #include <QMutex>
@@ -101,6 +102,30 @@ private:
     bool m_multiMode;
 };
 
+/* ****************************************************************
+ * Used to query the user at once about all the existing files that
+ * an extraction would overwrite.
+ * ****************************************************************
+ */
+class KERFUFFLE_EXPORT BatchOverwriteQuery : public Query
+{
+public:
+    explicit BatchOverwriteQuery(const QStringList &filenames);
+    void execute() Q_DECL_OVERRIDE;
+
+    bool responseCancelled();
+
+    /**
+     * @return The files to overwrite, chosen one by one or all at once.
+     */
+    QStringList overwrittenFiles();
+
+    /**
+     * @return The existing files to keep.
+     */
+    QStringList skippedFiles();
+};
+
 /* **************************************
  * Used to query the user for a password.
  * **************************************
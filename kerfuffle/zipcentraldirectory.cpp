@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "zipcentraldirectory.h"
+
+#include <QFile>
+#include <QtEndian>
+
+namespace Kerfuffle
+{
+
+static const quint32 s_endOfCentralDirectorySignature = 0x06054b50;
+static const quint32 s_zip64EndOfCentralDirectorySignature = 0x06064b50;
+static const quint32 s_zip64LocatorSignature = 0x07064b50;
+static const quint32 s_centralDirectoryHeaderSignature = 0x02014b50;
+
+static const int s_endOfCentralDirectorySize = 22;
+static const int s_zip64EndOfCentralDirectorySize = 56;
+static const int s_zip64LocatorSize = 20;
+static const int s_centralDirectoryHeaderSize = 46;
+
+static const quint16 s_zip64ExtraField = 0x0001;
+static const quint16 s_extendedTimestampExtraField = 0x5455;
+
+static inline quint16 readUInt16(const uchar *data)
+{
+    return qFromLittleEndian<quint16>(data);
+}
+
+static inline quint32 readUInt32(const uchar *data)
+{
+    return qFromLittleEndian<quint32>(data);
+}
+
+static inline quint64 readUInt64(const uchar *data)
+{
+    return qFromLittleEndian<quint64>(data);
+}
+
+static QDateTime fromDosDateTime(quint16 date, quint16 time)
+{
+    return QDateTime(QDate(1980 + (date >> 9), (date >> 5) & 0x0f, date & 0x1f),
+                     QTime(time >> 11, (time >> 5) & 0x3f, (time & 0x1f) * 2));
+}
+
+QString ZipCentralDirectory::Record::fullPath() const
+{
+    // Bit 11 tells that the name is encoded in UTF-8, otherwise it is taken
+    // as a local file name, like libarchive does.
+    return (flags & 0x0800) ? QString::fromUtf8(name) : QFile::decodeName(name);
+}
+
+bool ZipCentralDirectory::Record::isDir() const
+{
+    const bool isUnixDir = ((versionMadeBy >> 8) == 3 && ((externalAttributes >> 16) & 0170000) == 0040000);
+    return name.endsWith('/') || isUnixDir;
+}
+
+bool ZipCentralDirectory::Record::isEncrypted() const
+{
+    return flags & 0x0001;
+}
+
+ZipCentralDirectory::ZipCentralDirectory()
+    : m_offset(0)
+    , m_bytesRead(0)
+{
+}
+
+bool ZipCentralDirectory::read(QFile *file)
+{
+    m_records.clear();
+    m_offset = 0;
+    m_bytesRead = 0;
+    m_errorString.clear();
+
+    // The end of central directory record is followed by a comment of up to
+    // 65535 bytes and preceded by the zip64 locator, if any.
+    const qint64 fileSize = file->size();
+    const qint64 tailSize = qMin<qint64>(fileSize, s_zip64LocatorSize + s_endOfCentralDirectorySize + 0xffff);
+    const qint64 tailOffset = fileSize - tailSize;
+    if (!file->seek(tailOffset)) {
+        m_errorString = file->errorString();
+        return false;
+    }
+
+    const QByteArray tail = file->read(tailSize);
+    m_bytesRead += tail.size();
+    if (tail.size() != tailSize) {
+        m_errorString = file->errorString();
+        return false;
+    }
+
+    const uchar *tailData = reinterpret_cast<const uchar*>(tail.constData());
+    int recordPosition = -1;
+    for (int i = tail.size() - s_endOfCentralDirectorySize; i >= 0; --i) {
+        if (readUInt32(tailData + i) == s_endOfCentralDirectorySignature &&
+            i + s_endOfCentralDirectorySize + readUInt16(tailData + i + 20) <= tail.size()) {
+            recordPosition = i;
+            break;
+        }
+    }
+
+    if (recordPosition < 0) {
+        m_errorString = QStringLiteral("The end of the central directory could not be found.");
+        return false;
+    }
+
+    const uchar *record = tailData + recordPosition;
+    quint64 entryCount = readUInt16(record + 10);
+    quint64 size = readUInt32(record + 12);
+    quint64 offset = readUInt32(record + 16);
+
+    // Where the central directory ends, used to find out how much data precedes
+    // the archive (e.g. in self-extracting archives).
+    qint64 end = tailOffset + recordPosition;
+
+    if ((entryCount == 0xffff || size == 0xffffffff || offset == 0xffffffff) &&
+        recordPosition >= s_zip64LocatorSize &&
+        readUInt32(record - s_zip64LocatorSize) == s_zip64LocatorSignature) {
+
+        // The zip64 record normally comes right before its locator, which is
+        // tried as well if the recorded position is off.
+        const qint64 locatorOffset = tailOffset + recordPosition - s_zip64LocatorSize;
+        const qint64 recordedOffset = readUInt64(record - s_zip64LocatorSize + 8);
+        foreach (const qint64 zip64Offset, QVector<qint64>() << recordedOffset << locatorOffset - s_zip64EndOfCentralDirectorySize) {
+            if (zip64Offset < 0 || !file->seek(zip64Offset)) {
+                continue;
+            }
+
+            const QByteArray zip64Record = file->read(s_zip64EndOfCentralDirectorySize);
+            m_bytesRead += zip64Record.size();
+            const uchar *zip64Data = reinterpret_cast<const uchar*>(zip64Record.constData());
+            if (zip64Record.size() == s_zip64EndOfCentralDirectorySize &&
+                readUInt32(zip64Data) == s_zip64EndOfCentralDirectorySignature) {
+                entryCount = readUInt64(zip64Data + 32);
+                size = readUInt64(zip64Data + 40);
+                offset = readUInt64(zip64Data + 48);
+                end = zip64Offset;
+                break;
+            }
+        }
+    }
+
+    const qint64 baseOffset = end - qint64(size) - qint64(offset);
+    if (size > quint64(end) || baseOffset < 0) {
+        m_errorString = QStringLiteral("The central directory is damaged.");
+        return false;
+    }
+
+    m_offset = baseOffset + offset;
+    if (!file->seek(m_offset)) {
+        m_errorString = file->errorString();
+        return false;
+    }
+
+    const QByteArray centralDirectory = file->read(size);
+    m_bytesRead += centralDirectory.size();
+    if (quint64(centralDirectory.size()) != size) {
+        m_errorString = file->errorString();
+        return false;
+    }
+
+    m_records.reserve(qMin<quint64>(entryCount, size / s_centralDirectoryHeaderSize));
+    return readRecords(centralDirectory, baseOffset);
+}
+
+bool ZipCentralDirectory::readRecords(const QByteArray &centralDirectory, qint64 baseOffset)
+{
+    const uchar *data = reinterpret_cast<const uchar*>(centralDirectory.constData());
+    int position = 0;
+
+    while (position + s_centralDirectoryHeaderSize <= centralDirectory.size()) {
+        const uchar *header = data + position;
+        if (readUInt32(header) != s_centralDirectoryHeaderSignature) {
+            break;
+        }
+
+        const int nameLength = readUInt16(header + 28);
+        const int extraLength = readUInt16(header + 30);
+        const int commentLength = readUInt16(header + 32);
+        const int headerSize = s_centralDirectoryHeaderSize + nameLength + extraLength + commentLength;
+        if (position + headerSize > centralDirectory.size()) {
+            m_errorString = QStringLiteral("The central directory is truncated.");
+            return false;
+        }
+
+        Record record;
+        record.versionMadeBy = readUInt16(header + 4);
+        record.flags = readUInt16(header + 8);
+        record.method = readUInt16(header + 10);
+        record.timestamp = fromDosDateTime(readUInt16(header + 14), readUInt16(header + 12));
+        record.crc = readUInt32(header + 16);
+        record.compressedSize = readUInt32(header + 20);
+        record.size = readUInt32(header + 24);
+        record.externalAttributes = readUInt32(header + 38);
+        record.name = centralDirectory.mid(position + s_centralDirectoryHeaderSize, nameLength);
+        quint64 localHeaderOffset = readUInt32(header + 42);
+
+        const uchar *extra = header + s_centralDirectoryHeaderSize + nameLength;
+        int extraPosition = 0;
+        while (extraPosition + 4 <= extraLength) {
+            const quint16 fieldId = readUInt16(extra + extraPosition);
+            const int fieldSize = readUInt16(extra + extraPosition + 2);
+            const uchar *field = extra + extraPosition + 4;
+            if (extraPosition + 4 + fieldSize > extraLength) {
+                break;
+            }
+
+            if (fieldId == s_zip64ExtraField) {
+                // Only the values which don't fit in the header are there, in this order.
+                int fieldPosition = 0;
+                if (record.size == 0xffffffff && fieldPosition + 8 <= fieldSize) {
+                    record.size = readUInt64(field + fieldPosition);
+                    fieldPosition += 8;
+                }
+                if (record.compressedSize == 0xffffffff && fieldPosition + 8 <= fieldSize) {
+                    record.compressedSize = readUInt64(field + fieldPosition);
+                    fieldPosition += 8;
+                }
+                if (localHeaderOffset == 0xffffffff && fieldPosition + 8 <= fieldSize) {
+                    localHeaderOffset = readUInt64(field + fieldPosition);
+                }
+            } else if (fieldId == s_extendedTimestampExtraField && fieldSize >= 5 && (field[0] & 0x01)) {
+                // The modification time in UTC, more precise than the DOS one.
+                record.timestamp = QDateTime::fromMSecsSinceEpoch(qint64(qint32(readUInt32(field + 1))) * 1000);
+            }
+
+            extraPosition += 4 + fieldSize;
+        }
+
+        record.localHeaderOffset = baseOffset + localHeaderOffset;
+        m_records.append(record);
+
+        position += headerSize;
+    }
+
+    return true;
+}
+
+const QVector<ZipCentralDirectory::Record> &ZipCentralDirectory::records() const
+{
+    return m_records;
+}
+
+qint64 ZipCentralDirectory::offset() const
+{
+    return m_offset;
+}
+
+qint64 ZipCentralDirectory::bytesRead() const
+{
+    return m_bytesRead;
+}
+
+qulonglong ZipCentralDirectory::unpackedSize() const
+{
+    qulonglong size = 0;
+    foreach (const Record &record, m_records) {
+        size += record.size;
+    }
+    return size;
+}
+
+QString ZipCentralDirectory::errorString() const
+{
+    return m_errorString;
+}
+
+} // namespace Kerfuffle
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ZIPCENTRALDIRECTORY_H
+#define ZIPCENTRALDIRECTORY_H
+
+#include "kerfuffle_export.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QVector>
+
+class QFile;
+
+namespace Kerfuffle
+{
+
+/**
+ * Reads the central directory found at the end of a zip archive.
+ *
+ * Only the end of central directory record and the central directory itself are
+ * read, so the archive can be listed without going through its local headers.
+ */
+class KERFUFFLE_EXPORT ZipCentralDirectory
+{
+public:
+    struct Record
+    {
+        QByteArray name;
+        quint16 versionMadeBy;
+        quint16 flags;
+        quint16 method;
+        quint32 crc;
+        quint64 compressedSize;
+        quint64 size;
+        quint32 externalAttributes;
+        QDateTime timestamp;
+
+        /**
+         * Position of the local header of the entry in the archive file.
+         */
+        qint64 localHeaderOffset;
+
+        QString fullPath() const;
+        bool isDir() const;
+        bool isEncrypted() const;
+    };
+
+    ZipCentralDirectory();
+
+    /**
+     * Reads the central directory of the zip archive @p file, which must be open.
+     */
+    bool read(QFile *file);
+
+    const QVector<Record> &records() const;
+
+    /**
+     * @return Position of the central directory in the archive file, that is where
+     * the data of the last entry ends.
+     */
+    qint64 offset() const;
+
+    /**
+     * @return The number of bytes read from the archive file by read().
+     */
+    qint64 bytesRead() const;
+
+    /**
+     * @return The sum of the uncompressed sizes of the records.
+     */
+    qulonglong unpackedSize() const;
+
+    QString errorString() const;
+
+private:
+    bool readRecords(const QByteArray &centralDirectory, qint64 baseOffset);
+
+    QVector<Record> m_records;
+    qint64 m_offset;
+    qint64 m_bytesRead;
+    QString m_errorString;
+};
+
+} // namespace Kerfuffle
+
+#endif // ZIPCENTRALDIRECTORY_H
@@ -39,6 +39,10 @@ using namespace Kerfuffle;
 static Archive::Entry *s_previousMatch = Q_NULLPTR;
 Q_GLOBAL_STATIC(QStringList, s_previousPieces)
 
+// Number of entries received at once above which the model is reset instead
+// of announcing each inserted row.
+static const int s_resetThreshold = 1000;
+
 /**
  * Meta data related to one entry in a compressed archive.
  *
@@ -492,7 +496,7 @@ QString ArchiveModel::cleanFileName(const QString& fileName)
     return fileName;
 }
 
-Archive::Entry *ArchiveModel::parentFor(const Archive::Entry *entry)
+Archive::Entry *ArchiveModel::parentFor(const Archive::Entry *entry, InsertBehaviour behaviour)
 {
     QStringList pieces = entry->fullPath().split(QLatin1Char( '/' ), QString::SkipEmptyParts);
     if (pieces.isEmpty()) {
@@ -535,14 +539,14 @@ Archive::Entry *ArchiveModel::parentFor(const Archive::Entry *entry)
                                            ? piece
                                            : parent->fullPath(true) + QLatin1Char('/') + piece);
             entry->setProperty("isDirectory", true);
-            insertEntry(entry);
+            insertEntry(entry, behaviour);
         }
         if (!entry->isDir()) {
             Archive::Entry *e = new Archive::Entry(parent);
             e->copyMetaData(entry);
             // Maybe we have both a file and a directory of the same name.
             // We avoid removing previous entries unless necessary.
-            insertEntry(e);
+            insertEntry(e, behaviour);
         }
         parent = entry;
     }
@@ -589,21 +593,55 @@ void ArchiveModel::slotUserQuery(Kerfuffle::Query *query)
     query->execute();
 }
 
-void ArchiveModel::slotNewEntryFromSetArchive(Archive::Entry *entry)
+void ArchiveModel::slotNewEntriesFromSetArchive(const QVector<Archive::Entry*> &entries)
 {
     // we cache all entries that appear when opening a new archive
     // so we can all them together once it's done, this is a huge
     // performance improvement because we save from doing lots of
     // begin/endInsertRows
-    m_newArchiveEntries.push_back(entry);
+    m_newArchiveEntries.reserve(m_newArchiveEntries.size() + entries.size());
+    foreach (Archive::Entry *entry, entries) {
+        m_newArchiveEntries.push_back(entry);
+    }
+}
+
+void ArchiveModel::slotNewEntries(const QVector<Archive::Entry*> &entries)
+{
+    int i = 0;
+
+    // The first entry may decide which columns are shown, which needs the views
+    // to be notified.
+    if (m_showColumns.isEmpty() || entries.size() == 1) {
+        newEntry(entries.at(i++), NotifyViews, true);
+    }
+    if (i == entries.size()) {
+        return;
+    }
+
+    // Announcing each row is cheaper for the views than a reset, unless the
+    // batch is big enough to make the tree worth building again.
+    if (entries.size() - i < s_resetThreshold) {
+        for (; i < entries.size(); ++i) {
+            newEntry(entries.at(i), NotifyViews, true);
+        }
+        return;
+    }
+
+    beginResetModel();
+    for (; i < entries.size(); ++i) {
+        newEntry(entries.at(i), DoNotNotifyViews, true);
+    }
+    endResetModel();
 }
 
-void ArchiveModel::slotNewEntry(Archive::Entry *entry)
+void ArchiveModel::slotEntriesRemoved(const QStringList &paths)
 {
-    newEntry(entry, NotifyViews);
+    foreach (const QString &path, paths) {
+        slotEntryRemoved(path);
+    }
 }
 
-void ArchiveModel::newEntry(Archive::Entry *receivedEntry, InsertBehaviour behaviour)
+void ArchiveModel::newEntry(Archive::Entry *receivedEntry, InsertBehaviour behaviour, bool replaceExisting)
 {
     if (receivedEntry->fullPath().isEmpty()) {
         qCDebug(ARK) << "Weird, received empty entry (no filename) - skipping";
@@ -642,6 +680,22 @@ void ArchiveModel::newEntry(Archive::Entry *receivedEntry, InsertBehaviour behav
 
     /// 1. Skip already created entries
     Archive::Entry *existing = m_rootEntry.findByPath(entryFileName.split(QLatin1Char( '/' )));
+    if (existing && replaceExisting) {
+        // The compressed size is not known before the archive is listed again.
+        const QVariant compressedSize = existing->property("compressedSize");
+        existing->copyMetaData(receivedEntry);
+        existing->setProperty("fullPath", entryFileName);
+        if (!receivedEntry->compressedSizeIsSet) {
+            existing->setProperty("compressedSize", compressedSize);
+        }
+        delete receivedEntry;
+
+        if (behaviour == NotifyViews) {
+            const QModelIndex index = indexForEntry(existing);
+            emit dataChanged(index, index.sibling(index.row(), m_showColumns.size() - 1));
+        }
+        return;
+    }
     if (existing) {
         qCDebug(ARK) << "Refreshing entry for" << entryFileName;
 
@@ -654,7 +708,7 @@ void ArchiveModel::newEntry(Archive::Entry *receivedEntry, InsertBehaviour behav
     }
 
     /// 2. Find Parent Entry, creating missing direcotry ArchiveEntries in the process
-    Archive::Entry *parent = parentFor(receivedEntry);
+    Archive::Entry *parent = parentFor(receivedEntry, behaviour);
 
     /// 3. Create an Archive::Entry
     const QStringList path = entryFileName.split(QLatin1Char('/'), QString::SkipEmptyParts);
@@ -731,7 +785,7 @@ KJob* ArchiveModel::setArchive(Kerfuffle::Archive *archive)
     if (m_archive) {
         job = m_archive->list(); // TODO: call "open" or "create"?
         if (job) {
-            connect(job, &Kerfuffle::ListJob::newEntry, this, &ArchiveModel::slotNewEntryFromSetArchive);
+            connect(job, &Kerfuffle::ListJob::newEntries, this, &ArchiveModel::slotNewEntriesFromSetArchive);
             connect(job, &Kerfuffle::ListJob::result, this, &ArchiveModel::slotLoadingFinished);
             connect(job, &Kerfuffle::ListJob::userQuery, this, &ArchiveModel::slotUserQuery);
 
@@ -793,7 +847,7 @@ AddJob* ArchiveModel::addFiles(QList<Archive::Entry*> &entries, const Archive::E
 
     if (!m_archive->isReadOnly()) {
         AddJob *job = m_archive->addFiles(entries, destination, options);
-        connect(job, &AddJob::newEntry, this, &ArchiveModel::slotNewEntry);
+        connect(job, &AddJob::newEntries, this, &ArchiveModel::slotNewEntries);
         connect(job, &AddJob::userQuery, this, &ArchiveModel::slotUserQuery);
 
 
@@ -810,9 +864,9 @@ Kerfuffle::MoveJob *ArchiveModel::moveFiles(QList<Archive::Entry*> &entries, Arc
 
     if (!m_archive->isReadOnly()) {
         MoveJob *job = m_archive->moveFiles(entries, destination, options);
-        connect(job, &MoveJob::newEntry, this, &ArchiveModel::slotNewEntry);
+        connect(job, &MoveJob::newEntries, this, &ArchiveModel::slotNewEntries);
         connect(job, &MoveJob::userQuery, this, &ArchiveModel::slotUserQuery);
-        connect(job, &MoveJob::entryRemoved, this, &ArchiveModel::slotEntryRemoved);
+        connect(job, &MoveJob::entriesRemoved, this, &ArchiveModel::slotEntriesRemoved);
         connect(job, &MoveJob::finished, this, &ArchiveModel::slotCleanupEmptyDirs);
 
 
@@ -828,7 +882,7 @@ Kerfuffle::CopyJob *ArchiveModel::copyFiles(QList<Archive::Entry*> &entries, Arc
 
     if (!m_archive->isReadOnly()) {
         CopyJob *job = m_archive->copyFiles(entries, destination, options);
-        connect(job, &CopyJob::newEntry, this, &ArchiveModel::slotNewEntry);
+        connect(job, &CopyJob::newEntries, this, &ArchiveModel::slotNewEntries);
         connect(job, &CopyJob::userQuery, this, &ArchiveModel::slotUserQuery);
 
 
@@ -842,7 +896,7 @@ DeleteJob* ArchiveModel::deleteFiles(QList<Archive::Entry*> entries)
     Q_ASSERT(m_archive);
     if (!m_archive->isReadOnly()) {
         DeleteJob *job = m_archive->deleteFiles(entries);
-        connect(job, &DeleteJob::entryRemoved, this, &ArchiveModel::slotEntryRemoved);
+        connect(job, &DeleteJob::entriesRemoved, this, &ArchiveModel::slotEntriesRemoved);
 
         connect(job, &DeleteJob::finished, this, &ArchiveModel::slotCleanupEmptyDirs);
 
@@ -950,6 +1004,24 @@ const QHash<QString, QIcon> ArchiveModel::entryIcons() const
     return m_entryIcons;
 }
 
+QList<Archive::Entry*> ArchiveModel::allEntries() const
+{
+    QList<Archive::Entry*> entries;
+    QList<const Archive::Entry*> folders;
+    folders << &m_rootEntry;
+
+    while (!folders.isEmpty()) {
+        foreach (Archive::Entry *entry, folders.takeFirst()->entries()) {
+            entries << entry;
+            if (entry->isDir()) {
+                folders << entry;
+            }
+        }
+    }
+
+    return entries;
+}
+
 void ArchiveModel::slotCleanupEmptyDirs()
 {
     QList<QPersistentModelIndex> queue;
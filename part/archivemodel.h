@@ -107,6 +107,11 @@ public:
 
     const QHash<QString, QIcon> entryIcons() const;
 
+    /**
+     * @return All the entries of the archive, including the contents of the folders.
+     */
+    QList<Archive::Entry*> allEntries() const;
+
     QMap<QString, Kerfuffle::Archive::Entry*> filesToMove;
     QMap<QString, Kerfuffle::Archive::Entry*> filesToCopy;
 
@@ -118,10 +123,11 @@ signals:
     void droppedFiles(const QStringList& files, const Archive::Entry*, const QString&);
 
 private slots:
-    void slotNewEntryFromSetArchive(Archive::Entry *entry);
-    void slotNewEntry(Archive::Entry *entry);
+    void slotNewEntriesFromSetArchive(const QVector<Archive::Entry*> &entries);
+    void slotNewEntries(const QVector<Archive::Entry*> &entries);
     void slotLoadingFinished(KJob *job);
     void slotEntryRemoved(const QString & path);
+    void slotEntriesRemoved(const QStringList &paths);
     void slotUserQuery(Kerfuffle::Query *query);
     void slotCleanupEmptyDirs();
 
@@ -137,7 +143,13 @@ private:
      */
     QString cleanFileName(const QString& fileName);
 
-    Archive::Entry *parentFor(const Kerfuffle::Archive::Entry *entry);
+    enum InsertBehaviour { NotifyViews, DoNotNotifyViews };
+
+    /**
+     * Returns the parent of @p entry, creating the missing directories on the way.
+     * These are inserted according to @p behaviour.
+     */
+    Archive::Entry *parentFor(const Kerfuffle::Archive::Entry *entry, InsertBehaviour behaviour = NotifyViews);
     QModelIndex indexForEntry(Archive::Entry *entry);
     static bool compareAscending(const QModelIndex& a, const QModelIndex& b);
     static bool compareDescending(const QModelIndex& a, const QModelIndex& b);
@@ -145,9 +157,12 @@ private:
      * Insert the node @p node into the model, ensuring all views are notified
      * of the change.
      */
-    enum InsertBehaviour { NotifyViews, DoNotNotifyViews };
     void insertEntry(Archive::Entry *entry, InsertBehaviour behaviour = NotifyViews);
-    void newEntry(Kerfuffle::Archive::Entry *receivedEntry, InsertBehaviour behaviour);
+    /**
+     * Adds @p receivedEntry to the tree. With @p replaceExisting, an entry with the same
+     * path takes its metadata, as written again by an add job, instead of being kept.
+     */
+    void newEntry(Kerfuffle::Archive::Entry *receivedEntry, InsertBehaviour behaviour, bool replaceExisting = false);
 
     QList<Kerfuffle::Archive::Entry*> m_newArchiveEntries; // holds entries from opening a new archive until it's totally open
     QList<int> m_showColumns;
@@ -34,9 +34,16 @@
 #include <QDebug>
 #include <QFile>
 #include <QMimeDatabase>
+#include <QProcess>
+#include <QTimer>
+
+// Size of the chunks passed to the part when streaming an entry.
+static const qint64 streamChunkSize = 64 * 1024;
 
 ArkViewer::ArkViewer()
         : QDialog()
+        , m_streamDevice(Q_NULLPTR)
+        , m_isStreamed(false)
 {
     qCDebug(ARK) << "ArkViewer opened";
 
@@ -76,7 +83,8 @@ void ArkViewer::dialogClosed()
 
         m_part.data()->closeUrl();
 
-        if (!previewedFilePath.isEmpty()) {
+        // A streamed entry was never written to the disk.
+        if (!m_isStreamed && !previewedFilePath.isEmpty()) {
             QFile::remove(previewedFilePath);
         }
     }
@@ -170,7 +178,33 @@ void ArkViewer::view(const QString& fileName)
     QFile::remove(fileName);
 }
 
-bool ArkViewer::viewInInternalViewer(const QString& fileName, const QMimeType &mimeType)
+ArkViewer *ArkViewer::createStreamViewer(const QString& entryName)
+{
+    // The contents are not available yet, so only the name tells the type of the entry.
+    QMimeDatabase db;
+    const QMimeType mimeType = db.mimeTypeForFile(entryName, QMimeDatabase::MatchExtension);
+    qCDebug(ARK) << "streaming" << entryName << "with mime type:" << mimeType.name();
+    const KService::Ptr viewer = ArkViewer::getViewer(mimeType.name());
+
+    // External viewers need a file on disk, and files without a viewer need
+    // to ask the user first, so leave both cases to the temporary file path.
+    if (!viewer || !viewer->hasServiceType(QStringLiteral("KParts/ReadOnlyPart"))) {
+        return Q_NULLPTR;
+    }
+
+    ArkViewer *internalViewer = new ArkViewer();
+    // The window size is restored before the dialog is shown.
+    internalViewer->create();
+    if (!internalViewer->openStreamInInternalViewer(entryName, mimeType)) {
+        qCDebug(ARK) << "The internal viewer does not support streaming";
+        delete internalViewer;
+        return Q_NULLPTR;
+    }
+
+    return internalViewer;
+}
+
+bool ArkViewer::createPart(const QString& fileName, const QMimeType &mimeType)
 {
     setWindowFilePath(fileName);
 
@@ -203,11 +237,106 @@ bool ArkViewer::viewInInternalViewer(const QString& fileName, const QMimeType &m
     // Insert the KPart into its placeholder.
     layout()->replaceWidget(m_partPlaceholder, m_part.data()->widget());
 
+    return true;
+}
+
+bool ArkViewer::viewInInternalViewer(const QString& fileName, const QMimeType &mimeType)
+{
+    if (!createPart(fileName, mimeType)) {
+        return false;
+    }
+
     m_part.data()->openUrl(QUrl::fromLocalFile(fileName));
 
     return true;
 }
 
+bool ArkViewer::openStreamInInternalViewer(const QString& entryName, const QMimeType &mimeType)
+{
+    if (!createPart(entryName, mimeType)) {
+        return false;
+    }
+
+    // Parts which don't reimplement doOpenStream() refuse streams.
+    if (!m_part.data()->openStream(mimeType.name(), QUrl::fromLocalFile(entryName))) {
+        return false;
+    }
+
+    m_isStreamed = true;
+
+    return true;
+}
+
+void ArkViewer::viewStream(QIODevice *device)
+{
+    Q_ASSERT(m_isStreamed);
+
+    show();
+
+    m_streamDevice = device;
+    m_streamDevice->setParent(this);
+
+    // Processes tell us when more output is available, other devices
+    // decode on demand and are read from the event loop.
+    QProcess *process = qobject_cast<QProcess*>(device);
+    if (process) {
+        connect(process, &QProcess::readyRead, this, &ArkViewer::slotStreamData);
+        connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &ArkViewer::slotStreamData);
+    }
+    QTimer::singleShot(0, this, &ArkViewer::slotStreamData);
+}
+
+void ArkViewer::slotStreamData()
+{
+    if (!m_streamDevice || !m_part) {
+        return;
+    }
+
+    QByteArray chunk(streamChunkSize, Qt::Uninitialized);
+    const qint64 readBytes = m_streamDevice->read(chunk.data(), chunk.size());
+    if (readBytes > 0) {
+        chunk.truncate(readBytes);
+        m_part.data()->writeStream(chunk);
+    }
+
+    // A program which fails (wrong password, CRC error, killed...) may have
+    // written part of the entry already, which must not pass for all of it.
+    QProcess *process = qobject_cast<QProcess*>(m_streamDevice);
+    bool isFinished;
+    bool isFailed;
+    if (process) {
+        isFinished = (process->state() == QProcess::NotRunning && process->bytesAvailable() == 0);
+        isFailed = (readBytes < 0) ||
+                   (isFinished && (process->exitStatus() != QProcess::NormalExit || process->exitCode() != 0));
+    } else {
+        isFinished = (readBytes <= 0);
+        isFailed = (readBytes < 0);
+    }
+
+    if (isFailed) {
+        qCWarning(ARK) << "Streaming" << windowFilePath() << "failed:" << m_streamDevice->errorString();
+        m_part.data()->closeStream();
+        m_streamDevice->deleteLater();
+        m_streamDevice = Q_NULLPTR;
+        KMessageBox::error(this, xi18nc("@info", "Ark could not read <filename>%1</filename> from the archive.",
+                                        windowFilePath()));
+        reject();
+        return;
+    }
+
+    if (isFinished) {
+        qCDebug(ARK) << "Finished streaming" << windowFilePath();
+        m_part.data()->closeStream();
+        m_streamDevice->deleteLater();
+        m_streamDevice = Q_NULLPTR;
+        return;
+    }
+
+    if (!process || process->bytesAvailable() > 0) {
+        QTimer::singleShot(0, this, &ArkViewer::slotStreamData);
+    }
+}
+
 KService::Ptr ArkViewer::getViewer(const QString &mimeType)
 {
     // No point in even trying to find anything for application/octet-stream
@@ -41,16 +41,36 @@ public:
 
     static void view(const QString& fileName);
 
+    /**
+     * Creates a hidden internal viewer which can preview the entry named @p entryName
+     * as its contents are being read, without creating a temporary file.
+     *
+     * Returns a null pointer if no internal viewer can read streams of this type of file,
+     * in which case the entry has to be extracted and passed to view(const QString&) instead.
+     */
+    static ArkViewer *createStreamViewer(const QString& entryName);
+
+    /**
+     * Shows the viewer and passes it the contents of @p device as they are read.
+     * The viewer takes ownership of @p device.
+     */
+    void viewStream(QIODevice *device);
+
 private slots:
     void dialogClosed();
+    void slotStreamData();
 
 private:
     explicit ArkViewer();
 
     static KService::Ptr getViewer(const QString& mimeType);
+    bool createPart(const QString& fileName, const QMimeType& mimeType);
     bool viewInInternalViewer(const QString& fileName, const QMimeType& mimeType);
+    bool openStreamInInternalViewer(const QString& entryName, const QMimeType& mimeType);
 
     QPointer<KParts::ReadOnlyPart> m_part;
+    QIODevice *m_streamDevice;
+    bool m_isStreamed;
 };
 
 #endif // ARKVIEWER_H
@@ -35,7 +35,9 @@
 #include "jobtracker.h"
 #include "kerfuffle/extractiondialog.h"
 #include "kerfuffle/extractionsettingspage.h"
+#include "kerfuffle/conflictdecisions.h"
 #include "kerfuffle/jobs.h"
+#include "kerfuffle/queries.h"
 #include "kerfuffle/settings.h"
 #include "kerfuffle/previewsettingspage.h"
 #include "kerfuffle/propertiesdialog.h"
@@ -192,6 +194,7 @@ Part::Part(QWidget *parentWidget, QObject *parent, const QVariantList& args)
 Part::~Part()
 {
     qDeleteAll(m_tmpOpenDirList);
+    delete m_streamViewer;
 
     // Only save splitterSizes if infopanel is visible,
     // because we don't want to store zero size for infopanel.
@@ -276,8 +279,13 @@ void Part::extractSelectedFilesTo(const QString& localPath)
     options[QStringLiteral("RemoveRootNode")] = true;
     options[QStringLiteral("DragAndDrop")] = true;
 
+    const QList<Archive::Entry*> files = filesAndRootNodesForIndexes(addChildren(m_view->selectionModel()->selectedRows()));
+    if (!resolveExtractionConflicts(files, destination, options)) {
+        return;
+    }
+
     // Create and start the ExtractJob.
-    ExtractJob *job = m_model->extractFiles(filesAndRootNodesForIndexes(addChildren(m_view->selectionModel()->selectedRows())), destination, options);
+    ExtractJob *job = m_model->extractFiles(files, destination, options);
     registerJob(job);
     connect(job, &KJob::result,
             this, &Part::slotExtractionDone);
@@ -494,7 +502,10 @@ void Part::updateActions()
     m_testArchiveAction->setEnabled(false);
 
     if (m_model->archive()) {
-        const KPluginMetaData metadata = PluginManager().preferredPluginFor(m_model->archive()->mimeType())->metaData();
+        const PluginManager pluginManager;
+        const Plugin *plugin = m_model->archive()->isReadOnly() ? pluginManager.preferredPluginFor(m_model->archive()->mimeType())
+                                                                : pluginManager.preferredWritePluginFor(m_model->archive()->mimeType());
+        const KPluginMetaData metadata = plugin->metaData();
         bool supportsWriteComment = ArchiveFormat::fromMetadata(m_model->archive()->mimeType(), metadata).supportsWriteComment();
         m_editCommentAction->setEnabled(!isBusy() &&
                                         supportsWriteComment);
@@ -639,6 +650,13 @@ void Part::slotQuickExtractFiles(QAction *triggeredAction)
         Kerfuffle::ExtractionOptions options;
         options[QStringLiteral("PreservePaths")] = true;
         QList<Archive::Entry*> files = filesAndRootNodesForIndexes(m_view->selectionModel()->selectedRows());
+
+        // The selected folders are extracted with their contents.
+        const QList<Archive::Entry*> extractedEntries = files.isEmpty() ? files : filesForIndexes(addChildren(m_view->selectionModel()->selectedRows()));
+        if (!resolveExtractionConflicts(extractedEntries, finalDestinationDirectory, options)) {
+            return;
+        }
+
         ExtractJob *job = m_model->extractFiles(files, finalDestinationDirectory, options);
         registerJob(job);
 
@@ -665,7 +683,9 @@ bool Part::openFile()
     }
 
     const QString fixedMimeType = arguments().metaData()[QStringLiteral("fixedMimeType")];
-    QScopedPointer<Kerfuffle::Archive> archive(Kerfuffle::Archive::create(localFilePath(), fixedMimeType, m_model));
+    // Read-only plugins are only preferred when the archive can't be modified anyway.
+    QScopedPointer<Kerfuffle::Archive> archive(isReadWrite() ? Kerfuffle::Archive::createEditable(localFilePath(), fixedMimeType, m_model)
+                                                             : Kerfuffle::Archive::create(localFilePath(), fixedMimeType, m_model));
     Q_ASSERT(archive);
 
     if (archive->error() == NoPlugin) {
@@ -919,6 +939,19 @@ void Part::slotOpenEntry(int mode)
         KJob *job = Q_NULLPTR;
 
         if (m_openFileMode == Preview) {
+            // Stream the entry into the viewer if its part can read streams, so
+            // that big files are shown without waiting for their extraction.
+            ArkViewer *viewer = ArkViewer::createStreamViewer(entry->name());
+            EntryDeviceJob *deviceJob = viewer ? m_model->archive()->openEntryDevice(entry) : Q_NULLPTR;
+            if (deviceJob) {
+                m_streamViewer = viewer;
+                registerJob(deviceJob);
+                connect(deviceJob, &KJob::result, this, &Part::slotStreamEntry);
+                deviceJob->start();
+                return;
+            }
+            delete viewer;
+
             job = m_model->preview(entry);
             connect(job, &KJob::result, this, &Part::slotPreviewExtractedEntry);
         } else {
@@ -972,6 +1005,28 @@ void Part::slotOpenExtractedEntry(KJob *job)
     setReadyGui();
 }
 
+void Part::slotStreamEntry(KJob *job)
+{
+    EntryDeviceJob *deviceJob = qobject_cast<EntryDeviceJob*>(job);
+    Q_ASSERT(deviceJob);
+
+    QIODevice *device = deviceJob->takeDevice();
+    if (device && m_streamViewer) {
+        m_streamViewer->viewStream(device);
+        m_streamViewer = Q_NULLPTR;
+        return;
+    }
+
+    // The entry cannot be streamed, extract it to a temporary file instead.
+    delete device;
+    delete m_streamViewer;
+
+    KJob *previewJob = m_model->preview(deviceJob->entry());
+    registerJob(previewJob);
+    connect(previewJob, &KJob::result, this, &Part::slotPreviewExtractedEntry);
+    previewJob->start();
+}
+
 void Part::slotPreviewExtractedEntry(KJob *job)
 {
     if (!job->error()) {
@@ -1102,6 +1157,11 @@ void Part::slotShowExtractionDialog()
         options[QStringLiteral("FollowExtractionDialogSettings")] = true;
 
         const QString destinationDirectory = dialog.data()->destinationDirectory().toDisplayString(QUrl::PreferLocalFile);
+        if (!resolveExtractionConflicts(files, destinationDirectory, options)) {
+            delete dialog.data();
+            return;
+        }
+
         ExtractJob *job = m_model->extractFiles(files, destinationDirectory, options);
         registerJob(job);
 
@@ -1135,6 +1195,31 @@ QModelIndexList Part::addChildren(const QModelIndexList &list) const
     return ret;
 }
 
+bool Part::resolveExtractionConflicts(const QList<Archive::Entry*> &files, const QString &destination, Kerfuffle::ExtractionOptions &options) const
+{
+    const QStringList conflicts = ConflictDecisions::findConflicts(files.isEmpty() ? m_model->allEntries() : files,
+                                                                   destination,
+                                                                   options);
+
+    // A single existing file is left to the usual query during the extraction.
+    if (conflicts.size() < 2) {
+        return true;
+    }
+
+    qCDebug(ARK) << conflicts.size() << "files already exist in" << destination;
+
+    BatchOverwriteQuery query(conflicts);
+    query.execute();
+    query.waitForResponse();
+
+    if (query.responseCancelled()) {
+        return false;
+    }
+
+    ConflictDecisions::store(options, query.overwrittenFiles(), query.skippedFiles());
+    return true;
+}
+
 QList<Archive::Entry*> Part::filesForIndexes(const QModelIndexList& list) const
 {
     QList<Archive::Entry*> ret;
@@ -33,8 +33,10 @@
 #include <KMessageWidget>
 
 #include <QModelIndex>
+#include <QPointer>
 
 class ArchiveModel;
+class ArkViewer;
 class ArchiveView;
 class InfoPanel;
 
@@ -99,6 +101,7 @@ private slots:
     void slotLoadingStarted();
     void slotLoadingFinished(KJob *job);
     void slotOpenExtractedEntry(KJob*);
+    void slotStreamEntry(KJob *job);
     void slotPreviewExtractedEntry(KJob* job);
     void slotOpenEntry(int mode);
     void slotError(const QString& errorMessage, const QString& details);
@@ -171,6 +174,16 @@ private:
     QList<Kerfuffle::Archive::Entry*> filesForIndexes(const QModelIndexList& list) const;
     QList<Kerfuffle::Archive::Entry*> filesAndRootNodesForIndexes(const QModelIndexList& list) const;
     QModelIndexList addChildren(const QModelIndexList &list) const;
+
+    /**
+     * Looks for the existing files which the extraction of @p files to @p destination
+     * would overwrite, and asks the user about all of them at once. The decisions are
+     * stored in @p options, so that the extraction is not interrupted for each file.
+     * An empty @p files means the whole archive.
+     *
+     * @return false if the user cancelled the extraction.
+     */
+    bool resolveExtractionConflicts(const QList<Kerfuffle::Archive::Entry*> &files, const QString &destination, Kerfuffle::ExtractionOptions &options) const;
     void registerJob(KJob *job);
     void displayMsgWidget(KMessageWidget::MessageType type, const QString& msg);
 
@@ -213,6 +226,9 @@ private:
     QPlainTextEdit *m_commentView;
     KMessageWidget *m_commentMsgWidget;
     KMessageWidget *m_messageWidget;
+
+    // Hidden viewer waiting for the device of the entry being previewed.
+    QPointer<ArkViewer> m_streamViewer;
 };
 
 } // namespace Ark
@@ -25,6 +25,7 @@
 #include "ark_debug.h"
 #include "kerfuffle/cliinterface.h"
 #include "kerfuffle/kerfuffle_export.h"
+#include "kerfuffle/listingscanner.h"
 
 #include <QDateTime>
 #include <QDir>
@@ -71,17 +72,28 @@ ParameterList CliPlugin::parameterList() const
                                        << QStringLiteral("$PasswordSwitch")
                                        << QStringLiteral("$Archive")
                                        << QStringLiteral("$Files");
+        p[ExtractToStdoutArgs] = QStringList() << QStringLiteral("e")
+                                               << QStringLiteral("-so")
+                                               << QStringLiteral("$PasswordSwitch")
+                                               << QStringLiteral("$Archive")
+                                               << QStringLiteral("$Files");
         p[PreservePathSwitch] = QStringList() << QStringLiteral("x")
                                               << QStringLiteral("e");
         p[PasswordSwitch] = QStringList() << QStringLiteral("-p$Password");
         p[PasswordHeaderSwitch] = QStringList { QStringLiteral("-p$Password"), QStringLiteral("-mhe=on") };
         p[WrongPasswordPatterns] = QStringList() << QStringLiteral("Wrong password");
         p[CompressionLevelSwitch] = QStringLiteral("-mx=$CompressionLevel");
+        p[DictionarySizeSwitch] = QStringLiteral("-md=$DictionarySizek");
+        p[BlockSizeSwitch] = QStringLiteral("-ms=$BlockSizek");
+        p[ThreadsSwitch] = QStringLiteral("-mmt=$Threads");
         p[AddArgs] = QStringList() << QStringLiteral("a")
                                    << QStringLiteral("-l")
                                    << QStringLiteral("$Archive")
                                    << QStringLiteral("$PasswordSwitch")
                                    << QStringLiteral("$CompressionLevelSwitch")
+                                   << QStringLiteral("$DictionarySizeSwitch")
+                                   << QStringLiteral("$BlockSizeSwitch")
+                                   << QStringLiteral("$ThreadsSwitch")
                                    << QStringLiteral("$Files");
         p[MoveArgs] = QStringList() << QStringLiteral("rn")
                                     << QStringLiteral("$PasswordSwitch")
@@ -202,17 +214,16 @@ bool CliPlugin::readListLine(const QString& line)
                 QDir::fromNativeSeparators(line.mid(7).trimmed());
             m_currentArchiveEntry->setProperty("fullPath", entryFilename);
         } else if (line.startsWith(QStringLiteral("Size = "))) {
-            m_currentArchiveEntry->setProperty("size", line.mid(7).trimmed());
+            m_currentArchiveEntry->setProperty("size", ListingScanner::toSize(line.midRef(7)));
         } else if (line.startsWith(QStringLiteral("Packed Size = "))) {
             // #236696: 7z files only show a single Packed Size value
             //          corresponding to the whole archive.
             if (m_archiveType != ArchiveType7z) {
                 m_currentArchiveEntry->compressedSizeIsSet = true;
-                m_currentArchiveEntry->setProperty("compressedSize", line.mid(14).trimmed());
+                m_currentArchiveEntry->setProperty("compressedSize", ListingScanner::toSize(line.midRef(14)));
             }
         } else if (line.startsWith(QStringLiteral("Modified = "))) {
-            m_currentArchiveEntry->setProperty("timestamp", QDateTime::fromString(line.mid(11).trimmed(),
-                                                                                  QStringLiteral("yyyy-MM-dd hh:mm:ss")));
+            m_currentArchiveEntry->setProperty("timestamp", ListingScanner::toDateTime(line.midRef(11)));
         } else if (line.startsWith(QStringLiteral("Attributes = "))) {
             const QString attributes = line.mid(13).trimmed();
 
@@ -240,6 +251,14 @@ bool CliPlugin::readListLine(const QString& line)
                    line.startsWith(QStringLiteral("Version = "))) {
             m_isFirstInformationEntry = true;
             if (!m_currentArchiveEntry->fullPath().isEmpty()) {
+                // Directories and empty files are in no block.
+                if (m_archiveType == ArchiveType7z && line.startsWith(QStringLiteral("Block = "))) {
+                    bool isInBlock = false;
+                    const int block = line.midRef(8).trimmed().toInt(&isInBlock);
+                    if (isInBlock) {
+                        setSolidBlock(m_currentArchiveEntry, block);
+                    }
+                }
                 emit entry(m_currentArchiveEntry);
             }
             else {
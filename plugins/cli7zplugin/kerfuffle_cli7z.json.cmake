@@ -46,6 +46,11 @@
         "CompressionLevelDefault": 5,
         "CompressionLevelMax": 9,
         "CompressionLevelMin": 0,
+        "DictionarySizeMin": 64,
+        "DictionarySizeMax": 1048576,
+        "BlockSizeMin": 1024,
+        "BlockSizeMax": 4194304,
+        "SupportsThreads": true,
         "SupportsTesting": true,
         "HeaderEncryption": true
     },
@@ -53,6 +58,7 @@
         "CompressionLevelDefault": 5,
         "CompressionLevelMax": 9,
         "CompressionLevelMin": 0,
+        "SupportsThreads": true,
         "SupportsTesting": true,
         "Encryption": true
     }
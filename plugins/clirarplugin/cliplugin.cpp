@@ -24,6 +24,7 @@
 #include "cliplugin.h"
 #include "ark_debug.h"
 #include "kerfuffle/archiveentry.h"
+#include "kerfuffle/listingscanner.h"
 
 #include <QDateTime>
 
@@ -58,6 +59,7 @@ void CliPlugin::resetParsing()
     m_parseState = ParseStateTitle;
     m_remainingIgnoreLines = 1;
     m_comment.clear();
+    m_isSolid = false;
 }
 
 ParameterList CliPlugin::parameterList() const
@@ -79,11 +81,20 @@ ParameterList CliPlugin::parameterList() const
                                        << QStringLiteral( "$PasswordSwitch" )
                                        << QStringLiteral( "$Archive" )
                                        << QStringLiteral( "$Files" );
+        p[ExtractToStdoutArgs] = QStringList() << QStringLiteral( "p" )
+                                               << QStringLiteral( "-inul" )
+                                               << QStringLiteral( "-kb" )
+                                               << QStringLiteral( "-p-" )
+                                               << QStringLiteral( "$PasswordSwitch" )
+                                               << QStringLiteral( "$Archive" )
+                                               << QStringLiteral( "$Files" );
         p[PreservePathSwitch] = QStringList() << QStringLiteral( "x" )
                                               << QStringLiteral( "e" );
         p[PasswordSwitch] = QStringList() << QStringLiteral( "-p$Password" );
         p[PasswordHeaderSwitch] = QStringList() << QStringLiteral("-hp$Password");
         p[CompressionLevelSwitch] = QStringLiteral("-m$CompressionLevel");
+        p[DictionarySizeSwitch] = QStringLiteral("-md$DictionarySizek");
+        p[ThreadsSwitch] = QStringLiteral("-mt$Threads");
         p[DeleteArgs] = QStringList() << QStringLiteral( "d" )
                                       << QStringLiteral( "$PasswordSwitch" )
                                       << QStringLiteral( "$Archive" )
@@ -101,6 +112,8 @@ ParameterList CliPlugin::parameterList() const
                                    << QStringLiteral( "$Archive" )
                                    << QStringLiteral("$PasswordSwitch")
                                    << QStringLiteral("$CompressionLevelSwitch")
+                                   << QStringLiteral("$DictionarySizeSwitch")
+                                   << QStringLiteral("$ThreadsSwitch")
                                    << QStringLiteral( "$Files" );
         p[MoveArgs] = QStringList() << QStringLiteral( "rn" )
                                     << QStringLiteral( "$PasswordSwitch" )
@@ -249,9 +262,7 @@ void CliPlugin::handleUnrar5Entry() {
     compressionRatio.chop(1); // Remove the '%'
     e->setProperty("ratio", compressionRatio);
 
-    QString time = m_unrar5Details.value(QStringLiteral("mtime"));
-    QDateTime ts = QDateTime::fromString(time, QStringLiteral("yyyy-MM-dd HH:mm:ss,zzz"));
-    e->setProperty("timestamp", ts);
+    e->setProperty("timestamp", ListingScanner::toDateTime(m_unrar5Details.value(QStringLiteral("mtime"))));
 
     bool isDirectory = (m_unrar5Details.value(QStringLiteral("type")) == QLatin1String("Directory"));
     e->setProperty("isDirectory", isDirectory);
@@ -275,8 +286,8 @@ void CliPlugin::handleUnrar5Entry() {
     e->setProperty("isPasswordProtected", m_isPasswordProtected);
 
     e->setProperty("fullPath", m_unrar5Details.value(QStringLiteral("name")));
-    e->setProperty("size", m_unrar5Details.value(QStringLiteral("size")));
-    e->setProperty("compressedSize", m_unrar5Details.value(QStringLiteral("packed size")));
+    e->setProperty("size", ListingScanner::toSize(m_unrar5Details.value(QStringLiteral("size"))));
+    e->setProperty("compressedSize", ListingScanner::toSize(m_unrar5Details.value(QStringLiteral("packed size"))));
     e->setProperty("permissions", m_unrar5Details.value(QStringLiteral("attributes")));
     e->setProperty("CRC", m_unrar5Details.value(QStringLiteral("crc32")));
 
@@ -284,6 +295,11 @@ void CliPlugin::handleUnrar5Entry() {
         e->setProperty("link", m_unrar5Details.value(QStringLiteral("target")));
     }
 
+    // A solid rar archive is a single stream, unrar decompresses it from the start.
+    if (!isDirectory && (m_isSolid || m_unrar5Details.value(QStringLiteral("flags")).contains(QLatin1String("solid")))) {
+        setSolidBlock(e, 0);
+    }
+
     m_unrar5Details.clear();
     emit entry(e);
 }
@@ -447,14 +463,9 @@ void CliPlugin::handleUnrar4Entry() {
 
     Archive::Entry *e = new Archive::Entry(Q_NULLPTR);
 
-    QDateTime ts = QDateTime::fromString(QString(m_unrar4Details.at(4) + QLatin1Char(' ') + m_unrar4Details.at(5)),
-                                         QStringLiteral("dd-MM-yy hh:mm"));
-    // Unrar 3 & 4 output dates with a 2-digit year but QDateTime takes it as
-    // 19??. Let's take 1950 as cut-off; similar to KDateTime.
-    if (ts.date().year() < 1950) {
-        ts = ts.addYears(100);
-    }
-    e->setProperty("timestamp", ts);
+    // Unrar 3 & 4 output dates with a 2-digit year.
+    e->setProperty("timestamp", ListingScanner::toShortDateTime(QStringRef(&m_unrar4Details.at(4)),
+                                                                QStringRef(&m_unrar4Details.at(5))));
 
     bool isDirectory = ((m_unrar4Details.at(6).at(0) == QLatin1Char('d')) ||
                         (m_unrar4Details.at(6).at(1) == QLatin1Char('D')));
@@ -483,8 +494,8 @@ void CliPlugin::handleUnrar4Entry() {
     // - Permissions differ depending on the system the entry was added
     //   to the archive.
     e->setProperty("fullPath", m_unrar4Details.at(0));
-    e->setProperty("size", m_unrar4Details.at(1));
-    e->setProperty("compressedSize", m_unrar4Details.at(2));
+    e->setProperty("size", ListingScanner::toSize(m_unrar4Details.at(1)));
+    e->setProperty("compressedSize", ListingScanner::toSize(m_unrar4Details.at(2)));
     e->setProperty("permissions", m_unrar4Details.at(6));
     e->setProperty("CRC", m_unrar4Details.at(7));
     e->setProperty("method", m_unrar4Details.at(8));
@@ -495,6 +506,11 @@ void CliPlugin::handleUnrar4Entry() {
         e->setProperty("link", m_unrar4Details.at(10));
     }
 
+    // A solid rar archive is a single stream, unrar decompresses it from the start.
+    if (m_isSolid && !isDirectory) {
+        setSolidBlock(e, 0);
+    }
+
     m_unrar4Details.clear();
     emit entry(e);
 }
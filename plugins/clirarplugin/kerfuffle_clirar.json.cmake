@@ -49,6 +49,9 @@
         "CompressionLevelDefault": 3,
         "CompressionLevelMax": 5,
         "CompressionLevelMin": 0,
+        "DictionarySizeMin": 128,
+        "DictionarySizeMax": 1048576,
+        "SupportsThreads": true,
         "SupportsWriteComment": true,
         "SupportsTesting": true,
         "HeaderEncryption": true
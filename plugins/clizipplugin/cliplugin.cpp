@@ -25,6 +25,7 @@
 #include "kerfuffle/cliinterface.h"
 #include "kerfuffle/kerfuffle_export.h"
 #include "kerfuffle/archiveentry.h"
+#include "kerfuffle/listingscanner.h"
 
 #include <KPluginFactory>
 
@@ -170,16 +171,14 @@ bool CliPlugin::readListLine(const QString &line)
             //          ending with '/' is actually more reliable than 'd' bein in the attributes.
             e->setProperty("isDirectory", rxMatch.captured(10).endsWith(QLatin1Char('/')));
 
-            e->setProperty("size", rxMatch.captured(4));
+            e->setProperty("size", ListingScanner::toSize(rxMatch.capturedRef(4)));
             QString status = rxMatch.captured(5);
             if (status[0].isUpper()) {
                 e->setProperty("isPasswordProtected", true);
             }
-            e->setProperty("compressedSize", rxMatch.captured(6).toInt());
+            e->setProperty("compressedSize", ListingScanner::toSize(rxMatch.capturedRef(6)));
 
-            const QDateTime ts(QDate::fromString(rxMatch.captured(8), QStringLiteral("yyyyMMdd")),
-                               QTime::fromString(rxMatch.captured(9), QStringLiteral("hhmmss")));
-            e->setProperty("timestamp", ts);
+            e->setProperty("timestamp", ListingScanner::toCompactDateTime(rxMatch.capturedRef(8), rxMatch.capturedRef(9)));
 
             e->setProperty("fullPath", rxMatch.captured(10));
             emit entry(e);
@@ -192,10 +191,8 @@ bool CliPlugin::readListLine(const QString &line)
 
 bool CliPlugin::moveFiles(const QList<Archive::Entry*> &files, Archive::Entry *destination, const CompressionOptions &options)
 {
-    m_oldWorkingDir = QDir::currentPath();
     m_tempExtractDir = new QTemporaryDir();
     m_tempAddDir = new QTemporaryDir();
-    QDir::setCurrent(m_tempExtractDir->path());
     m_passedFiles = files;
     m_passedDestination = destination;
     m_passedOptions = options;
@@ -203,7 +200,7 @@ bool CliPlugin::moveFiles(const QList<Archive::Entry*> &files, Archive::Entry *d
     m_subOperation = Extract;
     connect(this, &CliPlugin::finished, this, &CliPlugin::continueMoving);
 
-    return extractFiles(files, QDir::currentPath(), options);
+    return extractFiles(files, m_tempExtractDir->path(), options);
 }
 
 int CliPlugin::moveRequiredSignals() const {
@@ -250,7 +247,7 @@ bool CliPlugin::setMovingAddedFiles()
         return setAddedFiles();
     }
 
-    QDir::setCurrent(m_tempAddDir->path());
+    m_passedOptions[QStringLiteral("GlobalWorkDir")] = m_tempAddDir->path();
     const Archive::Entry *file = m_passedFiles.at(0);
     const QString oldPath = m_tempExtractDir->path() + QLatin1Char('/') + file->fullPath(true);
     const QString newPath = m_tempAddDir->path() + QLatin1Char('/') + m_passedDestination->name();
@@ -46,6 +46,13 @@
         "CompressionLevelMax": 9,
         "CompressionLevelMin": 1
     },
+    "application/x-lz4-compressed-tar": {
+        "CompressionLevelDefault": 1,
+        "CompressionLevelMax": 9,
+        "CompressionLevelMin": 1,
+        "BlockSizeMin": 64,
+        "BlockSizeMax": 4096
+    },
     "application/x-lrzip-compressed-tar": {
         "CompressionLevelDefault": 1,
         "CompressionLevelMax": 9,
@@ -69,6 +76,14 @@
     "application/x-xz-compressed-tar": {
         "CompressionLevelDefault": 6,
         "CompressionLevelMax": 9,
-        "CompressionLevelMin": 0
+        "CompressionLevelMin": 0,
+        "SupportsThreads": true
+    },
+    "application/x-zstd-compressed-tar": {
+        "CompressionLevelDefault": 3,
+        "CompressionLevelMax": 19,
+        "CompressionLevelMin": 1,
+        "SupportsThreads": true,
+        "SupportsLongDistanceMatching": true
     }
 }
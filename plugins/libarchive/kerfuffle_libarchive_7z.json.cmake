@@ -0,0 +1,15 @@
+{
+    "KPlugin": {
+        "Id": "kerfuffle_libarchive_7z",
+        "MimeTypes": [
+            "application/x-7z-compressed"
+        ],
+        "Name": "kerfuffle_libarchive_7z",
+        "ServiceTypes": [
+            "Kerfuffle/Plugin"
+        ],
+        "Version": "@KDE_APPLICATIONS_VERSION@"
+    },
+    "X-KDE-Kerfuffle-ReadWrite": false,
+    "X-KDE-Priority": 190
+}
@@ -0,0 +1,15 @@
+{
+    "KPlugin": {
+        "Id": "kerfuffle_libarchive_zip",
+        "MimeTypes": [
+            "@SUPPORTED_ZIP_MIMETYPES@"
+        ],
+        "Name": "kerfuffle_libarchive_zip",
+        "ServiceTypes": [
+            "Kerfuffle/Plugin"
+        ],
+        "Version": "@KDE_APPLICATIONS_VERSION@"
+    },
+    "X-KDE-Kerfuffle-ReadWrite": false,
+    "X-KDE-Priority": 185
+}
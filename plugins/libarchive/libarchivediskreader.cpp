@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "libarchivediskreader.h"
+
+#include <archive.h>
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#include <cstdint>
+
+#include <grp.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// archive_read_disk_set_standard_lookup() gives every reader its own small cache,
+// while every batch has its own reader, so the names are cached once per process.
+struct NameCache
+{
+    QMutex mutex;
+    QHash<qint64, QByteArray> userNames;
+    QHash<qint64, QByteArray> groupNames;
+};
+
+Q_GLOBAL_STATIC(NameCache, s_nameCache)
+
+static const char *lookupUserName(void *, int64_t uid)
+{
+    QMutexLocker locker(&s_nameCache->mutex);
+
+    QHash<qint64, QByteArray>::const_iterator it = s_nameCache->userNames.constFind(uid);
+    if (it == s_nameCache->userNames.constEnd()) {
+        QByteArray buffer(16384, Qt::Uninitialized);
+        struct passwd pwd;
+        struct passwd *result = Q_NULLPTR;
+        getpwuid_r(uid_t(uid), &pwd, buffer.data(), buffer.size(), &result);
+        it = s_nameCache->userNames.insert(uid, result ? QByteArray(result->pw_name) : QByteArray());
+    }
+
+    return it->isEmpty() ? Q_NULLPTR : it->constData();
+}
+
+static const char *lookupGroupName(void *, int64_t gid)
+{
+    QMutexLocker locker(&s_nameCache->mutex);
+
+    QHash<qint64, QByteArray>::const_iterator it = s_nameCache->groupNames.constFind(gid);
+    if (it == s_nameCache->groupNames.constEnd()) {
+        QByteArray buffer(16384, Qt::Uninitialized);
+        struct group grp;
+        struct group *result = Q_NULLPTR;
+        getgrgid_r(gid_t(gid), &grp, buffer.data(), buffer.size(), &result);
+        it = s_nameCache->groupNames.insert(gid, result ? QByteArray(result->gr_name) : QByteArray());
+    }
+
+    return it->isEmpty() ? Q_NULLPTR : it->constData();
+}
+
+// Calls visit() with every path of the walk, until it returns false.
+template<typename Visitor>
+static bool walkDirectory(const QString &absolutePath, const QDir &workDir, Visitor &visit)
+{
+    const QFileInfoList infos = QDir(absolutePath).entryInfoList(QDir::AllEntries | QDir::Readable |
+                                                                 QDir::Hidden | QDir::NoDotAndDotDot,
+                                                                 QDir::Name);
+    foreach (const QFileInfo &info, infos) {
+        QString path = workDir.relativeFilePath(info.absoluteFilePath());
+        const bool isDirectory = info.isDir() && !info.isSymLink();
+        if (isDirectory) {
+            path.append(QLatin1Char('/'));
+        }
+
+        if (!visit(path) || (isDirectory && !walkDirectory(info.absoluteFilePath(), workDir, visit))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<typename Visitor>
+static void walkTree(const QStringList &paths, const QDir &workDir, Visitor visit)
+{
+    foreach (const QString &path, paths) {
+        if (!visit(path)) {
+            return;
+        }
+
+        const QFileInfo info(workDir, path);
+        if (info.isDir() && !walkDirectory(info.absoluteFilePath(), workDir, visit)) {
+            return;
+        }
+    }
+}
+
+LibarchiveDiskReader::LibarchiveDiskReader(const QDir &workDir, const QStringList &paths, bool hashContent,
+                                           const bool *abortOperation)
+    : m_workDir(workDir)
+    , m_paths(paths)
+    , m_hashContent(hashContent)
+    , m_abortOperation(abortOperation)
+    , m_maxPendingBatches(2 * qMax(1, QThread::idealThreadCount()))
+    , m_isWalkFinished(false)
+    , m_isStopped(false)
+{
+    m_walkerPool.setMaxThreadCount(1);
+    m_walker = QtConcurrent::run(&m_walkerPool, this, &LibarchiveDiskReader::walkPaths);
+}
+
+LibarchiveDiskReader::~LibarchiveDiskReader()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_isStopped = true;
+        m_walkedPathsChanged.wakeAll();
+    }
+    m_walker.waitForFinished();
+
+    // The batches still being read don't use this object, but are not left behind.
+    while (!m_pendingBatches.isEmpty()) {
+        m_pendingBatches.dequeue().waitForFinished();
+    }
+}
+
+QStringList LibarchiveDiskReader::walk(const QStringList &paths, const QDir &workDir)
+{
+    QStringList result;
+    walkTree(paths, workDir, [&result](const QString &path) {
+        result.append(path);
+        return true;
+    });
+
+    return result;
+}
+
+void LibarchiveDiskReader::walkPaths()
+{
+    walkTree(m_paths, m_workDir, [this](const QString &path) {
+        return pushWalkedPath(path);
+    });
+
+    QMutexLocker locker(&m_mutex);
+    m_isWalkFinished = true;
+    m_walkedPathsChanged.wakeAll();
+}
+
+bool LibarchiveDiskReader::pushWalkedPath(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_isStopped && m_walkedPaths.size() >= WalkedPathsLimit) {
+        m_walkedPathsChanged.wait(&m_mutex);
+    }
+    if (m_isStopped || (m_abortOperation && *m_abortOperation)) {
+        return false;
+    }
+
+    m_walkedPaths.enqueue(path);
+    m_walkedPathsChanged.wakeAll();
+
+    return true;
+}
+
+bool LibarchiveDiskReader::atEnd() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pendingBatches.isEmpty() && m_walkedPaths.isEmpty() && m_isWalkFinished;
+}
+
+QVector<LibarchiveDiskReader::Entry> LibarchiveDiskReader::next()
+{
+    schedule(true);
+
+    if (m_pendingBatches.isEmpty()) {
+        return QVector<Entry>();
+    }
+
+    const QVector<Entry> batch = m_pendingBatches.dequeue().result();
+    schedule(false);
+
+    return batch;
+}
+
+void LibarchiveDiskReader::schedule(bool waitForPaths)
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (m_pendingBatches.size() < m_maxPendingBatches) {
+        // Only full batches are read until the end of the walk, and nothing is
+        // waited for while there is already a batch to give.
+        if (waitForPaths && m_pendingBatches.isEmpty()) {
+            while (m_walkedPaths.size() < BatchSize && !m_isWalkFinished) {
+                m_walkedPathsChanged.wait(&m_mutex);
+            }
+        }
+        if (m_walkedPaths.isEmpty() || (m_walkedPaths.size() < BatchSize && !m_isWalkFinished)) {
+            break;
+        }
+
+        QStringList paths;
+        while (paths.size() < BatchSize && !m_walkedPaths.isEmpty()) {
+            paths.append(m_walkedPaths.dequeue());
+        }
+        m_pendingBatches.enqueue(QtConcurrent::run(&LibarchiveDiskReader::readBatch, m_workDir,
+                                                   paths, m_hashContent));
+    }
+
+    m_walkedPathsChanged.wakeAll();
+}
+
+QVector<LibarchiveDiskReader::Entry> LibarchiveDiskReader::readBatch(const QDir &workDir, const QStringList &paths, bool hashContent)
+{
+    // Libarchive objects can't be shared between threads.
+    struct archive *readDisk = archive_read_disk_new();
+    archive_read_disk_set_uname_lookup(readDisk, Q_NULLPTR, lookupUserName, Q_NULLPTR);
+    archive_read_disk_set_gname_lookup(readDisk, Q_NULLPTR, lookupGroupName, Q_NULLPTR);
+
+    QVector<Entry> entries;
+    entries.reserve(paths.size());
+
+    foreach (const QString &path, paths) {
+        Entry file;
+        file.path = path;
+        file.absolutePath = QFileInfo(workDir, path).absoluteFilePath();
+        file.isDataRead = false;
+
+        // #253059: Even if we use archive_read_disk_entry_from_file,
+        //          libarchive may have been compiled without HAVE_LSTAT,
+        //          or something may have caused it to follow symlinks, in
+        //          which case stat() will be called. To avoid this, we
+        //          call lstat() ourselves.
+        const QByteArray encodedPath = QFile::encodeName(file.absolutePath);
+        struct stat st;
+        const bool isStated = (lstat(encodedPath.constData(), &st) == 0);
+
+        file.entry = QSharedPointer<struct archive_entry>(archive_entry_new(), archive_entry_free);
+        archive_entry_copy_sourcepath(file.entry.data(), encodedPath.constData());
+        archive_read_disk_entry_from_file(readDisk, file.entry.data(), -1, isStated ? &st : Q_NULLPTR);
+
+        // The holes of sparse files are not read, see LibarchivePlugin::copyData().
+        if (isStated && S_ISREG(st.st_mode) && st.st_size <= PrefetchSizeLimit &&
+            archive_entry_sparse_count(file.entry.data()) == 0) {
+            QFile data(file.absolutePath);
+            if (data.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+                file.data = data.readAll();
+                file.isDataRead = (file.data.size() == st.st_size);
+            }
+            // The file is changing, so it is read again while being written.
+            if (!file.isDataRead) {
+                file.data.clear();
+            }
+        }
+
+        // Md5 is only used to find the candidates, the writer compares their content.
+        if (hashContent && isStated && S_ISREG(st.st_mode) && st.st_size > 0) {
+            if (file.isDataRead) {
+                file.contentHash = QCryptographicHash::hash(file.data, QCryptographicHash::Md5);
+            } else {
+                QFile data(file.absolutePath);
+                QCryptographicHash hash(QCryptographicHash::Md5);
+                if (data.open(QIODevice::ReadOnly) && hash.addData(&data)) {
+                    file.contentHash = hash.result();
+                }
+            }
+        }
+
+        entries.append(file);
+    }
+
+    archive_read_free(readDisk);
+
+    return entries;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBARCHIVEDISKREADER_H
+#define LIBARCHIVEDISKREADER_H
+
+#include <archive_entry.h>
+
+#include <QByteArray>
+#include <QDir>
+#include <QFuture>
+#include <QMutex>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+
+/**
+ * Reads the files to be added to an archive ahead of the archive writer.
+ *
+ * The directories are walked by a thread of their own, which hands the paths
+ * over through a bounded queue as soon as they are listed. The files are then
+ * read in batches by the global thread pool: their metadata is read with
+ * archive_read_disk_entry_from_file() and the content of the small ones is
+ * loaded in memory. The batches are given back in the order of the walk, so
+ * the archive written is the same whatever the number of threads.
+ */
+class LibarchiveDiskReader
+{
+public:
+    struct Entry
+    {
+        /**
+         * The path relative to the work dir, ending with a slash for directories.
+         */
+        QString path;
+        QString absolutePath;
+        QSharedPointer<struct archive_entry> entry;
+
+        /**
+         * The content of the file if isDataRead, otherwise it has to be read from absolutePath.
+         */
+        QByteArray data;
+        bool isDataRead;
+
+        /**
+         * The hash of the content of regular files, if requested.
+         */
+        QByteArray contentHash;
+    };
+
+    static const int BatchSize = 32;
+    static const int PrefetchSizeLimit = 64 * 1024;
+    static const int WalkedPathsLimit = 4096;
+
+    /**
+     * Starts walking @p paths, relative to @p workDir, and reading the files found.
+     * With @p hashContent, the content of the regular files is hashed as well.
+     * The walk stops as soon as @p abortOperation, if given, is set.
+     */
+    LibarchiveDiskReader(const QDir &workDir, const QStringList &paths, bool hashContent = false,
+                         const bool *abortOperation = Q_NULLPTR);
+    ~LibarchiveDiskReader();
+
+    /**
+     * @return @p paths followed, for each directory, by all its content in depth-first
+     * order, sorted by name. This is the order in which the entries are read.
+     */
+    static QStringList walk(const QStringList &paths, const QDir &workDir);
+
+    /**
+     * @return Whether the walk is over and all the batches have been given.
+     */
+    bool atEnd() const;
+
+    /**
+     * Waits for the next batch of entries to be read.
+     */
+    QVector<Entry> next();
+
+private:
+    static QVector<Entry> readBatch(const QDir &workDir, const QStringList &paths, bool hashContent);
+    void walkPaths();
+    bool pushWalkedPath(const QString &path);
+    void schedule(bool waitForPaths);
+
+    QDir m_workDir;
+    QStringList m_paths;
+    bool m_hashContent;
+    const bool *m_abortOperation;
+    int m_maxPendingBatches;
+    QQueue<QFuture<QVector<Entry> > > m_pendingBatches;
+
+    // The walk doesn't take a thread from the global pool, which reads the batches.
+    QThreadPool m_walkerPool;
+    QFuture<void> m_walker;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_walkedPathsChanged;
+    QQueue<QString> m_walkedPaths;
+    bool m_isWalkFinished;
+    bool m_isStopped;
+};
+
+#endif // LIBARCHIVEDISKREADER_H
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "libarchiveentrydevice.h"
+#include "ark_debug.h"
+
+#include <archive_entry.h>
+
+#include <QDir>
+#include <QFile>
+
+LibarchiveEntryDevice::LibarchiveEntryDevice(const QString &archiveFileName, const QString &entryPath, QObject *parent)
+    : QIODevice(parent)
+    , m_archiveFileName(archiveFileName)
+    , m_entryPath(entryPath)
+    , m_reader(Q_NULLPTR)
+    , m_size(0)
+    , m_finished(false)
+{
+}
+
+LibarchiveEntryDevice::~LibarchiveEntryDevice()
+{
+    close();
+}
+
+bool LibarchiveEntryDevice::open(OpenMode mode)
+{
+    if (mode != ReadOnly) {
+        setErrorString(QStringLiteral("The device can only be opened for reading."));
+        return false;
+    }
+
+    QString hardlinkTarget;
+    bool isFound = findEntry(m_entryPath, hardlinkTarget);
+
+    // A hardlink has no data of its own, the data of its target, which is
+    // stored before it, is read instead.
+    if (isFound && !hardlinkTarget.isEmpty()) {
+        QString targetHardlink;
+        isFound = findEntry(hardlinkTarget, targetHardlink);
+    }
+
+    if (!isFound) {
+        close();
+        return false;
+    }
+
+    m_finished = false;
+    return QIODevice::open(mode);
+}
+
+bool LibarchiveEntryDevice::findEntry(const QString &entryPath, QString &hardlinkTarget)
+{
+    if (m_reader) {
+        archive_read_free(m_reader);
+    }
+
+    m_reader = archive_read_new();
+    if (!m_reader) {
+        return false;
+    }
+
+    if (!openArchive(m_reader)) {
+        setErrorString(QLatin1String(archive_error_string(m_reader)));
+        return false;
+    }
+
+    // Skip the headers (and the data) of all the entries preceding the one to be read.
+    struct archive_entry *entry;
+    while (archive_read_next_header(m_reader, &entry) == ARCHIVE_OK) {
+        const QString entryName = QDir::fromNativeSeparators(QFile::decodeName(archive_entry_pathname(entry)));
+        if (entryName == entryPath) {
+            m_size = archive_entry_size(entry);
+            if (archive_entry_hardlink(entry) && m_size == 0) {
+                hardlinkTarget = QDir::fromNativeSeparators(QFile::decodeName(archive_entry_hardlink(entry)));
+            }
+            return true;
+        }
+        archive_read_data_skip(m_reader);
+    }
+
+    qCWarning(ARK) << "Could not find" << entryPath << "in" << m_archiveFileName;
+    setErrorString(QStringLiteral("The entry could not be found in the archive."));
+    return false;
+}
+
+bool LibarchiveEntryDevice::openArchive(struct archive *reader)
+{
+    m_fileReader.reset(new LibarchiveFileReader(m_archiveFileName));
+    return archive_read_support_filter_all(reader) == ARCHIVE_OK &&
+           archive_read_support_format_all(reader) == ARCHIVE_OK &&
+           m_fileReader->open(reader);
+}
+
+void LibarchiveEntryDevice::close()
+{
+    if (m_reader) {
+        archive_read_free(m_reader);
+        m_reader = Q_NULLPTR;
+    }
+    m_finished = true;
+
+    if (isOpen()) {
+        QIODevice::close();
+    }
+}
+
+bool LibarchiveEntryDevice::isSequential() const
+{
+    return true;
+}
+
+bool LibarchiveEntryDevice::atEnd() const
+{
+    return m_finished && QIODevice::atEnd();
+}
+
+qint64 LibarchiveEntryDevice::size() const
+{
+    return m_size;
+}
+
+qint64 LibarchiveEntryDevice::readData(char *data, qint64 maxSize)
+{
+    if (m_finished || !m_reader) {
+        return 0;
+    }
+
+    const qint64 readBytes = archive_read_data(m_reader, data, maxSize);
+    if (readBytes < 0) {
+        qCWarning(ARK) << "Error while reading" << m_entryPath << ":" << archive_error_string(m_reader);
+        setErrorString(QLatin1String(archive_error_string(m_reader)));
+        m_finished = true;
+        return -1;
+    }
+
+    if (readBytes == 0) {
+        m_finished = true;
+    }
+
+    return readBytes;
+}
+
+qint64 LibarchiveEntryDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBARCHIVEENTRYDEVICE_H
+#define LIBARCHIVEENTRYDEVICE_H
+
+#include "libarchivefilereader.h"
+
+#include <archive.h>
+
+#include <QIODevice>
+#include <QScopedPointer>
+
+/**
+ * Sequential device decoding a single archive entry with its own libarchive reader.
+ *
+ * The reader is positioned on the entry when the device is opened and the data is
+ * decompressed only as it is read, so nothing is written to the disk.
+ */
+class LibarchiveEntryDevice : public QIODevice
+{
+public:
+    LibarchiveEntryDevice(const QString &archiveFileName, const QString &entryPath, QObject *parent = Q_NULLPTR);
+    virtual ~LibarchiveEntryDevice();
+
+    virtual bool open(OpenMode mode) Q_DECL_OVERRIDE;
+    virtual void close() Q_DECL_OVERRIDE;
+    virtual bool isSequential() const Q_DECL_OVERRIDE;
+    virtual bool atEnd() const Q_DECL_OVERRIDE;
+    virtual qint64 size() const Q_DECL_OVERRIDE;
+
+protected:
+    /**
+     * Opens @p reader on the archive. By default all the formats and filters are
+     * supported and the entries preceding the one to be read are skipped.
+     */
+    virtual bool openArchive(struct archive *reader);
+
+    virtual qint64 readData(char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+    virtual qint64 writeData(const char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+
+private:
+    /**
+     * Positions a new reader on @p entryPath. If the entry is a hardlink without
+     * data, its target is set in @p hardlinkTarget.
+     */
+    bool findEntry(const QString &entryPath, QString &hardlinkTarget);
+
+    QString m_archiveFileName;
+    QString m_entryPath;
+    QScopedPointer<LibarchiveFileReader> m_fileReader;
+    struct archive *m_reader;
+    qint64 m_size;
+    bool m_finished;
+};
+
+#endif // LIBARCHIVEENTRYDEVICE_H
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "libarchiveentryselection.h"
+
+#include <QFile>
+
+LibarchiveEntrySelection::LibarchiveEntrySelection(const QStringList &paths, bool matchFolderContents)
+    : m_remaining(0)
+{
+    setPaths(paths, matchFolderContents);
+}
+
+void LibarchiveEntrySelection::setPaths(const QStringList &paths, bool matchFolderContents)
+{
+    m_paths.clear();
+    m_folders.clear();
+    m_paths.reserve(paths.size());
+    m_taken.fill(false, paths.size());
+    m_remaining = 0;
+
+    QSet<QByteArray> parents;
+    for (int i = 0; i < paths.size(); ++i) {
+        const QByteArray path = QFile::encodeName(paths.at(i));
+        if (m_paths.contains(path)) {
+            continue;
+        }
+        m_paths.insert(path, i);
+        ++m_remaining;
+
+        if (!matchFolderContents) {
+            continue;
+        }
+
+        if (path.endsWith('/')) {
+            m_folders.insert(path, i);
+        }
+
+        // Remember every parent folder of the path, they are not matched by prefix.
+        int slash = path.lastIndexOf('/', path.size() - 2);
+        while (slash > 0) {
+            const QByteArray parent = path.left(slash + 1);
+            if (parents.contains(parent)) {
+                break;
+            }
+            parents.insert(parent);
+            slash = path.lastIndexOf('/', slash - 1);
+        }
+    }
+
+    foreach (const QByteArray &parent, parents) {
+        m_folders.remove(parent);
+    }
+}
+
+int LibarchiveEntrySelection::folderIndexOf(const QByteArray &path) const
+{
+    if (m_folders.isEmpty()) {
+        return -1;
+    }
+
+    int slash = path.indexOf('/');
+    while (slash > 0 && slash < path.size() - 1) {
+        const auto it = m_folders.constFind(QByteArray::fromRawData(path.constData(), slash + 1));
+        if (it != m_folders.constEnd()) {
+            return it.value();
+        }
+        slash = path.indexOf('/', slash + 1);
+    }
+
+    return -1;
+}
+
+int LibarchiveEntrySelection::indexOf(const char *pathname) const
+{
+    const QByteArray path = QByteArray::fromRawData(pathname, qstrlen(pathname));
+
+    const auto it = m_paths.constFind(path);
+    if (it != m_paths.constEnd()) {
+        return it.value();
+    }
+
+    return folderIndexOf(path);
+}
+
+int LibarchiveEntrySelection::take(const char *pathname)
+{
+    const QByteArray path = QByteArray::fromRawData(pathname, qstrlen(pathname));
+
+    const auto it = m_paths.constFind(path);
+    if (it != m_paths.constEnd()) {
+        const int index = it.value();
+        if (m_taken.testBit(index)) {
+            return folderIndexOf(path);
+        }
+        m_taken.setBit(index);
+        --m_remaining;
+        return index;
+    }
+
+    return folderIndexOf(path);
+}
+
+bool LibarchiveEntrySelection::isEmpty() const
+{
+    return m_paths.isEmpty();
+}
+
+bool LibarchiveEntrySelection::isExhausted() const
+{
+    return m_remaining == 0 && m_folders.isEmpty();
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBARCHIVEENTRYSELECTION_H
+#define LIBARCHIVEENTRYSELECTION_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+/**
+ * Set of selected archive entries, matched against the raw pathnames read from
+ * the archive headers.
+ *
+ * Lookups are hashed over the encoded paths, so matching does not depend on the
+ * size of the selection. Unless disabled, a selected folder none of whose
+ * descendants are selected also matches every entry below it.
+ */
+class LibarchiveEntrySelection
+{
+public:
+    explicit LibarchiveEntrySelection(const QStringList &paths = QStringList(), bool matchFolderContents = true);
+
+    void setPaths(const QStringList &paths, bool matchFolderContents = true);
+
+    /**
+     * @return Index in the selected paths of the entry or of the folder
+     *         containing it, -1 if the entry is not selected.
+     */
+    int indexOf(const char *pathname) const;
+
+    /**
+     * Like indexOf(), but an exactly matched path is consumed so that it is
+     * matched only once.
+     */
+    int take(const char *pathname);
+
+    bool isEmpty() const;
+
+    /**
+     * @return Whether every selected entry has been taken, so that the rest of
+     *         the archive can't match anymore.
+     */
+    bool isExhausted() const;
+
+private:
+    int folderIndexOf(const QByteArray &path) const;
+
+    QHash<QByteArray, int> m_paths;
+    QHash<QByteArray, int> m_folders;
+    QBitArray m_taken;
+    int m_remaining;
+};
+
+#endif // LIBARCHIVEENTRYSELECTION_H
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "libarchivefilereader.h"
+
+#include <cerrno>
+#include <cstdio>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+LibarchiveFileReader::LibarchiveFileReader(const QString &fileName, Mode mode, int blockSize)
+    : m_file(fileName)
+    , m_mode(mode)
+    , m_blockSize(blockSize)
+    , m_map(Q_NULLPTR)
+    , m_size(0)
+    , m_position(0)
+    , m_bytesRead(0)
+{
+}
+
+LibarchiveFileReader::~LibarchiveFileReader()
+{
+    release();
+}
+
+bool LibarchiveFileReader::open(struct archive *reader)
+{
+    release();
+
+    if (!m_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        archive_set_error(reader, EIO, "Could not open the archive");
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_position = 0;
+    m_bytesRead = 0;
+
+    // Mapping whole multi-GB archives needs a 64-bit address space.
+    if (m_mode == Mapped && sizeof(void*) >= 8 && m_size > 0) {
+        m_map = m_file.map(0, m_size);
+#ifdef Q_OS_UNIX
+        if (m_map) {
+            madvise(const_cast<uchar*>(m_map), m_size, MADV_SEQUENTIAL);
+        }
+#endif
+    }
+
+    if (!m_map) {
+#ifdef Q_OS_LINUX
+        posix_fadvise(m_file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+
+    archive_read_set_callback_data(reader, this);
+    archive_read_set_read_callback(reader, &LibarchiveFileReader::read);
+    archive_read_set_skip_callback(reader, &LibarchiveFileReader::skip);
+    archive_read_set_seek_callback(reader, &LibarchiveFileReader::seek);
+    archive_read_set_close_callback(reader, &LibarchiveFileReader::close);
+
+    return archive_read_open1(reader) == ARCHIVE_OK;
+}
+
+bool LibarchiveFileReader::isMapped() const
+{
+    return m_map;
+}
+
+void LibarchiveFileReader::setBlockSize(int blockSize)
+{
+    m_blockSize = blockSize;
+}
+
+qint64 LibarchiveFileReader::bytesRead() const
+{
+    return m_bytesRead;
+}
+
+ssize_t LibarchiveFileReader::read(struct archive *reader, void *clientData, const void **buffer)
+{
+    LibarchiveFileReader *fileReader = static_cast<LibarchiveFileReader*>(clientData);
+
+    // The blocks end on multiples of the block size, even after a seek.
+    const qint64 blockEnd = qMin(fileReader->m_size,
+                                 (fileReader->m_position / fileReader->m_blockSize + 1) * fileReader->m_blockSize);
+    const qint64 length = blockEnd - fileReader->m_position;
+    if (length <= 0) {
+        return 0;
+    }
+
+    // Accessing the pages of a mapped file which has been truncated raises SIGBUS.
+    if (fileReader->m_map && fileReader->m_file.size() != fileReader->m_size) {
+        fileReader->unmap();
+        fileReader->m_size = fileReader->m_file.size();
+        if (!fileReader->m_file.seek(fileReader->m_position)) {
+            archive_set_error(reader, EIO, "Could not read the archive");
+            return -1;
+        }
+        return read(reader, clientData, buffer);
+    }
+
+    if (fileReader->m_map) {
+        *buffer = fileReader->m_map + fileReader->m_position;
+        fileReader->m_position += length;
+        fileReader->m_bytesRead += length;
+        return length;
+    }
+
+    if (fileReader->m_buffer.size() < length) {
+        fileReader->m_buffer.resize(length);
+    }
+
+    const qint64 readBytes = fileReader->m_file.read(fileReader->m_buffer.data(), length);
+    if (readBytes < 0) {
+        archive_set_error(reader, EIO, "Could not read the archive");
+        return -1;
+    }
+
+    fileReader->m_position += readBytes;
+    fileReader->m_bytesRead += readBytes;
+    *buffer = fileReader->m_buffer.constData();
+    return readBytes;
+}
+
+int64_t LibarchiveFileReader::skip(struct archive *reader, void *clientData, int64_t request)
+{
+    LibarchiveFileReader *fileReader = static_cast<LibarchiveFileReader*>(clientData);
+
+    const qint64 skipped = qBound<qint64>(0, request, fileReader->m_size - fileReader->m_position);
+    if (!fileReader->m_map && !fileReader->m_file.seek(fileReader->m_position + skipped)) {
+        archive_set_error(reader, EIO, "Could not seek in the archive");
+        return ARCHIVE_FATAL;
+    }
+
+    fileReader->m_position += skipped;
+    return skipped;
+}
+
+int64_t LibarchiveFileReader::seek(struct archive *reader, void *clientData, int64_t offset, int whence)
+{
+    LibarchiveFileReader *fileReader = static_cast<LibarchiveFileReader*>(clientData);
+
+    qint64 position;
+    switch (whence) {
+    case SEEK_SET:
+        position = offset;
+        break;
+    case SEEK_CUR:
+        position = fileReader->m_position + offset;
+        break;
+    case SEEK_END:
+        position = fileReader->m_size + offset;
+        break;
+    default:
+        position = -1;
+        break;
+    }
+
+    if (position < 0 || position > fileReader->m_size ||
+        (!fileReader->m_map && !fileReader->m_file.seek(position))) {
+        archive_set_error(reader, EIO, "Could not seek in the archive");
+        return ARCHIVE_FATAL;
+    }
+
+    fileReader->m_position = position;
+    return position;
+}
+
+int LibarchiveFileReader::close(struct archive *reader, void *clientData)
+{
+    Q_UNUSED(reader)
+    static_cast<LibarchiveFileReader*>(clientData)->release();
+    return ARCHIVE_OK;
+}
+
+void LibarchiveFileReader::unmap()
+{
+    if (m_map) {
+        m_file.unmap(const_cast<uchar*>(m_map));
+        m_map = Q_NULLPTR;
+    }
+}
+
+void LibarchiveFileReader::release()
+{
+    unmap();
+    m_buffer.clear();
+    m_file.close();
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBARCHIVEFILEREADER_H
+#define LIBARCHIVEFILEREADER_H
+
+#include <archive.h>
+
+#include <QByteArray>
+#include <QFile>
+
+#include <cstdint>
+
+/**
+ * Feeds a libarchive reader with the content of an archive file.
+ *
+ * The file is read in large blocks aligned on the block size or, when asked for,
+ * mapped in memory so that libarchive reads it in place. In both cases the reader
+ * can skip and seek, so the formats which don't need all the data don't read it.
+ *
+ * A mapped file which is truncated while being read would crash the process, so
+ * its size is checked before each block and reading falls back to read() calls
+ * once it has changed.
+ *
+ * Uncompressed archives are best listed reading small blocks: the data of the
+ * entries is skipped with seeks, so only the blocks holding the headers are read.
+ */
+class LibarchiveFileReader
+{
+public:
+    enum Mode {
+        Mapped,
+        Buffered
+    };
+
+    static const int DefaultBlockSize = 1024 * 1024;
+    static const int HeaderBlockSize = 64 * 1024;
+
+    explicit LibarchiveFileReader(const QString &fileName, Mode mode = Buffered, int blockSize = DefaultBlockSize);
+    ~LibarchiveFileReader();
+
+    /**
+     * Opens @p reader on the file, reading it from the beginning.
+     * The file is read in blocks if it can't be mapped.
+     */
+    bool open(struct archive *reader);
+
+    /**
+     * @return Whether the file is mapped in memory.
+     */
+    bool isMapped() const;
+
+    /**
+     * Changes the size of the next blocks read, e.g. once the compression filter
+     * of the archive is known.
+     */
+    void setBlockSize(int blockSize);
+
+    /**
+     * @return The number of bytes given to libarchive since the file was opened,
+     * as opposed to the bytes skipped.
+     */
+    qint64 bytesRead() const;
+
+private:
+    static ssize_t read(struct archive *reader, void *clientData, const void **buffer);
+    static int64_t skip(struct archive *reader, void *clientData, int64_t request);
+    static int64_t seek(struct archive *reader, void *clientData, int64_t offset, int whence);
+    static int close(struct archive *reader, void *clientData);
+
+    void release();
+    void unmap();
+
+    QFile m_file;
+    Mode m_mode;
+    int m_blockSize;
+    const uchar *m_map;
+    QByteArray m_buffer;
+    qint64 m_size;
+    qint64 m_position;
+    qint64 m_bytesRead;
+};
+
+#endif // LIBARCHIVEFILEREADER_H
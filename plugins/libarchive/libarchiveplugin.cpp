@@ -27,22 +27,131 @@
  */
 
 #include "libarchiveplugin.h"
+#include "libarchiveentrydevice.h"
+#include "libarchiveentryselection.h"
+#include "kerfuffle/conflictdecisions.h"
 #include "kerfuffle/queries.h"
 
 #include <KLocalizedString>
 
 #include <QDirIterator>
 
+#include <archive_entry.h>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#include <cerrno>
+#include <cstring>
+
+/**
+ * Finds the first region of data in the file @p fd at or after @p position.
+ * Filesystems which can't report holes (or lack of SEEK_DATA) make the rest
+ * of the file a single data region.
+ */
+static void findDataRegion(int fd, qint64 position, qint64 fileSize, qint64 &dataStart, qint64 &dataEnd)
+{
+    dataStart = position;
+    dataEnd = fileSize;
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    const off_t start = lseek(fd, position, SEEK_DATA);
+    if (start < 0) {
+        // ENXIO means that the file ends with a hole.
+        if (errno == ENXIO) {
+            dataStart = fileSize;
+        }
+        return;
+    }
+
+    const off_t end = lseek(fd, start, SEEK_HOLE);
+    dataStart = start;
+    dataEnd = (end < 0) ? fileSize : qMin<qint64>(end, fileSize);
+#else
+    Q_UNUSED(fd)
+#endif
+}
+
+/**
+ * Copies @p size bytes at @p offset in @p sourceFd to the beginning of @p destFd
+ * without passing them through userspace. Block aligned ranges are reflinked
+ * (shared copy-on-write) on filesystems supporting it.
+ *
+ * @return Whether the whole range has been copied.
+ */
+static bool copyFileRange(int sourceFd, qint64 offset, int destFd, qint64 size)
+{
+#ifdef Q_OS_LINUX
+    const qint64 blockSize = 4096;
+    qint64 copiedBytes = 0;
+
+#ifdef FICLONERANGE
+    if (offset % blockSize == 0 && size >= blockSize) {
+        struct file_clone_range range;
+        range.src_fd = sourceFd;
+        range.src_offset = offset;
+        range.src_length = size - size % blockSize;
+        range.dest_offset = 0;
+        if (ioctl(destFd, FICLONERANGE, &range) == 0) {
+            copiedBytes = range.src_length;
+        }
+    }
+#endif
+
+#ifdef SYS_copy_file_range
+    loff_t sourceOffset = offset + copiedBytes;
+    loff_t destOffset = copiedBytes;
+    while (copiedBytes < size) {
+        const ssize_t result = syscall(SYS_copy_file_range, sourceFd, &sourceOffset, destFd, &destOffset, size_t(size - copiedBytes), 0u);
+        if (result <= 0) {
+            return false;
+        }
+        copiedBytes += result;
+    }
+#endif
+
+    return copiedBytes == size;
+#else
+    Q_UNUSED(sourceFd)
+    Q_UNUSED(offset)
+    Q_UNUSED(destFd)
+    Q_UNUSED(size)
+    return false;
+#endif
+}
+
+/**
+ * Writes @p size zero bytes to @p dest, without reading them from anywhere.
+ */
+static bool writeZeros(struct archive *dest, qint64 size)
+{
+    static const QByteArray zeros(1024 * 1024, '\0');
+
+    while (size > 0) {
+        const qint64 chunkSize = qMin<qint64>(size, zeros.size());
+        if (archive_write_data(dest, zeros.constData(), chunkSize) < 0) {
+            return false;
+        }
+        size -= chunkSize;
+    }
+
+    return true;
+}
+
 LibarchivePlugin::LibarchivePlugin(QObject *parent, const QVariantList &args)
     : ReadWriteArchiveInterface(parent, args)
-    , m_archiveReadDisk(archive_read_disk_new())
     , m_abortOperation(false)
     , m_cachedArchiveEntryCount(0)
-    , m_emitNoEntries(false)
     , m_extractedFilesSize(0)
+    , m_archiveFileSize(0)
 {
     qCDebug(ARK) << "Initializing libarchive plugin";
-    archive_read_disk_set_standard_lookup(m_archiveReadDisk.data());
 }
 
 LibarchivePlugin::~LibarchivePlugin()
@@ -53,12 +162,20 @@ bool LibarchivePlugin::list()
 {
     qCDebug(ARK) << "Listing archive contents";
 
-    if (!initializeReader()) {
+    // The headers are found reading small blocks, and the data between them is
+    // skipped with seeks if the archive is not compressed.
+    if (!initializeReader(LibarchiveFileReader::Buffered, LibarchiveFileReader::HeaderBlockSize)) {
         return false;
     }
 
     qDebug(ARK) << "Detected compression filter:" << archive_filter_name(m_archiveReader.data(), 0);
 
+    const bool isUncompressed = (archive_filter_count(m_archiveReader.data()) == 1 &&
+                                 archive_filter_code(m_archiveReader.data(), 0) == ARCHIVE_FILTER_NONE);
+    if (!isUncompressed) {
+        m_fileReader->setBlockSize(LibarchiveFileReader::DefaultBlockSize);
+    }
+
     m_cachedArchiveEntryCount = 0;
     m_extractedFilesSize = 0;
 
@@ -73,9 +190,7 @@ bool LibarchivePlugin::list()
             firstEntry = false;
         }
 
-        if (!m_emitNoEntries) {
-            emitEntryFromArchiveEntry(aentry);
-        }
+        emitEntryFromArchiveEntry(aentry);
 
         m_extractedFilesSize += (qlonglong)archive_entry_size(aentry);
 
@@ -91,6 +206,9 @@ bool LibarchivePlugin::list()
         return false;
     }
 
+    qCDebug(ARK) << "Listed" << m_cachedArchiveEntryCount << "entries reading" << m_fileReader->bytesRead()
+                 << "bytes of" << QFileInfo(filename()).size();
+
     return archive_read_close(m_archiveReader.data()) == ARCHIVE_OK;
 }
 
@@ -143,20 +261,22 @@ bool LibarchivePlugin::doKill()
 
 bool LibarchivePlugin::extractFiles(const QList<Archive::Entry*> &files, const QString &destinationDirectory, const ExtractionOptions &options)
 {
-    qCDebug(ARK) << "Changing current directory to " << destinationDirectory;
-    QDir::setCurrent(destinationDirectory);
+    qCDebug(ARK) << "Extracting to" << destinationDirectory;
+
+    // Entries are written with absolute paths: the working directory is shared
+    // by the whole process, so it can't be changed while other jobs may run.
+    const QDir destDir(destinationDirectory);
 
     const bool extractAll = files.isEmpty();
     const bool preservePaths = options.value(QStringLiteral( "PreservePaths" )).toBool();
     bool removeRootNode = options.value(QStringLiteral("RemoveRootNode"), QVariant()).toBool();
 
     // To avoid traversing the entire archive when extracting a limited set of
-    // entries, we maintain a list of remaining entries and stop when it's
-    // empty.
-    QStringList fullPaths = entryFullPaths(files);
-    QStringList remainingFiles = entryFullPaths(files);
+    // entries, the selection keeps track of the remaining entries and we stop
+    // when it's exhausted.
+    LibarchiveEntrySelection selection(entryFullPaths(files));
 
-    if (!initializeReader()) {
+    if (!initializeReaderFor(files)) {
         return false;
     }
 
@@ -167,46 +287,60 @@ bool LibarchivePlugin::extractFiles(const QList<Archive::Entry*> &files, const Q
 
     archive_write_disk_set_options(writer.data(), extractionFlags());
 
+    // The entries of uncompressed archives are stored as is in the archive file,
+    // which is opened once more to copy them within the kernel.
+    QFile archiveFile(filename());
+    const bool isUncompressed = (archive_filter_count(m_archiveReader.data()) == 1 &&
+                                 archive_filter_code(m_archiveReader.data(), 0) == ARCHIVE_FILTER_NONE &&
+                                 archiveFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered));
+
     int entryNr = 0;
     int totalCount = 0;
 
+    // When the whole archive is extracted, the progress is based on the uncompressed
+    // size of the entries if the archive has already been listed. Otherwise we don't
+    // list it just for that, the progress is the amount of the archive file read so far.
+    m_archiveFileSize = 0;
     if (extractAll) {
-        if (!m_cachedArchiveEntryCount) {
-            emit progress(0);
-            //TODO: once information progress has been implemented, send
-            //feedback here that the archive is being read
-            qCDebug(ARK) << "For getting progress information, the archive will be listed once";
-            m_emitNoEntries = true;
-            list();
-            m_emitNoEntries = false;
-        }
+        emit progress(0);
         totalCount = m_cachedArchiveEntryCount;
+        if (!m_extractedFilesSize) {
+            m_archiveFileSize = QFileInfo(filename()).size();
+        }
     } else {
         totalCount = files.size();
     }
 
-    qCDebug(ARK) << "Going to extract" << totalCount << "entries";
+    qCDebug(ARK) << "Going to extract" << (totalCount ? QString::number(totalCount) : QStringLiteral("all")) << "entries";
 
 
     // Initialize variables.
     bool overwriteAll = false; // Whether to overwrite all files
     bool skipAll = false; // Whether to skip all files
     bool dontPromptErrors = false; // Whether to prompt for errors
+    const ConflictDecisions conflictDecisions(options);
     m_currentExtractedFilesSize = 0;
     int no_entries = 0;
 
     struct archive_entry *entry;
     QString fileBeingRenamed;
 
+    // The regular files extracted, by path in the archive, which the hardlinks
+    // stored after them point to. The hardlinks whose target is not extracted
+    // get its data in a second pass.
+    QHash<QString, QString> extractedFiles;
+    QMultiHash<QString, QString> pendingHardlinks;
+
     // Iterate through all entries in archive.
     while (!m_abortOperation && (archive_read_next_header(m_archiveReader.data(), &entry) == ARCHIVE_OK)) {
 
-        if (!extractAll && remainingFiles.isEmpty()) {
+        if (!extractAll && selection.isExhausted()) {
             break;
         }
 
         fileBeingRenamed.clear();
         int index = -1;
+        const QString archivePath = QDir::fromNativeSeparators(QFile::decodeName(archive_entry_pathname(entry)));
 
         // Retry with renamed entry, fire an overwrite query again
         // if the new entry also exists.
@@ -216,6 +350,9 @@ bool LibarchivePlugin::extractFiles(const QList<Archive::Entry*> &files, const Q
 
         // Skip directories if not preserving paths.
         if (!preservePaths && entryIsDir) {
+            if (!extractAll) {
+                selection.take(archive_entry_pathname(entry));
+            }
             archive_read_data_skip(m_archiveReader.data());
             continue;
         }
@@ -225,25 +362,19 @@ bool LibarchivePlugin::extractFiles(const QList<Archive::Entry*> &files, const Q
 
         // For now we just can't handle absolute filenames in a tar archive.
         // TODO: find out what to do here!!
-        if (entryName.startsWith(QLatin1Char( '/' ))) {
+        if (entryName.startsWith(QLatin1Char( '/' )) && entryName != fileBeingRenamed) {
             emit error(i18n("This archive contains archive entries with absolute paths, "
                             "which are not supported by Ark."));
             return false;
         }
 
-        // Should the entry be extracted?
-        if (extractAll ||
-            remainingFiles.contains(entryName) ||
-            entryName == fileBeingRenamed) {
+        // Should the entry be extracted? The index of the selected entry is
+        // kept when retrying with a renamed entry.
+        if (!extractAll && entryName != fileBeingRenamed) {
+            index = selection.take(archive_entry_pathname(entry));
+        }
 
-            // Find the index of entry.
-            if (entryName != fileBeingRenamed) {
-                index = fullPaths.indexOf(entryName);
-            }
-            if (!extractAll && index == -1) {
-                // If entry is not found in files, skip entry.
-                continue;
-            }
+        if (extractAll || index != -1) {
 
             // entryFI is the fileinfo pointing to where the file will be
             // written from the archive.
@@ -274,14 +405,19 @@ bool LibarchivePlugin::extractFiles(const QList<Archive::Entry*> &files, const Q
                 }
             }
 
+            entryFI = QFileInfo(destDir.absoluteFilePath(entryFI.filePath()));
+            archive_entry_copy_pathname(entry, QFile::encodeName(entryFI.filePath()).constData());
+
             // Check if the file about to be written already exists.
+            // The files found before the extraction started have been decided upon already.
             if (!entryIsDir && entryFI.exists()) {
-                if (skipAll) {
+                const ConflictDecisions::Decision decision = conflictDecisions.decisionFor(entryFI.absoluteFilePath());
+                if (skipAll || decision == ConflictDecisions::Skip) {
                     archive_read_data_skip(m_archiveReader.data());
                     archive_entry_clear(entry);
                     continue;
-                } else if (!overwriteAll && !skipAll) {
-                    Kerfuffle::OverwriteQuery query(entryName);
+                } else if (!overwriteAll && decision == ConflictDecisions::Ask) {
+                    Kerfuffle::OverwriteQuery query(entryFI.absoluteFilePath());
                     emit userQuery(&query);
                     query.waitForResponse();
 
@@ -321,13 +457,40 @@ bool LibarchivePlugin::extractFiles(const QList<Archive::Entry*> &files, const Q
                 }
             }
 
+            if (archive_entry_hardlink(entry)) {
+                const QString target = QDir::fromNativeSeparators(QFile::decodeName(archive_entry_hardlink(entry)));
+                QString extractedTarget = extractedFiles.value(target);
+                if (extractedTarget.isEmpty()) {
+                    if (archive_entry_size(entry) == 0) {
+                        pendingHardlinks.insert(target, entryFI.absoluteFilePath());
+                        archive_read_data_skip(m_archiveReader.data());
+                        no_entries++;
+                        continue;
+                    }
+                    extractedTarget = destDir.absoluteFilePath(target);
+                }
+                archive_entry_copy_hardlink(entry, QFile::encodeName(extractedTarget).constData());
+            }
+
             // Write the entry header and check return value.
             const int returnCode = archive_write_header(writer.data(), entry);
             switch (returnCode) {
             case ARCHIVE_OK:
-                // If the whole archive is extracted and the total filesize is
-                // available, we use partial progress.
-                copyData(entryName, m_archiveReader.data(), writer.data(), (extractAll && m_extractedFilesSize));
+                if (archive_entry_filetype(entry) == AE_IFREG && !archive_entry_hardlink(entry)) {
+                    extractedFiles.insert(archivePath, entryFI.absoluteFilePath());
+                }
+
+                // Stored data can be copied by the kernel straight from the archive file.
+                if (isUncompressed && copyStoredData(entry, archiveFile.handle(), extractAll)) {
+                    break;
+                }
+
+                if (extractSparseData(entry, extractAll)) {
+                    break;
+                }
+
+                // If the whole archive is extracted, we use partial progress.
+                extractData(entryName, m_archiveReader.data(), writer.data(), extractAll);
                 break;
 
             case ARCHIVE_FAILED:
@@ -373,8 +536,6 @@ bool LibarchivePlugin::extractFiles(const QList<Archive::Entry*> &files, const Q
             }
             no_entries++;
 
-            remainingFiles.removeOne(entryName);
-
         } else {
 
             // Archive entry not among selected files, skip it.
@@ -384,14 +545,89 @@ bool LibarchivePlugin::extractFiles(const QList<Archive::Entry*> &files, const Q
 
     } // While entries left to read in archive.
 
+    bool isSuccessful = (archive_read_close(m_archiveReader.data()) == ARCHIVE_OK);
+    if (isSuccessful && !m_abortOperation && !pendingHardlinks.isEmpty()) {
+        isSuccessful = extractHardlinkTargets(pendingHardlinks);
+    }
+
     m_abortOperation = false;
 
     qCDebug(ARK) << "Extracted" << no_entries << "entries";
 
+    return isSuccessful;
+}
+
+bool LibarchivePlugin::extractHardlinkTargets(const QMultiHash<QString, QString> &hardlinks)
+{
+    qCDebug(ARK) << "Extracting the targets of" << hardlinks.size() << "hardlinks";
+
+    if (!initializeReader()) {
+        return false;
+    }
+
+    ArchiveWrite writer(archive_write_disk_new());
+    if (!writer.data()) {
+        return false;
+    }
+
+    archive_write_disk_set_options(writer.data(), extractionFlags());
+
+    QMultiHash<QString, QString> remainingHardlinks = hardlinks;
+    struct archive_entry *entry;
+
+    while (!m_abortOperation && !remainingHardlinks.isEmpty() &&
+           archive_read_next_header(m_archiveReader.data(), &entry) == ARCHIVE_OK) {
+        const QString entryName = QDir::fromNativeSeparators(QFile::decodeName(archive_entry_pathname(entry)));
+        const QStringList links = remainingHardlinks.values(entryName);
+        if (links.isEmpty()) {
+            archive_read_data_skip(m_archiveReader.data());
+            continue;
+        }
+        remainingHardlinks.remove(entryName);
+
+        // The first link is given the data, the other ones are linked to it.
+        for (int i = 0; i < links.size(); ++i) {
+            archive_entry_copy_pathname(entry, QFile::encodeName(links.at(i)).constData());
+            if (i > 0) {
+                archive_entry_copy_hardlink(entry, QFile::encodeName(links.first()).constData());
+                archive_entry_set_size(entry, 0);
+            }
+
+            const int returnCode = archive_write_header(writer.data(), entry);
+            if (returnCode < ARCHIVE_WARN) {
+                qCCritical(ARK) << "archive_write_header() has returned" << returnCode
+                                << "with errno" << archive_errno(writer.data());
+                emit error(xi18nc("@info", "Extraction failed at:<nl/><filename>%1</filename>",
+                                  links.at(i)));
+                return false;
+            }
+
+            if (i == 0) {
+                extractData(entryName, m_archiveReader.data(), writer.data(), false);
+            }
+        }
+    }
+
+    if (!remainingHardlinks.isEmpty() && !m_abortOperation) {
+        qCWarning(ARK) << "The targets of the hardlinks were not found:" << remainingHardlinks.uniqueKeys();
+    }
+
     return archive_read_close(m_archiveReader.data()) == ARCHIVE_OK;
 }
 
-bool LibarchivePlugin::initializeReader()
+QIODevice *LibarchivePlugin::createEntryDevice(Archive::Entry *entry)
+{
+    LibarchiveEntryDevice *device = new LibarchiveEntryDevice(filename(), entry->fullPath());
+    if (!device->open(QIODevice::ReadOnly)) {
+        qCWarning(ARK) << "Could not stream" << entry->fullPath() << ":" << device->errorString();
+        delete device;
+        return Q_NULLPTR;
+    }
+
+    return device;
+}
+
+bool LibarchivePlugin::initializeReader(LibarchiveFileReader::Mode mode, int blockSize)
 {
     m_archiveReader.reset(archive_read_new());
 
@@ -408,7 +644,8 @@ bool LibarchivePlugin::initializeReader()
         return false;
     }
 
-    if (archive_read_open_filename(m_archiveReader.data(), QFile::encodeName(filename()), 10240) != ARCHIVE_OK) {
+    m_fileReader.reset(new LibarchiveFileReader(filename(), mode, blockSize));
+    if (!m_fileReader->open(m_archiveReader.data())) {
         emit error(xi18nc("@info", "Could not open the archive <filename>%1</filename>.<nl/>"
             "Check whether you have sufficient permissions.",
                           filename()));
@@ -418,6 +655,12 @@ bool LibarchivePlugin::initializeReader()
     return true;
 }
 
+bool LibarchivePlugin::initializeReaderFor(const QList<Archive::Entry*> &files)
+{
+    Q_UNUSED(files)
+    return initializeReader();
+}
+
 void LibarchivePlugin::emitEntryFromArchiveEntry(struct archive_entry *aentry)
 {
     Archive::Entry *e = new Archive::Entry(Q_NULLPTR);
@@ -455,6 +698,8 @@ int LibarchivePlugin::extractionFlags() const
 {
     int result = ARCHIVE_EXTRACT_TIME;
     result |= ARCHIVE_EXTRACT_SECURE_NODOTDOT;
+    // Don't write runs of zeros, leave holes instead.
+    result |= ARCHIVE_EXTRACT_SPARSE;
 
     // TODO: Don't use arksettings here
     /*if ( ArkSettings::preservePerms() )
@@ -476,25 +721,55 @@ void LibarchivePlugin::copyData(const QString& filename, struct archive *dest, b
     ssize_t readBytes;
     QFile file(filename);
 
-    if (!file.open(QIODevice::ReadOnly)) {
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
         return;
     }
 
-    readBytes = file.read(buff, sizeof(buff));
-    while (readBytes > 0) {
-        archive_write_data(dest, buff, readBytes);
-        if (archive_errno(dest) != ARCHIVE_OK) {
+    // Only the data regions of sparse files are read, the holes are passed as zeros.
+    // archive_read_disk_entry_from_file() has given the sparse map of the file to
+    // the entry, so the tar writers don't store these zeros either.
+    const qint64 fileSize = file.size();
+    qint64 position = 0;
+
+    while (position < fileSize) {
+        qint64 dataStart;
+        qint64 dataEnd;
+        findDataRegion(file.handle(), position, fileSize, dataStart, dataEnd);
+
+        if (!writeZeros(dest, dataStart - position)) {
             qCCritical(ARK) << "Error while writing" << filename << ":" << archive_error_string(dest)
                             << "(error no =" << archive_errno(dest) << ')';
             return;
         }
 
+        if (!file.seek(dataStart)) {
+            return;
+        }
+
+        qint64 remainingBytes = dataEnd - dataStart;
+        while (remainingBytes > 0) {
+            readBytes = file.read(buff, qMin<qint64>(sizeof(buff), remainingBytes));
+            if (readBytes <= 0) {
+                // The file has been truncated meanwhile.
+                return;
+            }
+
+            archive_write_data(dest, buff, readBytes);
+            if (archive_errno(dest) != ARCHIVE_OK) {
+                qCCritical(ARK) << "Error while writing" << filename << ":" << archive_error_string(dest)
+                                << "(error no =" << archive_errno(dest) << ')';
+                return;
+            }
+
+            remainingBytes -= readBytes;
+        }
+
         if (partialprogress) {
-            m_currentExtractedFilesSize += readBytes;
+            m_currentExtractedFilesSize += dataEnd - position;
             emit progress(float(m_currentExtractedFilesSize) / m_extractedFilesSize);
         }
 
-        readBytes = file.read(buff, sizeof(buff));
+        position = dataEnd;
     }
 
     file.close();
@@ -523,4 +798,151 @@ void LibarchivePlugin::copyData(const QString& filename, struct archive *source,
     }
 }
 
+bool LibarchivePlugin::copyStoredData(struct archive_entry *entry, int archiveFd, bool partialprogress)
+{
+    // Only tar stores the data of regular files contiguously and unmodified.
+    if ((archive_format(m_archiveReader.data()) & ARCHIVE_FORMAT_BASE_MASK) != ARCHIVE_FORMAT_TAR ||
+        archive_entry_filetype(entry) != AE_IFREG ||
+        archive_entry_hardlink(entry) ||
+        archive_entry_sparse_count(entry) > 0 ||
+        archive_entry_size(entry) <= 0) {
+        return false;
+    }
+
+    // The format reader has consumed the headers so far, so the data starts here.
+    const qint64 dataOffset = archive_filter_bytes(m_archiveReader.data(), 0);
+    const qint64 size = archive_entry_size(entry);
+
+    // archive_write_header() has just created the file.
+    const int fd = open(archive_entry_pathname(entry), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const bool copied = copyFileRange(archiveFd, dataOffset, fd, size);
+    close(fd);
+
+    if (!copied) {
+        qCDebug(ARK) << "Kernel copy not possible for" << archive_entry_pathname(entry) << ", falling back to reading it";
+        return false;
+    }
+
+    archive_read_data_skip(m_archiveReader.data());
+
+    if (partialprogress) {
+        emitExtractionProgress(size);
+    }
+
+    return true;
+}
+
+bool LibarchivePlugin::extractSparseData(struct archive_entry *entry, bool partialprogress)
+{
+    if (archive_entry_filetype(entry) != AE_IFREG ||
+        archive_entry_hardlink(entry) ||
+        archive_entry_sparse_count(entry) == 0) {
+        return false;
+    }
+
+    // archive_write_header() has just created the file.
+    const int fd = open(archive_entry_pathname(entry), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    const void *buff;
+    size_t readBytes;
+    int64_t offset;
+    qint64 position = 0;
+    int result;
+
+    while ((result = archive_read_data_block(m_archiveReader.data(), &buff, &readBytes, &offset)) != ARCHIVE_EOF) {
+        if (result < ARCHIVE_WARN) {
+            qCCritical(ARK) << "Error while reading" << archive_entry_pathname(entry) << ":" << archive_error_string(m_archiveReader.data())
+                            << "(error no =" << archive_errno(m_archiveReader.data()) << ')';
+            break;
+        }
+
+        // Each block is written at its own offset, the holes before it are skipped.
+        const char *data = static_cast<const char*>(buff);
+        qint64 writtenBytes = 0;
+        while (writtenBytes < qint64(readBytes)) {
+            const ssize_t written = pwrite(fd, data + writtenBytes, readBytes - writtenBytes, offset + writtenBytes);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                break;
+            }
+            writtenBytes += written;
+        }
+        if (writtenBytes < qint64(readBytes)) {
+            qCCritical(ARK) << "Error while extracting" << archive_entry_pathname(entry) << ":" << strerror(errno);
+            break;
+        }
+
+        if (partialprogress) {
+            emitExtractionProgress(offset + readBytes - position);
+        }
+
+        position = offset + readBytes;
+    }
+
+    // A trailing hole is not part of any block.
+    const qint64 size = archive_entry_size_is_set(entry) ? archive_entry_size(entry) : position;
+    if (ftruncate(fd, size) != 0) {
+        qCWarning(ARK) << "Could not set the size of" << archive_entry_pathname(entry) << ":" << strerror(errno);
+    }
+    close(fd);
+
+    return true;
+}
+
+void LibarchivePlugin::emitExtractionProgress(qlonglong extractedBytes)
+{
+    m_currentExtractedFilesSize += extractedBytes;
+
+    if (m_extractedFilesSize) {
+        emit progress(float(m_currentExtractedFilesSize) / m_extractedFilesSize);
+    } else if (m_archiveFileSize) {
+        // Bytes consumed from the archive file itself, before any decompression.
+        emit progress(float(archive_filter_bytes(m_archiveReader.data(), -1)) / m_archiveFileSize);
+    }
+}
+
+void LibarchivePlugin::extractData(const QString& filename, struct archive *source, struct archive *dest, bool partialprogress)
+{
+    const void *buff;
+    size_t readBytes;
+    int64_t offset;
+    qint64 position = 0;
+    int result;
+
+    // Reading blocks with their offsets lets archive_write_disk seek over the
+    // holes of sparse entries instead of writing zeros.
+    // Warnings are not fatal, the data of the block is valid.
+    while ((result = archive_read_data_block(source, &buff, &readBytes, &offset)) == ARCHIVE_OK ||
+           result == ARCHIVE_WARN) {
+        if (result == ARCHIVE_WARN) {
+            qCWarning(ARK) << "Warning while reading" << filename << ":" << archive_error_string(source);
+        }
+
+        if (archive_write_data_block(dest, buff, readBytes, offset) < ARCHIVE_WARN) {
+            qCCritical(ARK) << "Error while extracting" << filename << ":" << archive_error_string(dest)
+                            << "(error no =" << archive_errno(dest) << ')';
+            return;
+        }
+
+        if (partialprogress) {
+            emitExtractionProgress(offset + readBytes - position);
+        }
+
+        position = offset + readBytes;
+    }
+
+    if (result != ARCHIVE_EOF) {
+        qCCritical(ARK) << "Error while reading" << filename << ":" << archive_error_string(source)
+                        << "(error no =" << archive_errno(source) << ')';
+    }
+}
+
 #include "libarchiveplugin.moc"
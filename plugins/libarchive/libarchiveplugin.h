@@ -30,9 +30,11 @@
 
 #include "kerfuffle/archiveinterface.h"
 #include "kerfuffle/archiveentry.h"
+#include "libarchivefilereader.h"
 
 #include <archive.h>
 
+#include <QHash>
 #include <QScopedPointer>
 
 using namespace Kerfuffle;
@@ -48,6 +50,7 @@ public:
     virtual bool list() Q_DECL_OVERRIDE;
     virtual bool doKill() Q_DECL_OVERRIDE;
     virtual bool extractFiles(const QList<Archive::Entry*> &files, const QString &destinationDirectory, const ExtractionOptions &options) Q_DECL_OVERRIDE;
+    virtual QIODevice *createEntryDevice(Archive::Entry *entry) Q_DECL_OVERRIDE;
 
     virtual bool addFiles(const QList<Archive::Entry*> &files, const Archive::Entry *destination, const CompressionOptions &options) Q_DECL_OVERRIDE;
     virtual bool moveFiles(const QList<Archive::Entry*> &files, Archive::Entry *destination, const CompressionOptions &options) Q_DECL_OVERRIDE;
@@ -80,22 +83,61 @@ protected:
     typedef QScopedPointer<struct archive, ArchiveReadCustomDeleter> ArchiveRead;
     typedef QScopedPointer<struct archive, ArchiveWriteCustomDeleter> ArchiveWrite;
 
-    bool initializeReader();
+    bool initializeReader(LibarchiveFileReader::Mode mode = LibarchiveFileReader::Buffered,
+                          int blockSize = LibarchiveFileReader::DefaultBlockSize);
+
+    /**
+     * Initializes the reader to extract @p files, all the entries if empty.
+     * Formats which can seek to the entries give the reader only their data.
+     */
+    virtual bool initializeReaderFor(const QList<Archive::Entry*> &files);
+
     void emitEntryFromArchiveEntry(struct archive_entry *entry);
     void copyData(const QString& filename, struct archive *dest, bool partialprogress = true);
     void copyData(const QString& filename, struct archive *source, struct archive *dest, bool partialprogress = true);
-
+    void extractData(const QString& filename, struct archive *source, struct archive *dest, bool partialprogress = true);
+
+    /**
+     * Copies the data of @p entry from the uncompressed archive file @p archiveFd to the
+     * file just created by archive_write_header(), using kernel-side copies.
+     *
+     * @return Whether the data has been copied. If not, it must be extracted as usual.
+     */
+    bool copyStoredData(struct archive_entry *entry, int archiveFd, bool partialprogress);
+
+    /**
+     * Writes the data regions of the sparse @p entry to the file just created by
+     * archive_write_header(), seeking over the holes and truncating the file to
+     * its final size, so that the holes are never allocated.
+     *
+     * @return Whether the data has been written. If not, it must be extracted as usual.
+     */
+    bool extractSparseData(struct archive_entry *entry, bool partialprogress);
+
+    /**
+     * Extracts the data of the targets of @p hardlinks, by path in the archive,
+     * to the files extracted for the hardlinks whose target was not extracted.
+     */
+    bool extractHardlinkTargets(const QMultiHash<QString, QString> &hardlinks);
+
+    /**
+     * Reports the progress of a whole archive extraction after @p extractedBytes
+     * more bytes have been written.
+     */
+    void emitExtractionProgress(qlonglong extractedBytes);
+
+    // Declared before the reader, which still uses it when it is freed.
+    QScopedPointer<LibarchiveFileReader> m_fileReader;
     ArchiveRead m_archiveReader;
-    ArchiveRead m_archiveReadDisk;
     bool m_abortOperation;
+    int m_cachedArchiveEntryCount;
+    qlonglong m_extractedFilesSize;
 
 private:
     int extractionFlags() const;
 
-    int m_cachedArchiveEntryCount;
     qlonglong m_currentExtractedFilesSize;
-    bool m_emitNoEntries;
-    qlonglong m_extractedFilesSize;
+    qint64 m_archiveFileSize;
 };
 
 #endif // LIBARCHIVEPLUGIN_H
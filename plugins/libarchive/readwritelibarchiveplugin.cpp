@@ -27,17 +27,40 @@
  */
 
 #include "readwritelibarchiveplugin.h"
+#include "libarchivediskreader.h"
+#include "libarchiveentryselection.h"
 
 #include <KLocalizedString>
 #include <KPluginFactory>
 
-#include <QDirIterator>
 #include <QSaveFile>
 
 K_PLUGIN_FACTORY_WITH_JSON(ReadWriteLibarchivePluginFactory, "kerfuffle_libarchive.json", registerPlugin<ReadWriteLibarchivePlugin>();)
 
+// Compares the files found with the same hash, so that a collision can't lose data.
+static bool haveSameContent(const QString &fileName1, const QString &fileName2)
+{
+    QFile file1(fileName1);
+    QFile file2(fileName2);
+    if (!file1.open(QIODevice::ReadOnly) || !file2.open(QIODevice::ReadOnly) || file1.size() != file2.size()) {
+        return false;
+    }
+
+    const qint64 chunkSize = 64 * 1024;
+    while (!file1.atEnd()) {
+        const QByteArray chunk = file1.read(chunkSize);
+        if (chunk.isEmpty() || chunk != file2.read(chunkSize)) {
+            return false;
+        }
+    }
+
+    return file2.atEnd();
+}
+
 ReadWriteLibarchivePlugin::ReadWriteLibarchivePlugin(QObject *parent, const QVariantList &args)
     : LibarchivePlugin(parent, args)
+    , m_deduplicateContent(false)
+    , m_savedBytes(0)
 {
     qCDebug(ARK) << "Loaded libarchive read-write plugin";
 }
@@ -53,6 +76,10 @@ bool ReadWriteLibarchivePlugin::addFiles(const QList<Archive::Entry*> &files, co
     const bool creatingNewFile = !QFileInfo::exists(filename());
 
     m_writtenFiles.clear();
+    m_writtenInodes.clear();
+    m_writtenContents.clear();
+    m_deduplicateContent = options.value(QStringLiteral("DeduplicateContent")).toBool();
+    m_savedBytes = 0;
 
     if (!creatingNewFile && !initializeReader()) {
         return false;
@@ -70,49 +97,34 @@ bool ReadWriteLibarchivePlugin::addFiles(const QList<Archive::Entry*> &files, co
                                     ? QString()
                                     : destination->fullPath();
 
-    foreach(Archive::Entry *selectedFile, files) {
-        if (m_abortOperation) {
-            break;
-        }
+    // The paths of the files are relative to GlobalWorkDir, if any.
+    const QString globalWorkDir = options.value(QStringLiteral("GlobalWorkDir")).toString();
+    const QDir workDir = globalWorkDir.isEmpty() ? QDir::current() : QDir(globalWorkDir);
 
-        if (!writeFile(selectedFile->fullPath(), destinationPath)) {
-            finish(false);
-            return false;
-        }
-        no_entries++;
-
-        // For directories, write all subfiles/folders.
-        const QString &fullPath = selectedFile->fullPath();
-        if (QFileInfo(fullPath).isDir()) {
-            QDirIterator it(fullPath,
-                            QDir::AllEntries | QDir::Readable |
-                            QDir::Hidden | QDir::NoDotAndDotDot,
-                            QDirIterator::Subdirectories);
-
-            while (!m_abortOperation && it.hasNext()) {
-                QString path = it.next();
-
-                if ((it.fileName() == QLatin1String("..")) ||
-                    (it.fileName() == QLatin1String("."))) {
-                    continue;
-                }
+    // The directories are walked and the files read by other threads, while this
+    // one writes them in the order of the walk as soon as they are read.
+    LibarchiveDiskReader diskReader(workDir, entryFullPaths(files), m_deduplicateContent, &m_abortOperation);
 
-                const bool isRealDir = it.fileInfo().isDir() && !it.fileInfo().isSymLink();
-
-                if (isRealDir) {
-                    path.append(QLatin1Char('/'));
-                }
+    while (!m_abortOperation && !diskReader.atEnd()) {
+        foreach (const LibarchiveDiskReader::Entry &file, diskReader.next()) {
+            if (m_abortOperation) {
+                break;
+            }
 
-                if (!writeFile(path, destinationPath)) {
-                    finish(false);
-                    return false;
-                }
-                no_entries++;
+            if (!writeFile(file, destinationPath)) {
+                finish(false);
+                return false;
             }
+            no_entries++;
         }
     }
     qCDebug(ARK) << "Added" << no_entries << "new entries to archive";
 
+    if (m_savedBytes > 0) {
+        qCDebug(ARK) << "Stored" << m_savedBytes << "bytes of duplicated files as hardlinks";
+        emit bytesSaved(m_savedBytes);
+    }
+
     bool isSuccessful = true;
     // If we have old archive entries.
     if (!creatingNewFile) {
@@ -297,6 +309,13 @@ bool ReadWriteLibarchivePlugin::initializeWriterFilters()
         case ARCHIVE_FILTER_LZ4:
             ret = archive_write_add_filter_lz4(m_archiveWriter.data());
             break;
+#endif
+#ifdef HAVE_LIBARCHIVE_3_3_3
+        case ARCHIVE_FILTER_ZSTD:
+            ret = archive_write_add_filter_zstd(m_archiveWriter.data());
+            // Without libzstd, libarchive falls back to the zstd executable.
+            requiresExecutable = (ret == ARCHIVE_WARN);
+            break;
 #endif
         case ARCHIVE_FILTER_NONE:
             ret = archive_write_add_filter_none(m_archiveWriter.data());
@@ -351,6 +370,14 @@ bool ReadWriteLibarchivePlugin::initializeNewFileWriterFilters(const Compression
         } else if (filename().right(3).toUpper() == QLatin1String("LZ4")) {
             qCDebug(ARK) << "Detected lz4 compression for new file";
             ret = archive_write_add_filter_lz4(m_archiveWriter.data());
+#endif
+#ifdef HAVE_LIBARCHIVE_3_3_3
+    } else if (filename().right(3).toUpper() == QLatin1String("ZST")) {
+        // Covers both .tar.zst and .tzst.
+        qCDebug(ARK) << "Detected zstd compression for new file";
+        ret = archive_write_add_filter_zstd(m_archiveWriter.data());
+        // Without libzstd, libarchive falls back to the zstd executable.
+        requiresExecutable = (ret == ARCHIVE_WARN);
 #endif
     } else if (filename().right(3).toUpper() == QLatin1String("TAR")) {
         qCDebug(ARK) << "Detected no compression for new file (pure tar)";
@@ -380,6 +407,37 @@ bool ReadWriteLibarchivePlugin::initializeNewFileWriterFilters(const Compression
         }
     }
 
+    // The tuning options are best-effort: older libarchive versions lack some of them.
+    if (options.value(QStringLiteral("Threads")).toInt() > 0) {
+        qCDebug(ARK) << "Using compression threads:" << options.value(QStringLiteral("Threads")).toInt();
+        ret = archive_write_set_filter_option(m_archiveWriter.data(), NULL, "threads", options.value(QStringLiteral("Threads")).toString().toUtf8());
+        if (ret != ARCHIVE_OK) {
+            qCWarning(ARK) << "Failed to set the number of compression threads:" << archive_error_string(m_archiveWriter.data());
+        }
+    }
+
+    if (options.value(QStringLiteral("BlockSize")).toInt() > 0) {
+        // lz4 takes the block size as a maximum block size id: 4 (64 KiB) to 7 (4 MiB).
+        int blockSizeId = 4;
+        while (blockSizeId < 7 && (64 << (2 * (blockSizeId - 4))) < options.value(QStringLiteral("BlockSize")).toInt()) {
+            ++blockSizeId;
+        }
+        qCDebug(ARK) << "Using block size id:" << blockSizeId;
+        ret = archive_write_set_filter_option(m_archiveWriter.data(), NULL, "block-size", QByteArray::number(blockSizeId));
+        if (ret != ARCHIVE_OK) {
+            qCWarning(ARK) << "Failed to set the block size:" << archive_error_string(m_archiveWriter.data());
+        }
+    }
+
+    if (options.value(QStringLiteral("LongDistanceMatching")).toBool()) {
+        // zstd takes the window log: 27 (128 MiB) is what "zstd --long" uses.
+        qCDebug(ARK) << "Using long-distance matching";
+        ret = archive_write_set_filter_option(m_archiveWriter.data(), NULL, "long", "27");
+        if (ret != ARCHIVE_OK) {
+            qCWarning(ARK) << "Failed to enable long-distance matching:" << archive_error_string(m_archiveWriter.data());
+        }
+    }
+
     return true;
 }
 
@@ -398,8 +456,21 @@ bool ReadWriteLibarchivePlugin::processOldEntries(int &entriesCounter, Operation
 
     entriesCounter = 0;
 
+    // Entries already written in Add mode are matched exactly, a deleted folder
+    // takes its contents with it.
+    LibarchiveEntrySelection selection;
     QMap<QString, QString> pathMap;
-    if (mode == Move || mode == Copy) {
+    QHash<QString, QString> newHardlinkTargets;
+    if (mode == Add || mode == Delete) {
+        selection.setPaths(m_filesPaths, mode == Delete);
+        if (mode == Delete) {
+            newHardlinkTargets = hardlinkTargetsAfterDeletion(selection);
+            if (!initializeReader()) {
+                return false;
+            }
+        }
+    }
+    else if (mode == Move || mode == Copy) {
         m_filesPaths.sort();
         QStringList resultList = entryPathsFromDestination(m_filesPaths, m_destination, m_entriesWithoutChildren);
         const int listSize = m_filesPaths.count();
@@ -413,6 +484,20 @@ bool ReadWriteLibarchivePlugin::processOldEntries(int &entriesCounter, Operation
 
         const QString file = QFile::decodeName(archive_entry_pathname(entry));
 
+        // Only the target of a hardlink holds the data, the links follow it.
+        if (archive_entry_hardlink(entry)) {
+            const QString target = QFile::decodeName(archive_entry_hardlink(entry));
+            const QString newTarget = (mode == Move) ? pathMap.value(target) : newHardlinkTargets.value(target);
+            if (newTarget == file) {
+                // The link was written already, with the data of its deleted target.
+                archive_read_data_skip(m_archiveReader.data());
+                continue;
+            }
+            if (!newTarget.isEmpty()) {
+                archive_entry_set_hardlink(entry, QFile::encodeName(newTarget).constData());
+            }
+        }
+
         if (mode == Move || mode == Copy) {
             const QString newPathname = pathMap.value(file);
             if (!newPathname.isEmpty()) {
@@ -429,7 +514,19 @@ bool ReadWriteLibarchivePlugin::processOldEntries(int &entriesCounter, Operation
                 archive_entry_set_pathname(entry, newPathname.toUtf8());
             }
         }
-        else if (m_filesPaths.contains(file)) {
+        else if (selection.indexOf(archive_entry_pathname(entry)) != -1) {
+            // The first hardlink left takes the data of its deleted target, in its place.
+            const QString newTarget = newHardlinkTargets.value(file);
+            if (!newTarget.isEmpty()) {
+                entriesCounter++;
+                emit entryRemoved(file);
+                archive_entry_set_pathname(entry, QFile::encodeName(newTarget).constData());
+                if (!writeEntry(entry)) {
+                    return false;
+                }
+                continue;
+            }
+
             archive_read_data_skip(m_archiveReader.data());
             switch (mode) {
                 case Delete:
@@ -464,6 +561,25 @@ bool ReadWriteLibarchivePlugin::processOldEntries(int &entriesCounter, Operation
     return true;
 }
 
+QHash<QString, QString> ReadWriteLibarchivePlugin::hardlinkTargetsAfterDeletion(const LibarchiveEntrySelection &deleted)
+{
+    QHash<QString, QString> newTargets;
+    struct archive_entry *entry;
+
+    while (archive_read_next_header(m_archiveReader.data(), &entry) == ARCHIVE_OK) {
+        const char *target = archive_entry_hardlink(entry);
+        if (target && deleted.indexOf(target) != -1 && deleted.indexOf(archive_entry_pathname(entry)) == -1) {
+            const QString targetPath = QFile::decodeName(target);
+            if (!newTargets.contains(targetPath)) {
+                newTargets.insert(targetPath, QFile::decodeName(archive_entry_pathname(entry)));
+            }
+        }
+        archive_read_data_skip(m_archiveReader.data());
+    }
+
+    return newTargets;
+}
+
 bool ReadWriteLibarchivePlugin::writeEntry(struct archive_entry *entry) {
     const int returnCode = archive_write_header(m_archiveWriter.data(), entry);
     const QString file = QFile::decodeName(archive_entry_pathname(entry));
@@ -490,31 +606,39 @@ bool ReadWriteLibarchivePlugin::writeEntry(struct archive_entry *entry) {
     return true;
 }
 
-// TODO: if we merge this with copyData(), we can pass more data
-//       such as an fd to archive_read_disk_entry_from_file()
-bool ReadWriteLibarchivePlugin::writeFile(const QString &relativeName, const QString &destination)
+bool ReadWriteLibarchivePlugin::writeFile(const LibarchiveDiskReader::Entry &file, const QString &destination)
 {
     int header_response;
-    const QString absoluteFilename = QFileInfo(relativeName).absoluteFilePath();
-    const QString destinationFilename = destination + relativeName;
-
-    // #253059: Even if we use archive_read_disk_entry_from_file,
-    //          libarchive may have been compiled without HAVE_LSTAT,
-    //          or something may have caused it to follow symlinks, in
-    //          which case stat() will be called. To avoid this, we
-    //          call lstat() ourselves.
-    struct stat st;
-    lstat(QFile::encodeName(absoluteFilename).constData(), &st);
-
-    struct archive_entry *entry = archive_entry_new();
+    const QString &absoluteFilename = file.absolutePath;
+    const QString destinationFilename = destination + file.path;
+
+    struct archive_entry *entry = file.entry.data();
     archive_entry_set_pathname(entry, QFile::encodeName(destinationFilename).constData());
-    archive_entry_copy_sourcepath(entry, QFile::encodeName(absoluteFilename).constData());
-    archive_read_disk_entry_from_file(m_archiveReadDisk.data(), entry, -1, &st);
+
+    // A hardlink entry has no data, it is extracted as a link to the file written before.
+    const QString linkTarget = hardlinkTarget(file);
+    qlonglong linkedBytes = 0;
+    if (!linkTarget.isEmpty()) {
+        linkedBytes = archive_entry_size(entry);
+        archive_entry_set_hardlink(entry, QFile::encodeName(linkTarget).constData());
+        archive_entry_set_size(entry, 0);
+        archive_entry_sparse_clear(entry);
+    }
 
     if ((header_response = archive_write_header(m_archiveWriter.data(), entry)) == ARCHIVE_OK) {
-        // If the whole archive is extracted and the total filesize is
-        // available, we use partial progress.
-        copyData(absoluteFilename, m_archiveWriter.data(), false);
+        if (!linkTarget.isEmpty()) {
+            m_savedBytes += linkedBytes;
+        } else if (file.isDataRead) {
+            archive_write_data(m_archiveWriter.data(), file.data.constData(), file.data.size());
+            if (archive_errno(m_archiveWriter.data()) != ARCHIVE_OK) {
+                qCCritical(ARK) << "Error while writing" << absoluteFilename << ":" << archive_error_string(m_archiveWriter.data())
+                                << "(error no =" << archive_errno(m_archiveWriter.data()) << ')';
+            }
+        } else {
+            // If the whole archive is extracted and the total filesize is
+            // available, we use partial progress.
+            copyData(absoluteFilename, m_archiveWriter.data(), false);
+        }
     } else {
         qCCritical(ARK) << "Writing header failed with error code " << header_response;
         qCCritical(ARK) << "Error while writing..." << archive_error_string(m_archiveWriter.data()) << "(error no =" << archive_errno(m_archiveWriter.data()) << ')';
@@ -524,18 +648,71 @@ bool ReadWriteLibarchivePlugin::writeFile(const QString &relativeName, const QSt
                           absoluteFilename,
                           QString::fromUtf8(archive_error_string(m_archiveWriter.data()))));
 
-        archive_entry_free(entry);
-
         return false;
     }
 
     m_writtenFiles.push_back(destinationFilename);
+    // The other links of a file stored as a hardlink point to the same target.
+    addHardlinkTarget(file, linkTarget.isEmpty() ? destinationFilename : linkTarget);
 
     emitEntryFromArchiveEntry(entry);
 
-    archive_entry_free(entry);
-
     return true;
 }
 
+// The key of the content also holds what a hardlink shares besides the data.
+static QByteArray contentKey(const LibarchiveDiskReader::Entry &file)
+{
+    struct archive_entry *entry = file.entry.data();
+    return file.contentHash + ':' + QByteArray::number(qint64(archive_entry_size(entry))) +
+           ':' + QByteArray::number(uint(archive_entry_perm(entry))) +
+           ':' + QByteArray::number(qint64(archive_entry_uid(entry))) +
+           ':' + QByteArray::number(qint64(archive_entry_gid(entry)));
+}
+
+QString ReadWriteLibarchivePlugin::hardlinkTarget(const LibarchiveDiskReader::Entry &file) const
+{
+    struct archive_entry *entry = file.entry.data();
+    if (archive_entry_filetype(entry) != AE_IFREG) {
+        return QString();
+    }
+
+    if (archive_entry_nlink(entry) > 1) {
+        const QString target = m_writtenInodes.value(qMakePair(qint64(archive_entry_dev(entry)),
+                                                               qint64(archive_entry_ino64(entry))));
+        if (!target.isEmpty()) {
+            return target;
+        }
+    }
+
+    if (m_deduplicateContent && !file.contentHash.isEmpty()) {
+        const QPair<QString, QString> target = m_writtenContents.value(contentKey(file));
+        if (!target.first.isEmpty() && haveSameContent(target.second, file.absolutePath)) {
+            return target.first;
+        }
+    }
+
+    return QString();
+}
+
+void ReadWriteLibarchivePlugin::addHardlinkTarget(const LibarchiveDiskReader::Entry &file, const QString &destinationFilename)
+{
+    struct archive_entry *entry = file.entry.data();
+    if (archive_entry_filetype(entry) != AE_IFREG) {
+        return;
+    }
+
+    if (archive_entry_nlink(entry) > 1) {
+        m_writtenInodes.insert(qMakePair(qint64(archive_entry_dev(entry)), qint64(archive_entry_ino64(entry))),
+                               destinationFilename);
+    }
+
+    if (m_deduplicateContent && !file.contentHash.isEmpty()) {
+        const QByteArray key = contentKey(file);
+        if (!m_writtenContents.contains(key)) {
+            m_writtenContents.insert(key, qMakePair(destinationFilename, file.absolutePath));
+        }
+    }
+}
+
 #include "readwritelibarchiveplugin.moc"
@@ -28,12 +28,17 @@
 #ifndef READWRITELIBARCHIVEPLUGIN_H
 #define READWRITELIBARCHIVEPLUGIN_H
 
+#include "libarchivediskreader.h"
 #include "libarchiveplugin.h"
 
 #include <QDir>
+#include <QHash>
+#include <QPair>
 #include <QStringList>
 #include <QtCore/QSaveFile>
 
+class LibarchiveEntrySelection;
+
 using namespace Kerfuffle;
 
 class ReadWriteLibarchivePlugin : public LibarchivePlugin
@@ -66,6 +71,13 @@ private:
      */
     bool processOldEntries(int &entriesCounter, OperationMode mode);
 
+    /**
+     * Reads the whole archive to find the hardlinks whose target is @p deleted.
+     *
+     * @return For each deleted target, the first hardlink to it which is kept.
+     */
+    QHash<QString, QString> hardlinkTargetsAfterDeletion(const LibarchiveEntrySelection &deleted);
+
     /**
      * Writes entry being read into memory.
      *
@@ -74,11 +86,22 @@ private:
     bool writeEntry(struct archive_entry *entry);
 
     /**
-     * Writes entry from physical disk.
+     * Writes entry from physical disk, as read by LibarchiveDiskReader.
      *
      * @return bool indicating whether the operation was successful.
      */
-    bool writeFile(const QString &relativeName, const QString &destination);
+    bool writeFile(const LibarchiveDiskReader::Entry &file, const QString &destination);
+
+    /**
+     * @return The path in the archive of a file already written which @p file can
+     * be a hardlink to, an empty string if none.
+     */
+    QString hardlinkTarget(const LibarchiveDiskReader::Entry &file) const;
+
+    /**
+     * Remembers @p file, written as @p destinationFilename, as a target for hardlinks.
+     */
+    void addHardlinkTarget(const LibarchiveDiskReader::Entry &file, const QString &destinationFilename);
 
     QSaveFile m_tempFile;
     ArchiveWrite m_archiveWriter;
@@ -91,6 +114,14 @@ private:
     QStringList m_filesPaths;
     int m_entriesWithoutChildren;
     const Archive::Entry *m_destination;
+
+    // The files written by addFiles, by device and inode if they have several links,
+    // and by content if DeduplicateContent is set. Their path in the archive is kept,
+    // with their path on disk for the content ones.
+    QHash<QPair<qint64, qint64>, QString> m_writtenInodes;
+    QHash<QByteArray, QPair<QString, QString> > m_writtenContents;
+    bool m_deduplicateContent;
+    qlonglong m_savedBytes;
 };
 
 #endif // READWRITELIBARCHIVEPLUGIN_H
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "sevenziplibarchiveplugin.h"
+#include "ark_debug.h"
+
+#include <KPluginFactory>
+
+#include <QFileInfo>
+
+#include <archive_entry.h>
+
+K_PLUGIN_FACTORY_WITH_JSON(SevenZipLibarchivePluginFactory, "kerfuffle_libarchive_7z.json", registerPlugin<SevenZipLibarchivePlugin>();)
+
+SevenZipLibarchivePlugin::SevenZipLibarchivePlugin(QObject *parent, const QVariantList & args)
+    : LibarchivePlugin(parent, args)
+{
+    qCDebug(ARK) << "Loaded libarchive 7z plugin";
+}
+
+SevenZipLibarchivePlugin::~SevenZipLibarchivePlugin()
+{
+}
+
+bool SevenZipLibarchivePlugin::open()
+{
+    // New archives are created by the read-write plugins.
+    if (!QFileInfo(filename()).isFile() || !initializeReader()) {
+        return false;
+    }
+
+#ifdef HAVE_LIBARCHIVE_3_2_0
+    // Reading the first header decodes the header of the whole archive, which
+    // fails if it is encrypted. The encryption of the data is only known per
+    // folder, and the first entries (e.g. directories or empty files) may not
+    // have any, so all the headers are checked. Only the headers are read.
+    struct archive_entry *entry;
+    int result;
+    bool isEncrypted = false;
+    while ((result = archive_read_next_header(m_archiveReader.data(), &entry)) == ARCHIVE_OK) {
+        if (archive_entry_is_encrypted(entry)) {
+            isEncrypted = true;
+            break;
+        }
+    }
+    const bool canRead = (!isEncrypted && result == ARCHIVE_EOF);
+#else
+    // Older versions can't tell about the encrypted entries before extracting
+    // them, and would fail without asking for a password.
+    const bool canRead = false;
+#endif
+
+    if (!canRead) {
+        qCDebug(ARK) << "libarchive cannot decode" << filename() << ":" << archive_error_string(m_archiveReader.data());
+    }
+
+    m_archiveReader.reset();
+    return canRead;
+}
+
+#include "sevenziplibarchiveplugin.moc"
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ziplibarchiveplugin.h"
+#include "libarchiveentrydevice.h"
+#include "libarchiveentryselection.h"
+#include "ark_debug.h"
+
+#include <KLocalizedString>
+#include <KPluginFactory>
+
+#include <QDir>
+#include <QFile>
+
+K_PLUGIN_FACTORY_WITH_JSON(ZipLibarchivePluginFactory, "kerfuffle_libarchive_zip.json", registerPlugin<ZipLibarchivePlugin>();)
+
+/**
+ * Decodes a single entry of a zip archive, reading only its local header and data.
+ */
+class ZipEntryDevice : public LibarchiveEntryDevice
+{
+public:
+    ZipEntryDevice(const QString &archiveFileName, const QString &entryPath, const QVector<ZipRangeReader::Range> &ranges)
+        : LibarchiveEntryDevice(archiveFileName, entryPath)
+        , m_rangeReader(archiveFileName, ranges)
+    {
+    }
+
+    ~ZipEntryDevice()
+    {
+        // The reader must be freed before the ranges it reads.
+        close();
+    }
+
+protected:
+    virtual bool openArchive(struct archive *reader) Q_DECL_OVERRIDE
+    {
+        return archive_read_support_format_zip_streamable(reader) == ARCHIVE_OK &&
+               m_rangeReader.open(reader);
+    }
+
+private:
+    ZipRangeReader m_rangeReader;
+};
+
+static QString methodName(quint16 method)
+{
+    switch (method) {
+    case 0:
+        return QStringLiteral("Stored");
+    case 8:
+        return QStringLiteral("Deflate");
+    case 9:
+        return QStringLiteral("Deflate64");
+    case 12:
+        return QStringLiteral("BZip2");
+    case 14:
+        return QStringLiteral("LZMA");
+    case 93:
+        return QStringLiteral("Zstandard");
+    case 95:
+        return QStringLiteral("XZ");
+    case 98:
+        return QStringLiteral("PPMd");
+    case 99:
+        return QStringLiteral("AES");
+    default:
+        return QString::number(method);
+    }
+}
+
+ZipLibarchivePlugin::ZipLibarchivePlugin(QObject *parent, const QVariantList & args)
+    : LibarchivePlugin(parent, args)
+{
+    qCDebug(ARK) << "Loaded libarchive zip plugin";
+}
+
+ZipLibarchivePlugin::~ZipLibarchivePlugin()
+{
+    // The reader must be freed before the ranges it reads.
+    m_archiveReader.reset();
+}
+
+bool ZipLibarchivePlugin::list()
+{
+    qCDebug(ARK) << "Listing archive contents from the central directory";
+
+    if (!readCentralDirectory()) {
+        return false;
+    }
+
+    m_cachedArchiveEntryCount = 0;
+    m_extractedFilesSize = 0;
+
+    foreach (const ZipCentralDirectory::Record &record, m_centralDirectory.records()) {
+        if (m_abortOperation) {
+            break;
+        }
+
+        emitEntryFromRecord(record);
+
+        m_extractedFilesSize += record.size;
+        m_cachedArchiveEntryCount++;
+    }
+    m_abortOperation = false;
+
+    qCDebug(ARK) << "Listed" << m_cachedArchiveEntryCount << "entries, reading"
+                 << m_centralDirectory.bytesRead() << "bytes of the archive";
+
+    return true;
+}
+
+QIODevice *ZipLibarchivePlugin::createEntryDevice(Archive::Entry *entry)
+{
+    if (m_centralDirectory.records().isEmpty() && !readCentralDirectory()) {
+        return Q_NULLPTR;
+    }
+
+    const QVector<int> records = recordsFor(QList<Archive::Entry*>() << entry);
+    LibarchiveEntryDevice *device = new ZipEntryDevice(filename(), entry->fullPath(),
+                                                       ZipRangeReader::rangesFor(m_centralDirectory, records));
+    if (!device->open(QIODevice::ReadOnly)) {
+        qCWarning(ARK) << "Could not stream" << entry->fullPath() << ":" << device->errorString();
+        delete device;
+        return Q_NULLPTR;
+    }
+
+    return device;
+}
+
+bool ZipLibarchivePlugin::initializeReaderFor(const QList<Archive::Entry*> &files)
+{
+    // The archive may be extracted without having been listed.
+    if (m_centralDirectory.records().isEmpty() && !readCentralDirectory()) {
+        return false;
+    }
+
+    m_archiveReader.reset(archive_read_new());
+    if (!(m_archiveReader.data())) {
+        emit error(i18n("The archive reader could not be initialized."));
+        return false;
+    }
+
+    m_rangeReader.reset(new ZipRangeReader(filename(), ZipRangeReader::rangesFor(m_centralDirectory, recordsFor(files))));
+
+    if (archive_read_support_format_zip_streamable(m_archiveReader.data()) != ARCHIVE_OK ||
+        !m_rangeReader->open(m_archiveReader.data())) {
+        emit error(xi18nc("@info", "Could not open the archive <filename>%1</filename>.<nl/>"
+            "Check whether you have sufficient permissions.",
+                          filename()));
+        return false;
+    }
+
+    return true;
+}
+
+bool ZipLibarchivePlugin::readCentralDirectory()
+{
+    QFile file(filename());
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit error(xi18nc("@info", "Could not open the archive <filename>%1</filename>.<nl/>"
+            "Check whether you have sufficient permissions.",
+                          filename()));
+        return false;
+    }
+
+    if (!m_centralDirectory.read(&file)) {
+        qCWarning(ARK) << "Could not read the central directory of" << filename() << ":" << m_centralDirectory.errorString();
+        emit error(xi18nc("@info", "The archive <filename>%1</filename> is damaged: its list of entries could not be read.",
+                          filename()));
+        return false;
+    }
+
+    return true;
+}
+
+QVector<int> ZipLibarchivePlugin::recordsFor(const QList<Archive::Entry*> &files) const
+{
+    const QVector<ZipCentralDirectory::Record> &records = m_centralDirectory.records();
+    QVector<int> indexes;
+
+    if (files.isEmpty()) {
+        indexes.reserve(records.size());
+        for (int i = 0; i < records.size(); ++i) {
+            indexes << i;
+        }
+        return indexes;
+    }
+
+    // Matched like the entries read by LibarchivePlugin::extractFiles().
+    const LibarchiveEntrySelection selection(entryFullPaths(files));
+    for (int i = 0; i < records.size(); ++i) {
+        if (selection.indexOf(records.at(i).name.constData()) != -1) {
+            indexes << i;
+        }
+    }
+
+    return indexes;
+}
+
+void ZipLibarchivePlugin::emitEntryFromRecord(const ZipCentralDirectory::Record &record)
+{
+    Archive::Entry *e = new Archive::Entry(Q_NULLPTR);
+
+    e->setProperty("fullPath", QDir::fromNativeSeparators(record.fullPath()));
+    e->setProperty("size", record.size);
+    e->setProperty("compressedSize", record.compressedSize);
+    e->setProperty("isDirectory", record.isDir());
+    e->setProperty("timestamp", record.timestamp);
+    e->setProperty("CRC", QStringLiteral("%1").arg(record.crc, 8, 16, QLatin1Char('0')).toUpper());
+    e->setProperty("method", methodName(record.method));
+    e->setProperty("isPasswordProtected", record.isEncrypted());
+
+    emit entry(e);
+}
+
+#include "ziplibarchiveplugin.moc"
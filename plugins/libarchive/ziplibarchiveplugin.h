@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ZIPLIBARCHIVEPLUGIN_H
+#define ZIPLIBARCHIVEPLUGIN_H
+
+#include "libarchiveplugin.h"
+#include "kerfuffle/zipcentraldirectory.h"
+#include "ziprangereader.h"
+
+/**
+ * Read-only plugin for zip archives, which seeks to the entries instead of
+ * going through the whole archive.
+ *
+ * The archive is listed from its central directory, and only the local headers
+ * and the data of the extracted entries are read.
+ */
+class ZipLibarchivePlugin : public LibarchivePlugin
+{
+    Q_OBJECT
+
+public:
+    explicit ZipLibarchivePlugin(QObject *parent, const QVariantList& args);
+    ~ZipLibarchivePlugin();
+
+    virtual bool list() Q_DECL_OVERRIDE;
+    virtual QIODevice *createEntryDevice(Archive::Entry *entry) Q_DECL_OVERRIDE;
+
+protected:
+    virtual bool initializeReaderFor(const QList<Archive::Entry*> &files) Q_DECL_OVERRIDE;
+
+private:
+    bool readCentralDirectory();
+
+    /**
+     * @return The indexes of the records of @p files, all of them if empty.
+     */
+    QVector<int> recordsFor(const QList<Archive::Entry*> &files) const;
+
+    void emitEntryFromRecord(const ZipCentralDirectory::Record &record);
+
+    ZipCentralDirectory m_centralDirectory;
+    QScopedPointer<ZipRangeReader> m_rangeReader;
+};
+
+#endif // ZIPLIBARCHIVEPLUGIN_H
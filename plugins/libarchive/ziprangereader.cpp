@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ziprangereader.h"
+#include "kerfuffle/zipcentraldirectory.h"
+
+#include <algorithm>
+#include <cerrno>
+
+using namespace Kerfuffle;
+
+// An empty end of central directory record, which makes the streamable reader
+// stop after the last entry.
+static const char s_endOfArchive[22] = {'P', 'K', '\x05', '\x06'};
+
+ZipRangeReader::ZipRangeReader(const QString &fileName, const QVector<Range> &ranges)
+    : m_file(fileName)
+    , m_ranges(ranges)
+    , m_buffer(64 * 1024, Qt::Uninitialized)
+    , m_currentRange(0)
+    , m_rangePosition(0)
+    , m_endReached(false)
+{
+}
+
+bool ZipRangeReader::open(struct archive *reader)
+{
+    if (!m_file.isOpen() && !m_file.open(QIODevice::ReadOnly)) {
+        archive_set_error(reader, EIO, "Could not open the archive");
+        return false;
+    }
+
+    m_currentRange = 0;
+    m_rangePosition = 0;
+    m_endReached = false;
+
+    return archive_read_open(reader, this, Q_NULLPTR, &ZipRangeReader::read, &ZipRangeReader::close) == ARCHIVE_OK;
+}
+
+QVector<ZipRangeReader::Range> ZipRangeReader::rangesFor(const ZipCentralDirectory &centralDirectory, const QVector<int> &indexes)
+{
+    const QVector<ZipCentralDirectory::Record> &records = centralDirectory.records();
+
+    // An entry ends where the next one in the file begins: the data descriptor
+    // following the data isn't part of the sizes found in the central directory.
+    QVector<qint64> localHeaderOffsets;
+    localHeaderOffsets.reserve(records.size() + 1);
+    foreach (const ZipCentralDirectory::Record &record, records) {
+        localHeaderOffsets << record.localHeaderOffset;
+    }
+    localHeaderOffsets << centralDirectory.offset();
+    std::sort(localHeaderOffsets.begin(), localHeaderOffsets.end());
+
+    QVector<qint64> selectedOffsets;
+    selectedOffsets.reserve(indexes.size());
+    foreach (int index, indexes) {
+        selectedOffsets << records.at(index).localHeaderOffset;
+    }
+    std::sort(selectedOffsets.begin(), selectedOffsets.end());
+    selectedOffsets.erase(std::unique(selectedOffsets.begin(), selectedOffsets.end()), selectedOffsets.end());
+
+    QVector<Range> ranges;
+    foreach (qint64 offset, selectedOffsets) {
+        const auto next = std::upper_bound(localHeaderOffsets.constBegin(), localHeaderOffsets.constEnd(), offset);
+        if (next == localHeaderOffsets.constEnd()) {
+            continue;
+        }
+
+        // Adjacent entries are read in one go.
+        if (!ranges.isEmpty() && ranges.last().offset + ranges.last().length == offset) {
+            ranges.last().length = *next - ranges.last().offset;
+        } else {
+            ranges.append({offset, *next - offset});
+        }
+    }
+
+    return ranges;
+}
+
+ssize_t ZipRangeReader::read(struct archive *reader, void *clientData, const void **buffer)
+{
+    ZipRangeReader *rangeReader = static_cast<ZipRangeReader*>(clientData);
+
+    while (rangeReader->m_currentRange < rangeReader->m_ranges.size()) {
+        const Range &range = rangeReader->m_ranges.at(rangeReader->m_currentRange);
+        const qint64 remainingBytes = range.length - rangeReader->m_rangePosition;
+        if (remainingBytes <= 0) {
+            rangeReader->m_currentRange++;
+            rangeReader->m_rangePosition = 0;
+            continue;
+        }
+
+        if (rangeReader->m_rangePosition == 0 && !rangeReader->m_file.seek(range.offset)) {
+            archive_set_error(reader, EIO, "Could not seek in the archive");
+            return -1;
+        }
+
+        const qint64 readBytes = rangeReader->m_file.read(rangeReader->m_buffer.data(),
+                                                           qMin<qint64>(remainingBytes, rangeReader->m_buffer.size()));
+        if (readBytes <= 0) {
+            archive_set_error(reader, EIO, "Could not read the archive");
+            return -1;
+        }
+
+        rangeReader->m_rangePosition += readBytes;
+        *buffer = rangeReader->m_buffer.constData();
+        return readBytes;
+    }
+
+    if (!rangeReader->m_endReached) {
+        rangeReader->m_endReached = true;
+        *buffer = s_endOfArchive;
+        return sizeof(s_endOfArchive);
+    }
+
+    return 0;
+}
+
+int ZipRangeReader::close(struct archive *reader, void *clientData)
+{
+    // The file stays open for the next reader, it is closed with this object.
+    Q_UNUSED(reader)
+    Q_UNUSED(clientData)
+    return ARCHIVE_OK;
+}
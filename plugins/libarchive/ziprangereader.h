@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2016 Vladyslav Batyrenko <mvlabat@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES ( INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION ) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * ( INCLUDING NEGLIGENCE OR OTHERWISE ) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ZIPRANGEREADER_H
+#define ZIPRANGEREADER_H
+
+#include <archive.h>
+
+#include <QByteArray>
+#include <QFile>
+#include <QVector>
+
+namespace Kerfuffle
+{
+class ZipCentralDirectory;
+}
+
+/**
+ * Feeds a libarchive reader with some byte ranges of a zip archive, so that the
+ * local entries found there are read as if they formed the whole archive.
+ *
+ * The reader must support the streamable zip format: it only sees the local
+ * headers and the data of the entries, not the central directory.
+ */
+class ZipRangeReader
+{
+public:
+    struct Range
+    {
+        qint64 offset;
+        qint64 length;
+    };
+
+    ZipRangeReader(const QString &fileName, const QVector<Range> &ranges);
+
+    /**
+     * Opens @p reader on the ranges, reading them from the beginning.
+     */
+    bool open(struct archive *reader);
+
+    /**
+     * @return The ranges of the archive file holding the entries at @p indexes
+     * in the records of @p centralDirectory, in the order of the file.
+     */
+    static QVector<Range> rangesFor(const Kerfuffle::ZipCentralDirectory &centralDirectory, const QVector<int> &indexes);
+
+private:
+    static ssize_t read(struct archive *reader, void *clientData, const void **buffer);
+    static int close(struct archive *reader, void *clientData);
+
+    QFile m_file;
+    QVector<Range> m_ranges;
+    QByteArray m_buffer;
+    int m_currentRange;
+    qint64 m_rangePosition;
+    bool m_endReached;
+};
+
+#endif // ZIPRANGEREADER_H
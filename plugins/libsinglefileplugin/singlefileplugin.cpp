@@ -101,6 +101,20 @@ bool LibSingleFileInterface::extractFiles(const QList<Kerfuffle::Archive::Entry*
     return true;
 }
 
+QIODevice *LibSingleFileInterface::createEntryDevice(Kerfuffle::Archive::Entry *entry)
+{
+    Q_UNUSED(entry)
+
+    KCompressionDevice *device = new KCompressionDevice(filename(), KFilterDev::compressionTypeForMimeType(m_mimeType));
+    if (!device->open(QIODevice::ReadOnly)) {
+        qCWarning(ARK) << "Could not open" << filename() << "for streaming:" << device->errorString();
+        delete device;
+        return Q_NULLPTR;
+    }
+
+    return device;
+}
+
 bool LibSingleFileInterface::list()
 {
     qCDebug(ARK) << "Listing archive contents";